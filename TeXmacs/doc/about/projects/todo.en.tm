@@ -144,6 +144,21 @@
 
     Implement a proper parser and autocompletion mechanism. Add standard
     <abbr|IDE> code browsing tools and visual aids.
+
+    <item*|Lazy lists>
+
+    Arrays returned by glue routines are converted into <scheme> lists,
+    even when the caller only inspects a few elements. Lazy handles would
+    avoid this, but every caller which applies <verbatim|car>,
+    <verbatim|map> or <verbatim|length> to these results would need to be
+    ported to new accessors.
+
+    <item*|Fast paths in the glue generator>
+
+    Let <verbatim|build-glue.scm> emit specialized argument checks and
+    conversions for trees, urls and other frequent types, instead of going
+    through the generic <verbatim|tmscm_is_<em|type>> and
+    <verbatim|tmscm_to_<em|type>> routines, and regenerate the glue.
   </description>
 
   <subsection|Coding style>
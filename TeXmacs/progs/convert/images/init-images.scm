@@ -29,7 +29,9 @@
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
 
 (define-preferences
-  ("texmacs->image:raster-resolution" "300" noop))
+  ("texmacs->image:raster-resolution" "300" noop)
+  ("image conversion cache" "on" noop)
+  ("background image conversions" "2" noop))
 
 (define (get-raster-resolution opts)
   (or (assoc-ref opts "texmacs->image:raster-resolution")
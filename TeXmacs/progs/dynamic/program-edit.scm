@@ -566,7 +566,7 @@
     (program-forall
       (lambda (t)
 	(when (not (tree-empty? (tree-ref t 1)))
-	  (when (path-inf? (tree->path t) (tree->path me))
+	  (when (tree-precedes? t me)
 	    (prog-field-process-input t)))))))
 
 (tm-define (program-evaluate-below)
@@ -574,7 +574,7 @@
     (program-forall
       (lambda (t)
 	(when (not (tree-empty? (tree-ref t 1)))
-	  (when (path-inf-eq? (tree->path me) (tree->path t))
+	  (when (or (tree-eq? me t) (tree-precedes? me t))
 	    (prog-field-process-input t)))))))
 
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
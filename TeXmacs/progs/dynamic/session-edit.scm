@@ -520,7 +520,7 @@
     (session-forall
       (lambda (t)
 	(when (not (tree-empty? (tree-ref t 1)))
-	  (when (path-inf? (tree->path t) (tree->path me))
+	  (when (tree-precedes? t me)
 	    (field-process-input t)))))))
 
 (tm-define (session-evaluate-below)
@@ -528,7 +528,7 @@
     (session-forall
       (lambda (t)
 	(when (not (tree-empty? (tree-ref t 1)))
-	  (when (path-inf-eq? (tree->path me) (tree->path t))
+	  (when (or (tree-eq? me t) (tree-precedes? me t))
 	    (field-process-input t)))))))
 
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
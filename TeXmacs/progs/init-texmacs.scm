@@ -72,8 +72,79 @@
                       '(old-primitive-load new-primitive-load))
       (set! primitive-load new-primitive-load)))
 
-;; TODO: scheme file caching using (set! primitive-load ...) and
-;; (set! %search-load-path)
+;; Cache the locations of the scheme modules which are loaded while booting.
+;; Otherwise, each module is searched for along the load path, which
+;; contains the progs directories of all plugins.  The cache is discarded
+;; as soon as the load path or the modification times of its directories
+;; or of the plugin directories change.  Moreover, the modification time
+;; of each directory in which cached modules were found is stored, and
+;; the modules of a directory which changed since are searched again.
+
+(define boot-cache-file
+  (url-concretize "$TEXMACS_HOME_PATH/system/cache/boot_cache.scm"))
+(define boot-cache-table (make-hash-table 1031))
+(define boot-cache-changed? #f)
+
+(define (boot-cache-mtime dir)
+  (false-if-exception (stat:mtime (stat dir))))
+
+(define (boot-cache-stamp)
+  (list %load-path
+        (map boot-cache-mtime %load-path)
+        (boot-cache-mtime (url-concretize "$TEXMACS_PATH/plugins"))
+        (boot-cache-mtime (url-concretize "$TEXMACS_HOME_PATH/plugins"))))
+
+(define (boot-cache-dirs)
+  (let ((dirs (make-hash-table 127)))
+    (hash-fold (lambda (k v l)
+                 (let ((d (dirname v)))
+                   (if (hash-ref dirs d) l
+                       (begin
+                         (hash-set! dirs d #t)
+                         (cons (cons d (boot-cache-mtime d)) l)))))
+               '() boot-cache-table)))
+
+(define (boot-cache-load)
+  (let ((cached (false-if-exception
+                 (and (file-exists? boot-cache-file)
+                      (call-with-input-file boot-cache-file read))))
+        (valid (make-hash-table 127)))
+    (if (and (list? cached) (= (length cached) 3)
+             (equal? (car cached) (boot-cache-stamp)))
+        (begin
+          (for-each (lambda (d)
+                      (if (equal? (cdr d) (boot-cache-mtime (car d)))
+                          (hash-set! valid (car d) #t)))
+                    (caddr cached))
+          (for-each (lambda (x)
+                      (if (hash-ref valid (dirname (cdr x)))
+                          (hash-set! boot-cache-table (car x) (cdr x))
+                          (set! boot-cache-changed? #t)))
+                    (cadr cached))))))
+
+(define (boot-cache-save)
+  (if boot-cache-changed?
+      (false-if-exception
+       (with-output-to-file boot-cache-file
+         (lambda ()
+           (write (list (boot-cache-stamp)
+                        (hash-fold (lambda (k v l) (cons (cons k v) l))
+                                   '() boot-cache-table)
+                        (boot-cache-dirs)))))))
+  (set! boot-cache-changed? #f))
+
+(define boot-search-load-path %search-load-path)
+(define (cached-search-load-path name)
+  (let ((hit (hash-ref boot-cache-table name)))
+    (if (and hit (file-exists? hit)) hit
+        (let ((r (boot-search-load-path name)))
+          (if r (begin
+                  (hash-set! boot-cache-table name r)
+                  (set! boot-cache-changed? #t)))
+          r))))
+
+(boot-cache-load)
+(set! %search-load-path cached-search-load-path)
 
 ;;(debug-enable 'backtrace 'debug)
 ;; (define load-indent 0)
@@ -454,5 +525,6 @@
 
 ;(display "------------------------------------------------------\n")
 (delayed (:idle 10000) (autosave-delayed))
+(boot-cache-save)
 (texmacs-banner)
 ;(display "Initialization done\n")
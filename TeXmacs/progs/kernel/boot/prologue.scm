@@ -24,10 +24,10 @@
   (let* ((aux (lambda (s) (string-append "/" (symbol->string s))))
 	 (name* (apply string-append (map aux module)))
 	 (name (substring name* 1 (string-length name*)))
-	 (u (url-unix "$GUILE_LOAD_PATH" (string-append name ".scm")))
-	 ;; FIXME: should use %load-path instead of $GUILE_LOAD_PATH
-	 )
-    (url-materialize u "r")))
+	 (file (%search-load-path (string-append name ".scm"))))
+    (or file
+        (url-materialize (url-unix "$GUILE_LOAD_PATH"
+                                   (string-append name ".scm")) "r"))))
 
 (define-public (module-load module*)
   (if (list? module*)
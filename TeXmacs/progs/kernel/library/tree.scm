@@ -110,9 +110,7 @@
 
 (define-public (tree-inside? t ref)
   "Is @t inside @ref?"
-  (let ((p (tree->path ref))
-	(q (tree->path t)))
-    (and p q (list-starts? q p))))
+  (and (tree? t) (tree? ref) (tree-within? t ref)))
 
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
 ;; Cursor related trees
@@ -194,6 +194,8 @@
 "tree-child-insert"
 "tree-ip"
 "tree-active?"
+"tree-within?"
+"tree-precedes?"
 "tree-eq?"
 "subtree"
 "tree-range"
@@ -581,6 +583,10 @@
 "connection-eval"
 "connection-interrupt"
 "connection-stop"
+"connection-eval-async"
+"connection-async-cancel"
+"connection-async-status"
+"connection-async-result"
 "widget-printer"
 "widget-color-picker"
 "widget-extend"
@@ -193,12 +193,18 @@
               (toggle ("Expand beamer slides" "texmacs->pdf:expand slides"))
 	      (toggle ("Distill encapsulated Pdf files" "texmacs->pdf:distill inclusion"))
 	      (toggle ("Check exported files" "texmacs->pdf:check"))
+	      (toggle ("Cache converted images" "image conversion cache"))
 	      (enum ("Pdf version" "texmacs->pdf:version")
 		    ("Default" "default")
 		    ("1.4" "1.4")
 		    ("1.5" "1.5")
 		    ("1.6" "1.6")
-		    ("1.7" "1.7")))))
+		    ("1.7" "1.7"))
+	      (enum ("Export threads" "texmacs->pdf:threads")
+		    ("1" "1")
+		    ("2" "2")
+		    ("4" "4")
+		    ("8" "8")))))
     (-> "Mathematics"
         (-> "Keyboard"
             (item ("Enforce brackets to match" (toggle-matching-brackets)))
@@ -485,7 +485,11 @@
       (aligned (item (text "Pdf version number:")
         (enum (set-preference "texmacs->pdf:version" answer)
 	      '("default" "1.4" "1.5" "1.6" "1.7")
-	      (get-preference "texmacs->pdf:version") "8em")))))
+	      (get-preference "texmacs->pdf:version") "8em")))
+      (aligned (item (text "Threads for Pdf export:")
+        (enum (set-preference "texmacs->pdf:threads" answer)
+	      '("1" "2" "4" "8")
+	      (get-preference "texmacs->pdf:threads") "8em")))))
 
 ;; Images ----------
 
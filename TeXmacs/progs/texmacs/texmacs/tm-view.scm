@@ -66,7 +66,8 @@
   ("ir-play" "F5" notify-remote-control)
   ("ir-pause" "escape" notify-remote-control)
   ("ir-menu" "." notify-remote-control)
-  ("draw cursor" "on" noop))
+  ("draw cursor" "on" noop)
+  ("tiled backing store" "on" noop))
 
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
 ;; Changing the view properties
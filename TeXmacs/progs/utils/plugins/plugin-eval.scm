@@ -64,6 +64,27 @@
       ;;(display* "r= " r "\n")
       (plugin-postprocess name ses r (cons :simplify-output opts)))))
 
+(tm-define (plugin-eval-async name ses t call-back . opts)
+  ;; Evaluate t without waiting for the result.  The output is passed in
+  ;; chunks to (call-back doc status), where status is one of "running",
+  ;; "done", "cancelled" or "truncated".  Returns a handle for
+  ;; connection-async-cancel, or 0 if the plugin could not be started.
+  (with u (plugin-preprocess name ses t opts)
+    (connection-eval-async name ses u
+                           (lambda (id doc status)
+                             (call-back (tree->stree doc) status)))))
+
+(tm-define (plugin-eval-into name ses t target . opts)
+  ;; Stream the output of an asynchronous evaluation into the document
+  ;; tree target; each chunk is inserted as a single modification
+  (with call-back (lambda (doc status)
+                     (when (and (tree->path target)
+                                (tree-is? target 'document)
+                                (func? doc 'document)
+                                (nnull? (cdr doc)))
+                       (tree-insert! target (tree-arity target) (cdr doc))))
+    (apply plugin-eval-async (cons* name ses t call-back opts))))
+
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
 ;; New connection management
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
@@ -0,0 +1,164 @@
+
+/******************************************************************************
+* MODULE     : hashmap_bench.cpp
+* DESCRIPTION: Benchmarks of flat hashmaps against chained hashmaps
+* COPYRIGHT  : (C) 2026  the TeXmacs team
+*******************************************************************************
+* This software falls under the GNU general public license version 3 or later.
+* It comes WITHOUT ANY WARRANTY WHATSOEVER. For details, see the file LICENSE
+* in the root directory or <http://www.gnu.org/licenses/gpl-3.0.html>.
+******************************************************************************/
+
+#include <benchmark/benchmark.h>
+#include "hashmap.hpp"
+#include "tree.hpp"
+
+/******************************************************************************
+* The former implementation with separate chaining, as a reference
+******************************************************************************/
+
+template<class T, class U> struct chained_map {
+  int size, n;
+  U   init;
+  list<hashentry<T,U> >* a;
+
+  chained_map (U init2):
+    size (0), n (1), init (init2),
+    a (tm_new_array<list<hashentry<T,U> > > (1)) {}
+  ~chained_map () { tm_delete_array (a); }
+
+  void resize (int n2) {
+    list<hashentry<T,U> >* olda= a;
+    int oldn= n;
+    n= n2;
+    a= tm_new_array<list<hashentry<T,U> > > (n);
+    for (int i=0; i<oldn; i++)
+      for (list<hashentry<T,U> > l= olda[i]; !is_nil (l); l= l->next) {
+        list<hashentry<T,U> >& newl= a[l->item.code & (n-1)];
+        newl= list<hashentry<T,U> > (l->item, newl);
+      }
+    tm_delete_array (olda);
+  }
+
+  U& operator () (T x) {
+    int hv= hash (x);
+    for (list<hashentry<T,U> > l= a[hv & (n-1)]; !is_nil (l); l= l->next)
+      if (l->item.code == hv && l->item.key == x) return l->item.im;
+    if (size >= n) resize (n<<1);
+    list<hashentry<T,U> >& rl= a[hv & (n-1)];
+    rl= list<hashentry<T,U> > (hashentry<T,U> (hv, x, init), rl);
+    size++;
+    return rl->item.im;
+  }
+
+  U operator [] (T x) {
+    int hv= hash (x);
+    for (list<hashentry<T,U> > l= a[hv & (n-1)]; !is_nil (l); l= l->next)
+      if (l->item.code == hv && l->item.key == x) return l->item.im;
+    return init;
+  }
+};
+
+/******************************************************************************
+* Keys
+******************************************************************************/
+
+static array<string>
+string_keys (int n) {
+  array<string> r (n);
+  for (int i=0; i<n; i++) r[i]= "key-" * as_string (i);
+  return r;
+}
+
+static array<tree>
+tree_keys (int n, bool interned) {
+  array<tree> r (n);
+  for (int i=0; i<n; i++) {
+    tree t (DOCUMENT);
+    for (int j=0; j<32; j++)
+      t << tree (CONCAT, as_string (32*i + j),
+                 tree (WITH, "color", "red", "x"));
+    r[i]= interned? intern (t): t;
+  }
+  return r;
+}
+
+/******************************************************************************
+* Benchmarks
+******************************************************************************/
+
+static void
+flat_insert_int (benchmark::State& state) {
+  for (auto _ : state) {
+    hashmap<int,int> h (0);
+    for (int i=0; i<state.range (0); i++) h (i * 7)= i;
+    benchmark::DoNotOptimize (N(h));
+  }
+}
+
+static void
+chained_insert_int (benchmark::State& state) {
+  for (auto _ : state) {
+    chained_map<int,int> h (0);
+    for (int i=0; i<state.range (0); i++) h (i * 7)= i;
+    benchmark::DoNotOptimize (h.size);
+  }
+}
+
+static void
+flat_lookup_string (benchmark::State& state) {
+  array<string> keys= string_keys (state.range (0));
+  hashmap<string,int> h (0);
+  for (int i=0; i<N(keys); i++) h (keys[i])= i;
+  for (auto _ : state)
+    for (int i=0; i<N(keys); i++)
+      benchmark::DoNotOptimize (h[keys[i]]);
+}
+
+static void
+chained_lookup_string (benchmark::State& state) {
+  array<string> keys= string_keys (state.range (0));
+  chained_map<string,int> h (0);
+  for (int i=0; i<N(keys); i++) h (keys[i])= i;
+  for (auto _ : state)
+    for (int i=0; i<N(keys); i++)
+      benchmark::DoNotOptimize (h[keys[i]]);
+}
+
+static void
+flat_lookup_tree (benchmark::State& state) {
+  array<tree> keys= tree_keys (state.range (0), false);
+  hashmap<tree,int> h (0);
+  for (int i=0; i<N(keys); i++) h (keys[i])= i;
+  for (auto _ : state)
+    for (int i=0; i<N(keys); i++)
+      benchmark::DoNotOptimize (h[keys[i]]);
+}
+
+static void
+flat_lookup_interned_tree (benchmark::State& state) {
+  array<tree> keys= tree_keys (state.range (0), true);
+  hashmap<tree,int> h (0);
+  for (int i=0; i<N(keys); i++) h (keys[i])= i;
+  for (auto _ : state)
+    for (int i=0; i<N(keys); i++)
+      benchmark::DoNotOptimize (h[keys[i]]);
+}
+
+static void
+chained_lookup_tree (benchmark::State& state) {
+  array<tree> keys= tree_keys (state.range (0), false);
+  chained_map<tree,int> h (0);
+  for (int i=0; i<N(keys); i++) h (keys[i])= i;
+  for (auto _ : state)
+    for (int i=0; i<N(keys); i++)
+      benchmark::DoNotOptimize (h[keys[i]]);
+}
+
+BENCHMARK (flat_insert_int)->Arg(16)->Arg(1024)->Arg(65536);
+BENCHMARK (chained_insert_int)->Arg(16)->Arg(1024)->Arg(65536);
+BENCHMARK (flat_lookup_string)->Arg(16)->Arg(1024)->Arg(65536);
+BENCHMARK (chained_lookup_string)->Arg(16)->Arg(1024)->Arg(65536);
+BENCHMARK (flat_lookup_tree)->Arg(16)->Arg(1024);
+BENCHMARK (flat_lookup_interned_tree)->Arg(16)->Arg(1024);
+BENCHMARK (chained_lookup_tree)->Arg(16)->Arg(1024);
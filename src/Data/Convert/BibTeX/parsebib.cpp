@@ -14,6 +14,8 @@
 #include "analyze.hpp"
 #include "list.hpp"
 #include "tree_traverse.hpp"
+#include "file.hpp"
+#include "hashset.hpp"
 #include "Bibtex/bibtex_functions.hpp"
 
 static string bib_current_tag= "";
@@ -425,3 +427,173 @@ parse_bib (string s) {
   }
   return r;
 }
+
+/******************************************************************************
+* Indexed access to large bibliographies
+*******************************************************************************
+* When only a few entries of a large .bib file are cited, we avoid parsing
+* the whole file.  A lightweight scan determines the byte ranges of the
+* entries, @string and @preamble blocks, without building any trees.
+* The resulting index is cached on disk, and validated using the size and
+* modification time of the .bib file.  Only the @string and @preamble
+* blocks and the cited entries (with their cross references) are parsed.
+******************************************************************************/
+
+struct bib_index {
+  string stamp;                  // identifies the indexed version of the file
+  hashmap<string,int> entry;     // citation key -> index of first entry
+  array<int> starts, ends;       // byte ranges of the blocks
+  array<int> globals;            // indices of @string and @preamble blocks
+};
+
+static hashmap<string,bib_index*> bib_indices (NULL);
+
+static void
+bib_index_add (bib_index* idx, char kind, string key, int start, int end) {
+  int nr= N(idx->starts);
+  idx->starts << start;
+  idx->ends   << end;
+  if (kind != 'k') idx->globals << nr;
+  else if (!idx->entry->contains (key)) idx->entry (key)= nr;
+}
+
+static void
+bib_index_scan (bib_index* idx, string s, string& out) {
+  int i= 0, n= N(s);
+  while (i < n) {
+    if (s[i] == '%') {
+      while (i < n && s[i] != '\n') i++;
+      continue;
+    }
+    if (s[i] != '@') { i++; continue; }
+    int start= i++;
+    while (i < n && is_space (s[i])) i++;
+    int tstart= i;
+    while (i < n && s[i] != '{' && s[i] != '(' && !is_space (s[i])) i++;
+    string type= locase_all (s (tstart, i));
+    while (i < n && is_space (s[i])) i++;
+    if (i >= n || (s[i] != '{' && s[i] != '(')) continue;
+    char cend= (s[i] == '{'? '}': ')');
+    int body= i+1, depth= 0;
+    for (i= body; i < n; i++) {
+      char c= s[i];
+      if (c == '{') depth++;
+      else if (c == '}') {
+        if (depth == 0 && cend == '}') break;
+        depth--;
+      }
+      else if (c == ')' && cend == ')' && depth == 0) break;
+    }
+    int end= min (i+1, n);
+    i= end;
+    if (type == "comment") continue;
+    char kind= 'k';
+    string key;
+    if (type == "string") kind= 's';
+    else if (type == "preamble") kind= 'p';
+    else {
+      int k= body;
+      while (k < end && is_space (s[k])) k++;
+      int kstart= k;
+      while (k < end && s[k] != ',' && s[k] != cend && !is_space (s[k])) k++;
+      key= s (kstart, k);
+      if (N(key) == 0) continue;
+    }
+    bib_index_add (idx, kind, key, start, end);
+    out << kind << " " << as_string (start) << " " << as_string (end);
+    if (kind == 'k') out << " " << key;
+    out << "\n";
+  }
+}
+
+static bib_index*
+bib_index_read (string stamp, string cached) {
+  int i= 0, n= N(cached);
+  while (i < n && cached[i] != '\n') i++;
+  if (cached (0, i) != stamp) return NULL;
+  bib_index* idx= tm_new<bib_index> ();
+  idx->stamp= stamp;
+  while (++i < n) {
+    int start= i;
+    while (i < n && cached[i] != '\n') i++;
+    array<string> a= tokenize (cached (start, i), " ");
+    if (N(a) < 3 || N(a[0]) != 1) continue;
+    string key= (N(a) > 3? recompose (range (a, 3, N(a)), " "): string (""));
+    bib_index_add (idx, a[0][0], key, as_int (a[1]), as_int (a[2]));
+  }
+  return idx;
+}
+
+static bib_index*
+bib_index_get (url u, string s) {
+  string name= concretize (u);
+  string stamp= name * "\t" * as_string (N(s)) * "\t" *
+                as_string (last_modified (u, false));
+  if (bib_indices->contains (name)) {
+    bib_index* idx= bib_indices [name];
+    if (idx->stamp == stamp) return idx;
+    tm_delete (idx);
+    bib_indices->reset (name);
+  }
+  url cache= url ("$TEXMACS_HOME_PATH/system/cache") *
+             url ("bib-" * as_hexadecimal (hash (name)) * ".idx");
+  string cached;
+  bib_index* idx= NULL;
+  if (!load_string (cache, cached, false))
+    idx= bib_index_read (stamp, cached);
+  if (idx == NULL) {
+    idx= tm_new<bib_index> ();
+    idx->stamp= stamp;
+    string out= stamp * "\n";
+    bib_index_scan (idx, s, out);
+    (void) save_string (cache, out, false);
+  }
+  bib_indices (name)= idx;
+  return idx;
+}
+
+static void
+bib_crossrefs (tree t, array<string>& keys) {
+  for (int i=0; i<N(t); i++)
+    if (is_compound (t[i], "bib-entry", 3) && is_func (t[i][2], DOCUMENT)) {
+      tree doc= t[i][2];
+      for (int j=0; j<N(doc); j++)
+        if (is_compound (doc[j], "bib-field", 2) && doc[j][0] == "crossref")
+          keys << as_string (doc[j][1]);
+    }
+}
+
+tree
+parse_bib_entries (url u, tree bib_t) {
+  // parse only the entries of u which are cited in bib_t
+  string s;
+  if (load_string (u, s, false)) return tree ();
+  bib_index* idx= bib_index_get (u, s);
+  string sub;
+  for (int i=0; i<N(idx->globals); i++) {
+    int k= idx->globals[i];
+    sub << s (idx->starts[k], idx->ends[k]) << "\n";
+  }
+  hashset<string> done;
+  array<string> keys;
+  for (int i=0; i<arity (bib_t); i++)
+    keys << as_string (bib_t[i]);
+  tree t;
+  while (N(keys) > 0) {
+    for (int i=0; i<N(keys); i++)
+      if (!done->contains (keys[i]) && idx->entry->contains (keys[i])) {
+        int k= idx->entry [keys[i]];
+        sub << s (idx->starts[k], idx->ends[k]) << "\n";
+        done->insert (keys[i]);
+      }
+    t= parse_bib (sub);
+    array<string> refs;
+    bib_crossrefs (t, refs);
+    keys= array<string> ();
+    for (int i=0; i<N(refs); i++)
+      if (!done->contains (refs[i]) && idx->entry->contains (refs[i]))
+        keys << refs[i];
+  }
+  if (N(t) == 0) t= tree (DOCUMENT);
+  return bib_entries (t, bib_t);
+}
@@ -12,6 +12,10 @@
 #include "Tex/convert_tex.hpp"
 #include "converter.hpp"
 #include "wencoding.hpp"
+#include "subprocess.hpp"
+#ifndef OS_MINGW
+#include <unistd.h>
+#endif
 
 extern bool textm_class_flag;
 
@@ -73,6 +77,8 @@ struct latex_parser {
                           tree opt= tree (CONCAT));
   tree parse_char_code   (string s, int& i);
 
+  tree parse_piece       (string s);
+  void parse_pieces      (array<string> a, int b, int e, array<tree>& r);
   tree parse             (string s, int change);
 };
 
@@ -1612,6 +1618,147 @@ accented_to_Cork (tree t) {
 * Interface
 ******************************************************************************/
 
+/******************************************************************************
+* Parsing independent pieces in parallel
+*******************************************************************************
+* Once the last macro definition has been encountered, the remaining pieces
+* of a document only read the tables of user commands, and each of them
+* starts in text mode.  Such pieces can therefore be parsed independently.
+* For large documents, we fork worker processes which parse consecutive
+* groups of these pieces and send back the resulting trees through pipes.
+* The last piece is always parsed by the main process, so that the final
+* state of the parser is the same as for a sequential parse.
+******************************************************************************/
+
+#define LATEX_PARALLEL_SIZE 65536
+
+static const char* latex_definers[]= {
+  "\\def", "\\gdef", "\\edef", "\\xdef", "\\let",
+  "\\newcommand", "\\renewcommand", "\\providecommand",
+  "\\newenvironment", "\\renewenvironment", "\\newtheorem",
+  "\\declaretheorem", "\\newlength", "\\newdimen", "\\newskip",
+  "\\newcounter", "\\DeclareMathOperator", "\\DeclareRobustCommand",
+  "\\SetKw", "\\SetKwData", "\\SetKwFunction", "\\SetKwInOut",
+  "\\SetKwInput", "\\usepackage", "\\catcode", "\\makeatletter",
+  "\\input", "\\include", NULL };
+
+static bool
+latex_defines_macros (string s) {
+  int n= N(s);
+  for (int i=0; i<n; i++)
+    if (s[i] == '\\')
+      for (int k=0; latex_definers[k] != NULL; k++)
+        if (test_macro (s, i, latex_definers[k])) return true;
+  return false;
+}
+
+static void
+latex_write_tree (string& out, tree t) {
+  if (is_atomic (t))
+    out << "a" << as_string (N(t->label)) << ":" << t->label;
+  else {
+    string l= as_string (L(t));
+    out << "c" << as_string (N(l)) << ":" << l << as_string (N(t)) << ":";
+    for (int i=0; i<N(t); i++)
+      latex_write_tree (out, t[i]);
+  }
+}
+
+static bool
+latex_read_int (string s, int& i, int& r) {
+  int n= N(s), start= i;
+  while (i<n && is_digit (s[i])) i++;
+  if (i == start || i >= n || s[i] != ':') return false;
+  r= as_int (s (start, i++));
+  return true;
+}
+
+static bool
+latex_read_tree (string s, int& i, tree& t) {
+  int n= N(s), len, arity;
+  if (i >= n || (s[i] != 'a' && s[i] != 'c')) return false;
+  bool atomic= (s[i++] == 'a');
+  if (!latex_read_int (s, i, len) || i + len > n) return false;
+  string l= s (i, i + len);
+  i += len;
+  if (atomic) { t= l; return true; }
+  if (!latex_read_int (s, i, arity)) return false;
+  t= tree (make_tree_label (l), arity);
+  for (int k=0; k<arity; k++)
+    if (!latex_read_tree (s, i, t[k])) return false;
+  return true;
+}
+
+tree
+latex_parser::parse_piece (string s) {
+  // parse a piece of a document, starting in text mode
+  tree r (TUPLE);
+  int j=0;
+  while (j<N(s)) {
+    int start= j;
+    command_type ("!mode") = "text";
+    command_type ("!em") = "false";
+    r << parse (s, j, "", 2);
+    if (j == start) j++;
+  }
+  return r;
+}
+
+void
+latex_parser::parse_pieces (array<string> a, int b, int e, array<tree>& r) {
+  int i, p= e - 1, size= 0;
+  if (e <= b) return;
+  while (p > b && !latex_defines_macros (a[p-1])) size += N(a[--p]);
+  for (i=b; i<p; i++) r << parse_piece (a[i]);
+  if (p >= e) return;
+#ifndef OS_MINGW
+  int workers= min (e - 1 - p, (int) sysconf (_SC_NPROCESSORS_ONLN));
+  if (size >= LATEX_PARALLEL_SIZE && workers >= 2) {
+    array<int> pids, fds, ends;
+    convert_error.flush ();
+    for (int w=0; w<workers; w++) {
+      int wb= p + (w * (e - 1 - p)) / workers;
+      int we= p + ((w + 1) * (e - 1 - p)) / workers;
+      int fd;
+      int pid= subprocess_fork (fd);
+      if (pid == 0) {
+        string out;
+        for (i=wb; i<we; i++) latex_write_tree (out, parse_piece (a[i]));
+        convert_error.flush ();
+        subprocess_exit (fd, subprocess_write (fd, out));
+      }
+      // if we could not fork, then the remaining pieces are parsed below
+      if (pid < 0) break;
+      pids << pid; fds << fd; ends << we;
+    }
+    array<string> ins;
+    array<bool> oks;
+    subprocess_collect (pids, fds, ins, oks);
+    array<tree> rw;
+    int done= p;
+    for (int w=0; w<N(pids); w++) {
+      bool ok= oks[w];
+      int k= 0;
+      for (i=done; ok && i<ends[w]; i++) {
+        tree u;
+        ok= latex_read_tree (ins[w], k, u) && is_tuple (u);
+        if (ok) rw << u;
+      }
+      if (!ok) {
+        // the worker failed: parse its pieces again
+        rw= range (rw, 0, done - p);
+        for (i=done; i<ends[w]; i++) rw << parse_piece (a[i]);
+      }
+      done= ends[w];
+    }
+    r << rw;
+    for (i=p + N(rw); i<e; i++) r << parse_piece (a[i]);
+    return;
+  }
+#endif
+  for (i=p; i<e; i++) r << parse_piece (a[i]);
+}
+
 tree
 latex_parser::parse (string s, int change) {
   command_type ->extend ();
@@ -1689,20 +1836,16 @@ latex_parser::parse (string s, int change) {
   a << s (start, i);
 
   // We now parse each of the pieces
+  array<tree> r;
+  parse_pieces (a, 0, N(a), r);
   tree t (CONCAT);
-  for (i=0; i<N(a); i++) {
-    int j=0;
-    while (j<N(a[i])) {
-      int start= j;
-      command_type ("!mode") = "text";
-      command_type ("!em") = "false";
-      tree u= parse (a[i], j, "", 2);
-      if ((N(t)>0) && (t[N(t)-1]!='\n') && (start==0)) t << "\n";
+  for (i=0; i<N(r); i++)
+    for (int k=0; k<N(r[i]); k++) {
+      tree u= r[i][k];
+      if ((N(t)>0) && (t[N(t)-1]!='\n') && (k==0)) t << "\n";
       if (is_concat (u)) t << A(u);
       else t << u;
-      if (j == start) j++;
     }
-  }
 
   if (change > 0) {
     command_type ->merge ();
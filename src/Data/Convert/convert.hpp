@@ -100,6 +100,7 @@ tree   upgrade_mathml (tree t);
 
 /*** BibTeX ***/
 tree   parse_bib (string s);
+tree   parse_bib_entries (url bib_file, tree bib_t);
 tree   conservative_bib_import (string olds, tree oldt, string news);
 string conservative_bib_export (tree oldt, string olds, tree newt);
 
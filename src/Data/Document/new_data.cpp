@@ -56,7 +56,8 @@ detach_data (tree doc, new_data& data) {
   data->style  = extract (doc, "style");
   data->init   = hashmap<string,tree> (UNINIT, extract (doc, "initial"));
   data->fin    = hashmap<string,tree> (UNINIT, extract (doc, "final"));
-  data->ref    = hashmap<string,tree> (UNINIT, extract (doc, "references"));
+  data->ref    = hashmap<string,tree> (UNINIT,
+                                      intern (extract (doc, "references")));
   data->aux    = hashmap<string,tree> (UNINIT, extract (doc, "auxiliary"));
   data->att    = hashmap<string,tree> (UNINIT, extract (doc, "attachments"));
   //tree links= extract (doc, "links");
@@ -19,16 +19,23 @@
 * Compact representation for environment changes
 ******************************************************************************/
 
-static hashmap<tree,int> encode_table (-1);
-static array<tree>       decode_table;
+static hashmap<pointer,int> encode_table (-1);  // interned tree -> code
+static array<tree>          decode_table;
 
 int
 drd_encode (tree t) {
-  if (encode_table->contains (t))
-    return encode_table[t];
+  // the representatives are kept alive by decode_table, so that a tree
+  // with the same address as one of them can only be that representative
+  pointer p= (pointer) inside (t);
+  if (encode_table->contains (p))
+    return encode_table[p];
+  t= intern (t);
+  p= (pointer) inside (t);
+  if (encode_table->contains (p))
+    return encode_table[p];
   int n= N(decode_table);
   ASSERT (n < (1 << 16), "drd_encode overflow");
-  encode_table (t) = n;
+  encode_table (p) = n;
   decode_table << t;
   return n;
 }
@@ -6,6 +6,9 @@
 *******************************************************************************
 * An inverse path observer maintains the inverse path of the position
 * of the corresponding tree with respect to the global meta-tree.
+* Once positions have been compared, the inverse path observers of
+* the meta-tree also carry order labels for the start and the end of
+* their trees, which are maintained along with the modifications.
 *******************************************************************************
 * This software falls under the GNU general public license version 3 or later.
 * It comes WITHOUT ANY WARRANTY WHATSOEVER. For details, see the file LICENSE
@@ -13,6 +16,7 @@
 ******************************************************************************/
 
 #include "modification.hpp"
+#include "order_list.hpp"
 
 #define DETACHED (-5)
 extern tree the_et;
@@ -23,8 +27,10 @@ extern tree the_et;
 
 class ip_observer_rep: public observer_rep {
   path ip;
+  order_item open, close;  // order labels when attached to the meta-tree
 public:
-  ip_observer_rep (path ip2): ip (ip2) {}
+  ip_observer_rep (path ip2): ip (ip2), open (NULL), close (NULL) {}
+  ~ip_observer_rep () { (void) set_order (NULL, NULL); }
   int get_type () { return OBSERVER_IP; }
   tm_ostream& print (tm_ostream& out) { return out << " " << ip; }
 
@@ -46,8 +52,61 @@ public:
 
   bool get_ip (path& ip);
   bool set_ip (path ip);
+  bool get_order (order_item& open, order_item& close);
+  bool set_order (order_item open, order_item close);
 };
 
+/******************************************************************************
+* Order labels
+******************************************************************************/
+
+static bool order_active= false;
+
+static bool
+order_get (tree& t, order_item& open, order_item& close) {
+  open= close= NULL;
+  return !is_nil (t->obs) && t->obs->get_order (open, close) && open != NULL;
+}
+
+static order_item
+order_label (tree& t, order_item pred) {
+  // label t and its descendants right after pred and return the last label
+  order_item open= order_new (pred), last= open;
+  if (is_compound (t))
+    for (int i=0; i<N(t); i++)
+      last= order_label (t[i], last);
+  order_item close= order_new (last);
+  if (!is_nil (t->obs) && t->obs->set_order (open, close)) return close;
+  order_delete (open);
+  order_delete (close);
+  return last;
+}
+
+static order_item
+order_before (tree& ref, int pos) {
+  // the label after which the labels of ref[pos] should be inserted
+  order_item open, close;
+  if (pos > 0 && order_get (ref[pos-1], open, close)) return close;
+  if (order_get (ref, open, close)) return open;
+  return NULL;
+}
+
+static void
+order_forget (tree& t) {
+  if (!is_nil (t->obs)) (void) t->obs->set_order (NULL, NULL);
+}
+
+static void
+order_unlabel (tree& t) {
+  // forget the labels of t and its descendants, which are being removed
+  order_item open, close;
+  if (!order_get (t, open, close)) return;
+  order_forget (t);
+  if (is_compound (t))
+    for (int i=0; i<N(t); i++)
+      order_unlabel (t[i]);
+}
+
 /******************************************************************************
 * Call back routines for announcements
 ******************************************************************************/
@@ -91,31 +150,39 @@ ip_observer_rep::touched (tree& ref, path p) {
 void
 ip_observer_rep::notify_assign (tree& ref, tree t) {
   // cout << "Notify assign " << ref << ", " << t << "\n";
+  order_item pred= (open == NULL? (order_item) NULL: open->prev);
+  if (pred != NULL) order_unlabel (ref);
   path temp_ip= obtain_ip (ref);
   temp_ip= path (temp_ip->item, temp_ip->next); // prevents overriding temp_ip
   detach_ip (ref);
   attach_ip (t, temp_ip);
+  if (pred != NULL) (void) order_label (t, pred);
 }
 
 void
 ip_observer_rep::notify_insert (tree& ref, int pos, int nr) {
   // cout << "Notify insert " << ref << ", " << pos << ", " << nr << "\n";
-  (void) nr;
   if (is_compound (ref)) {
     int i, n= N(ref);
     for (i=pos; i<n; i++)
       attach_ip (ref[i], path (i, ip));
+    if (open != NULL) {
+      order_item pred= order_before (ref, pos);
+      for (i=pos; i<pos+nr; i++)
+        pred= order_label (ref[i], pred);
+    }
   }
 }
 
 void
 ip_observer_rep::notify_remove (tree& ref, int pos, int nr) {
   // cout << "Notify remove " << ref << ", " << pos << ", " << nr << "\n";
-  (void) nr;
   if (is_compound (ref)) {
     int i, n= N(ref);
-    for (i=pos; i<(pos+nr); i++)
+    for (i=pos; i<(pos+nr); i++) {
+      if (open != NULL) order_unlabel (ref[i]);
       detach_ip (ref[i]);
+    }
     for (; i<n; i++)
       attach_ip (ref[i], path (i-nr, ip));
   }
@@ -128,6 +195,12 @@ ip_observer_rep::notify_split (tree& ref, int pos, tree prev) {
   detach_ip (prev);
   for (i=pos; i<n; i++)
     attach_ip (ref[i], path (i, ip));
+  if (open != NULL) {
+    order_item pred= order_before (ref, pos);
+    pred= order_label (ref[pos], pred);
+    (void) order_label (ref[pos+1], pred);
+    order_forget (prev);
+  }
 }
 
 void
@@ -144,6 +217,11 @@ ip_observer_rep::notify_join (tree& ref, int pos, tree next) {
   for (i=pos+2; i<n; i++)
     attach_ip (ref[i], path (i-1, ip));
   attach_ip (next, path (pos, ip));
+  if (open != NULL) {
+    (void) order_label (next, order_before (ref, pos));
+    order_forget (ref[pos]);
+    order_forget (ref[pos+1]);
+  }
 }
 
 void
@@ -163,17 +241,31 @@ ip_observer_rep::notify_insert_node (tree& ref, int pos) {
   ip= path (pos, ip);
   attach_ip (ref[pos], ip); // updates children's ips
   attach_ip (ref, ip->next);
+  if (open != NULL) {
+    int i, n= N(ref);
+    order_item start= order_new (open->prev), pred= start;
+    for (i=0; i<pos; i++) pred= order_label (ref[i], pred);
+    for (pred= close, i=pos+1; i<n; i++) pred= order_label (ref[i], pred);
+    order_item end= order_new (pred);
+    if (is_nil (ref->obs) || !ref->obs->set_order (start, end)) {
+      order_delete (start);
+      order_delete (end);
+    }
+  }
 }
 
 void
 ip_observer_rep::notify_remove_node (tree& ref, int pos) {
   // cout << "Notify remove node " << ref << ", " << pos << "\n";
   for (int i=0; i<N(ref); i++)
-    if (i != pos)
+    if (i != pos) {
+      if (open != NULL) order_unlabel (ref[i]);
       detach_ip (ref[i]);
+    }
   if ((!is_nil (ip)) && (ip->item>=0)) attach_ip (ref[pos], ip);
   else detach_ip (ref[pos]);
   ip= DETACHED; // detach_ip (ref);
+  (void) set_order (NULL, NULL);
 }
 
 void
@@ -200,6 +292,22 @@ ip_observer_rep::set_ip (path ip2) {
   return true;
 }
 
+bool
+ip_observer_rep::get_order (order_item& open2, order_item& close2) {
+  open2= open;
+  close2= close;
+  return true;
+}
+
+bool
+ip_observer_rep::set_order (order_item open2, order_item close2) {
+  if (open  != NULL) order_delete (open);
+  if (close != NULL) order_delete (close);
+  open = open2;
+  close= close2;
+  return true;
+}
+
 void
 attach_ip (tree& ref, path ip) {
   // cout << "Set ip of " << ref << " to " << ip << "\n";
@@ -221,6 +329,7 @@ attach_ip (tree& ref, path ip) {
 void
 detach_ip (tree& ref) {
   // cout << "Detach ip of " << ref << "\n";
+  if (order_active) order_unlabel (ref);
   if (!is_nil (ref->obs))
     (void) ref->obs->set_ip (DETACHED);
 }
@@ -247,6 +356,68 @@ ip_attached (path ip) {
   return is_nil (ip) || last_item (ip) != DETACHED;
 }
 
+/******************************************************************************
+* Comparing positions in the meta-tree
+******************************************************************************/
+
+static bool
+order_activate () {
+  // label the whole meta-tree the first time that positions are compared
+  if (!order_active && !is_nil (the_et->obs)) {
+    order_active= true;
+    (void) order_label (the_et, order_first ());
+  }
+  return order_active;
+}
+
+bool
+tree_attached (tree& t) {
+  order_item open, close;
+  if (order_active && order_get (t, open, close)) return true;
+  return ip_attached (obtain_ip (t));
+}
+
+static int
+compare_ips (path ip1, path ip2) {
+  // compare the positions of the subtrees with inverse paths ip1 and ip2,
+  // with -1 if the first one comes first, 1 if it comes last and
+  // 2 if the first one is a strict ancestor of the second one
+  path p1= reverse (ip1), p2= reverse (ip2);
+  while (!is_nil (p1) && !is_nil (p2) && p1->item == p2->item) {
+    p1= p1->next;
+    p2= p2->next;
+  }
+  if (is_nil (p1)) return is_nil (p2)? 0: 2;
+  if (is_nil (p2)) return 1;
+  return p1->item < p2->item? -1: 1;
+}
+
+bool
+tree_precedes (tree& t1, tree& t2) {
+  // does t1 end before t2 starts in the meta-tree?  This is the analogue
+  // of path_inf for the paths of t1 and t2.
+  order_item open1, close1, open2, close2;
+  if (order_activate () &&
+      order_get (t1, open1, close1) && order_get (t2, open2, close2))
+    return order_less (close1, open2);
+  path ip1= obtain_ip (t1), ip2= obtain_ip (t2);
+  if (!ip_attached (ip1) || !ip_attached (ip2)) return false;
+  return compare_ips (ip1, ip2) == -1;
+}
+
+bool
+tree_inside (tree& t, tree& anc) {
+  // is t a (not necessarily strict) descendant of anc in the meta-tree?
+  order_item open1, close1, open2, close2;
+  if (order_activate () &&
+      order_get (t, open1, close1) && order_get (anc, open2, close2))
+    return !order_less (open1, open2) && !order_less (close2, close1);
+  path ip1= obtain_ip (t), ip2= obtain_ip (anc);
+  if (!ip_attached (ip1) || !ip_attached (ip2)) return false;
+  int cmp= compare_ips (ip2, ip1);
+  return cmp == 0 || cmp == 2;
+}
+
 /******************************************************************************
 * Setting and getting inverse paths
 ******************************************************************************/
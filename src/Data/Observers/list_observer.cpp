@@ -52,6 +52,8 @@ public:
 
   bool get_ip (path& ip);
   bool set_ip (path ip);
+  bool get_order (order_item_rep*& open, order_item_rep*& close);
+  bool set_order (order_item_rep* open, order_item_rep* close);
   bool get_position (tree& t, int& index);
   bool set_position (tree t, int index);
   observer& get_child (int which);
@@ -176,6 +178,18 @@ list_observer_rep::set_ip (path ip) {
          (!is_nil (o2) && o2->set_ip (ip));
 }
 
+bool
+list_observer_rep::get_order (order_item_rep*& open, order_item_rep*& close) {
+  return (!is_nil (o1) && o1->get_order (open, close)) |
+         (!is_nil (o2) && o2->get_order (open, close));
+}
+
+bool
+list_observer_rep::set_order (order_item_rep* open, order_item_rep* close) {
+  return (!is_nil (o1) && o1->set_order (open, close)) |
+         (!is_nil (o2) && o2->set_order (open, close));
+}
+
 bool
 list_observer_rep::get_position (tree& t, int& index) {
   return (!is_nil (o1) && o1->get_position (t, index)) |
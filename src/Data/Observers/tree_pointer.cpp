@@ -64,21 +64,21 @@ void
 tree_pointer_rep::announce (tree& ref, modification mod) {
   //cout << "Announce " << mod << "\n";
   (void) ref; link_announce (observer (this), mod);
-  if (N(cb) != 0 && ip_attached (obtain_ip (ref)))
+  if (N(cb) != 0 && tree_attached (ref))
     call (cb, symbol_object ("announce"), ref, mod);
 }
 
 void
 tree_pointer_rep::done (tree& ref, modification mod) {
   //cout << "Done " << mod->p << "\n";
-  if (N(cb) != 0 && ip_attached (obtain_ip (ref)))
+  if (N(cb) != 0 && tree_attached (ref))
     call (cb, symbol_object ("done"), ref, mod);
 }
 
 void
 tree_pointer_rep::touched (tree& ref, path p) {
   //cout << "Touched " << p << "\n";
-  if (N(cb) != 0 && ip_attached (obtain_ip (ref)))
+  if (N(cb) != 0 && tree_attached (ref))
     call (cb, symbol_object ("touched"), ref, p);
 }
 
@@ -24,9 +24,15 @@ RESOURCE_CODE (converter);
 
 void
 operator << (converter c, string str) {
-  int index = 0;
-  while (index < N(str))
-    c->match(str, index);
+  int index = 0, n= N(str);
+  bool* pass= c->pass;
+  while (index < n) {
+    // copy runs of bytes which do not start any key in one go
+    int start= index;
+    while (index < n && pass[(unsigned char) str[index]]) index++;
+    if (index > start) c->output << str (start, index);
+    if (index < n) c->match(str, index);
+  }
 }
 
 string
@@ -67,23 +73,21 @@ converter_rep::has_value(hashtree<char,string> node) {
 
 inline void
 converter_rep::match (string& str, int& index) {
-  int forward = index;
-  int last_match = -1;
-  string value("");
-  bool done = false;
-  hashtree<char,string> node = ht;
-  //cout << "[";
-  while (!done && forward < N(str)) {
-    if (node->contains (str[forward])) {
-      node = node(str[forward]);
-      //printf("->%x",str[forward]);
-      if (has_value(node)) {
-        last_match = forward;
-        value = node->label;
-      }
-      forward++;
+  int forward = index, n= N(str);
+  int last_match = -1, last_value= -1;
+  int state= 0, nr= N(check);
+  int* b= A(base);
+  int* c= A(check);
+  int* v= A(value);
+  while (forward < n) {
+    int next= b[state] + (int) (unsigned char) str[forward];
+    if (next >= nr || c[next] != state) break;
+    state= next;
+    if (v[state] >= 0) {
+      last_match = forward;
+      last_value = v[state];
     }
-    else done = true;
+    forward++;
   }
   if (last_match==-1) {
     if (copy_unmatched)
@@ -91,11 +95,167 @@ converter_rep::match (string& str, int& index) {
     index++;
   }
   else {
-    //printf(":");for(int i = 0; i < N(value);i++) printf("%x ",value[i]);
-    output << value;
+    output << values[last_value];
     index = last_match + 1;
   }
-  //cout << "]";
+}
+
+/******************************************************************************
+* Compilation of the dictionaries into a double-array trie
+******************************************************************************/
+
+void
+converter_rep::use_dictionary (string name, escape_type key_escape,
+                               escape_type val_escape, bool reverse)
+{
+  dic_names << name;
+  dic_modes << (((int) key_escape) + 8 * ((int) val_escape) +
+                (reverse? 64: 0));
+}
+
+void
+converter_rep::compile () {
+  // breadth first traversal of ht, choosing for each state the first base
+  // at which all its transitions fit into the free slots
+  array<hashtree<char,string> > nodes;
+  array<int> states;
+  base= array<int> (256);
+  check= array<int> (256);
+  value= array<int> (256);
+  for (int i=0; i<256; i++) { base[i]= 0; check[i]= -1; value[i]= -1; }
+  check[0]= -2;
+  values= array<string> ();
+  nodes << ht;
+  states << 0;
+  int first_free= 1;
+  for (int k=0; k<N(nodes); k++) {
+    hashtree<char,string> node= nodes[k];
+    int s= states[k];
+    if (has_value (node)) {
+      value[s]= N(values);
+      values << node->label;
+    }
+    array<int> cs;
+    for (int c=0; c<256; c++)
+      if (node->contains ((char) c)) cs << c;
+    if (N(cs) == 0) continue;
+    while (first_free < N(check) && check[first_free] != -1) first_free++;
+    int b= max (first_free - cs[0], 1);
+    while (true) {
+      bool ok= true;
+      for (int i=0; i<N(cs) && ok; i++)
+        ok= b + cs[i] >= N(check) || check[b + cs[i]] == -1;
+      if (ok) break;
+      b++;
+    }
+    int need= b + 256;
+    if (need > N(check)) {
+      int old= N(check), l= max (need, 2 * old);
+      base->resize (l); check->resize (l); value->resize (l);
+      for (int i=old; i<l; i++) { base[i]= 0; check[i]= -1; value[i]= -1; }
+    }
+    base[s]= b;
+    for (int i=0; i<N(cs); i++) {
+      check[b + cs[i]]= s;
+      nodes << node ((char) cs[i]);
+      states << (b + cs[i]);
+    }
+  }
+  int l= N(check);
+  while (l > 1 && check[l-1] == -1) l--;
+  base->resize (l); check->resize (l); value->resize (l);
+  init_pass ();
+}
+
+void
+converter_rep::init_pass () {
+  // bytes without a transition from the root state are copied unchanged
+  for (int c=0; c<256; c++) {
+    int t= base[0] + c;
+    pass[c]= copy_unmatched && (t >= N(check) || check[t] != 0);
+  }
+}
+
+static void
+put_int (string& s, int i) {
+  unsigned int u= (unsigned int) i;
+  s << ((char) (u & 255)) << ((char) ((u >> 8) & 255))
+    << ((char) ((u >> 16) & 255)) << ((char) ((u >> 24) & 255));
+}
+
+static int
+get_int (string s, int& pos) {
+  if (pos + 4 > N(s)) { pos= N(s) + 1; return 0; }
+  unsigned int u=
+    ((unsigned int) (unsigned char) s[pos]) +
+    (((unsigned int) (unsigned char) s[pos+1]) << 8) +
+    (((unsigned int) (unsigned char) s[pos+2]) << 16) +
+    (((unsigned int) (unsigned char) s[pos+3]) << 24);
+  pos += 4;
+  return (int) u;
+}
+
+string
+converter_rep::serialize () {
+  string s;
+  put_int (s, N(check));
+  for (int i=0; i<N(check); i++) {
+    put_int (s, base[i]);
+    put_int (s, check[i]);
+    put_int (s, value[i]);
+  }
+  put_int (s, N(values));
+  for (int i=0; i<N(values); i++) {
+    put_int (s, N(values[i]));
+    s << values[i];
+  }
+  return s;
+}
+
+bool
+converter_rep::unserialize (string s) {
+  int pos= 0, n= get_int (s, pos);
+  if (n <= 0 || pos + 12 * n > N(s)) return false;
+  base= array<int> (n);
+  check= array<int> (n);
+  value= array<int> (n);
+  for (int i=0; i<n; i++) {
+    base[i] = get_int (s, pos);
+    check[i]= get_int (s, pos);
+    value[i]= get_int (s, pos);
+  }
+  int nv= get_int (s, pos);
+  if (nv < 0 || pos + 4 * nv > N(s)) return false;
+  values= array<string> (nv);
+  for (int i=0; i<nv; i++) {
+    int l= get_int (s, pos);
+    if (l < 0 || pos + l > N(s)) return false;
+    values[i]= s (pos, pos + l);
+    pos += l;
+  }
+  if (pos != N(s)) return false;
+  for (int i=0; i<n; i++)
+    if (value[i] >= nv || base[i] < 0 ||
+        (check[i] >= 0 && check[i] >= n)) return false;
+  init_pass ();
+  return true;
+}
+
+static string
+dictionary_stamp (array<string> names, array<int> modes) {
+  string r= "converter-1";
+  for (int i=0; i<N(names); i++) {
+    url u ("$TEXMACS_PATH/langs/encoding", names[i] * ".scm");
+    r << ";" << names[i] << ":" << as_string (modes[i])
+      << ":" << as_string (last_modified (u, false));
+  }
+  return r;
+}
+
+static url
+compiled_dictionary_file (string from, string to) {
+  string name= "converter-" * from * "-" * to * ".bin";
+  return url ("$TEXMACS_HOME_PATH/system/cache") * url (name);
 }
 
 void
@@ -104,108 +264,106 @@ converter_rep::load () {
   // to be done here than just loading a file.
   // cout << "TeXmacs] load converter " << from << " -> " << to << "\n";
   if (from=="Cork" && to=="UTF-8" ) {
-    hashtree<char,string> dic;
-    hashtree_from_dictionary (dic,"corktounicode", BIT2BIT, UTF8, false);
-    hashtree_from_dictionary (dic,"cork-unicode-oneway", BIT2BIT, UTF8, false);
-    hashtree_from_dictionary (dic,"tmuniversaltounicode", BIT2BIT, UTF8, false);
-    hashtree_from_dictionary (dic,"symbol-unicode-oneway", BIT2BIT, UTF8, false);
-    hashtree_from_dictionary (dic,"symbol-unicode-fallback", BIT2BIT, UTF8, false);
-    hashtree_from_dictionary (dic,"symbol-unicode-math", BIT2BIT, UTF8, false);
-    ht = dic;
+    use_dictionary ("corktounicode", BIT2BIT, UTF8, false);
+    use_dictionary ("cork-unicode-oneway", BIT2BIT, UTF8, false);
+    use_dictionary ("tmuniversaltounicode", BIT2BIT, UTF8, false);
+    use_dictionary ("symbol-unicode-oneway", BIT2BIT, UTF8, false);
+    use_dictionary ("symbol-unicode-fallback", BIT2BIT, UTF8, false);
+    use_dictionary ("symbol-unicode-math", BIT2BIT, UTF8, false);
   }
   else if (from=="UTF-8" && to=="Cork") {
-    hashtree<char,string> dic;
-    hashtree_from_dictionary (dic,"corktounicode", UTF8, BIT2BIT, true);
-    hashtree_from_dictionary (dic,"unicode-cork-oneway", UTF8, BIT2BIT, false);
-    hashtree_from_dictionary (dic,"tmuniversaltounicode", UTF8, BIT2BIT, true);
-    hashtree_from_dictionary (dic,"unicode-symbol-oneway", UTF8, BIT2BIT, true);
-    ht = dic;
+    use_dictionary ("corktounicode", UTF8, BIT2BIT, true);
+    use_dictionary ("unicode-cork-oneway", UTF8, BIT2BIT, false);
+    use_dictionary ("tmuniversaltounicode", UTF8, BIT2BIT, true);
+    use_dictionary ("unicode-symbol-oneway", UTF8, BIT2BIT, true);
   }
   if (from=="Strict-Cork" && to=="UTF-8" ) {
-    hashtree<char,string> dic;
-    hashtree_from_dictionary (dic,"corktounicode", BIT2BIT, UTF8, false);
-    hashtree_from_dictionary (dic,"cork-unicode-oneway", BIT2BIT, UTF8, false);
-    hashtree_from_dictionary (dic,"tmuniversaltounicode", BIT2BIT, UTF8, false);
-    hashtree_from_dictionary (dic,"symbol-unicode-oneway", BIT2BIT, UTF8, false);
-    hashtree_from_dictionary (dic,"symbol-unicode-math", BIT2BIT, UTF8, false);
-    ht = dic;
+    use_dictionary ("corktounicode", BIT2BIT, UTF8, false);
+    use_dictionary ("cork-unicode-oneway", BIT2BIT, UTF8, false);
+    use_dictionary ("tmuniversaltounicode", BIT2BIT, UTF8, false);
+    use_dictionary ("symbol-unicode-oneway", BIT2BIT, UTF8, false);
+    use_dictionary ("symbol-unicode-math", BIT2BIT, UTF8, false);
   }
   else if (from=="UTF-8" && to=="HTML") {
-    hashtree<char,string> dic;
-    hashtree_from_dictionary (dic, "HTMLlat1"   , CHAR_ENTITY, ENTITY_NAME, true);
-    hashtree_from_dictionary (dic, "HTMLspecial", CHAR_ENTITY, ENTITY_NAME, true);
-    hashtree_from_dictionary (dic, "HTMLsymbol" , CHAR_ENTITY, ENTITY_NAME, true);
-    ht = dic;
+    use_dictionary ("HTMLlat1"   , CHAR_ENTITY, ENTITY_NAME, true);
+    use_dictionary ("HTMLspecial", CHAR_ENTITY, ENTITY_NAME, true);
+    use_dictionary ("HTMLsymbol" , CHAR_ENTITY, ENTITY_NAME, true);
   }
   else if (from=="T2A" && to=="UTF-8" ) {
-    hashtree<char,string> dic;
-    hashtree_from_dictionary (dic,"corktounicode", BIT2BIT, UTF8, false);
-    hashtree_from_dictionary (dic,"cork-unicode-oneway", BIT2BIT, UTF8, false);
-    hashtree_from_dictionary (dic,"tmuniversaltounicode", BIT2BIT, UTF8, false);
-    hashtree_from_dictionary (dic,"symbol-unicode-oneway", BIT2BIT, UTF8, false);
-    hashtree_from_dictionary (dic,"symbol-unicode-fallback", BIT2BIT, UTF8, false);
-    hashtree_from_dictionary (dic,"symbol-unicode-math", BIT2BIT, UTF8, false);
-    hashtree_from_dictionary (dic,"t2atounicode", BIT2BIT, UTF8, false);
-    ht = dic;
+    use_dictionary ("corktounicode", BIT2BIT, UTF8, false);
+    use_dictionary ("cork-unicode-oneway", BIT2BIT, UTF8, false);
+    use_dictionary ("tmuniversaltounicode", BIT2BIT, UTF8, false);
+    use_dictionary ("symbol-unicode-oneway", BIT2BIT, UTF8, false);
+    use_dictionary ("symbol-unicode-fallback", BIT2BIT, UTF8, false);
+    use_dictionary ("symbol-unicode-math", BIT2BIT, UTF8, false);
+    use_dictionary ("t2atounicode", BIT2BIT, UTF8, false);
   }  
   else if (from=="UTF-8" && to=="T2A" ) {
-    hashtree<char,string> dic;
-    hashtree_from_dictionary (dic,"corktounicode", UTF8, BIT2BIT, true);
-    hashtree_from_dictionary (dic,"unicode-cork-oneway", UTF8, BIT2BIT, false);
-    hashtree_from_dictionary (dic,"tmuniversaltounicode", UTF8, BIT2BIT, true);
-    hashtree_from_dictionary (dic,"unicode-symbol-oneway", UTF8, BIT2BIT, true);
-    hashtree_from_dictionary (dic,"t2atounicode", UTF8, BIT2BIT, true);
-    ht = dic;
+    use_dictionary ("corktounicode", UTF8, BIT2BIT, true);
+    use_dictionary ("unicode-cork-oneway", UTF8, BIT2BIT, false);
+    use_dictionary ("tmuniversaltounicode", UTF8, BIT2BIT, true);
+    use_dictionary ("unicode-symbol-oneway", UTF8, BIT2BIT, true);
+    use_dictionary ("t2atounicode", UTF8, BIT2BIT, true);
   }  
   else if (from=="T2A.CY" && to=="CODEPOINT" ) {
-    hashtree<char,string> dic;
-    hashtree_from_dictionary (dic,"t2atounicode", BIT2BIT, CHAR_ENTITY, false);
-    hashtree_from_dictionary (dic,"t2atounicode", CHAR_ENTITY, CHAR_ENTITY, false);
-    ht = dic;
+    use_dictionary ("t2atounicode", BIT2BIT, CHAR_ENTITY, false);
+    use_dictionary ("t2atounicode", CHAR_ENTITY, CHAR_ENTITY, false);
   }
   else if (from=="CODEPOINT" && to=="T2A.CY" ) {
-    hashtree<char,string> dic;
-    hashtree_from_dictionary (dic,"t2atounicode", CHAR_ENTITY, BIT2BIT, true);
-    hashtree_from_dictionary (dic,"t2atounicode", CHAR_ENTITY, CHAR_ENTITY, true);
-    ht = dic;
+    use_dictionary ("t2atounicode", CHAR_ENTITY, BIT2BIT, true);
+    use_dictionary ("t2atounicode", CHAR_ENTITY, CHAR_ENTITY, true);
   }
   else if (from=="UTF-8" && to=="LaTeX" ) {
-    hashtree<char,string> dic;
-    hashtree_from_dictionary (dic,"utf8tolatex", UTF8, BIT2BIT, false);
-    hashtree_from_dictionary (dic,"utf8tolatex-onedir", UTF8, BIT2BIT, false);
-    ht = dic;
+    use_dictionary ("utf8tolatex", UTF8, BIT2BIT, false);
+    use_dictionary ("utf8tolatex-onedir", UTF8, BIT2BIT, false);
   }
   else if (from=="LaTeX" && to=="UTF-8" ) {
-    hashtree<char,string> dic;
-    hashtree_from_dictionary (dic,"utf8tolatex", BIT2BIT, UTF8, true);
-    hashtree_from_dictionary (dic,"utf8tolatex-back", BIT2BIT, UTF8, true);
-    ht = dic;
+    use_dictionary ("utf8tolatex", BIT2BIT, UTF8, true);
+    use_dictionary ("utf8tolatex-back", BIT2BIT, UTF8, true);
   }
   else if (from=="Cork" && to=="ASCII") {
-    hashtree<char,string> dic;
-    hashtree_from_dictionary (dic, "cork-escaped-to-ascii", BIT2BIT, UTF8, false);
-    ht = dic;
+    use_dictionary ("cork-escaped-to-ascii", BIT2BIT, UTF8, false);
   }
   else if (from=="Cork" && to=="SourceCode" ) {
-    hashtree<char,string> dic;
-    hashtree_from_dictionary (dic,"corktounicode", BIT2BIT, UTF8, false);
-      //hashtree_from_dictionary (dic,"cork-unicode-oneway", BIT2BIT, UTF8, false);
-    hashtree_from_dictionary (dic,"tmuniversaltounicode", BIT2BIT, UTF8, false);
-    hashtree_from_dictionary (dic,"symbol-unicode-oneway", BIT2BIT, UTF8, false);
-    hashtree_from_dictionary (dic,"symbol-unicode-fallback", BIT2BIT, UTF8, false);
-    hashtree_from_dictionary (dic,"symbol-unicode-math", BIT2BIT, UTF8, false);
-    hashtree_from_dictionary (dic,"cork-to-real-ascii", BIT2BIT, BIT2BIT, false);
-    ht = dic;
+    use_dictionary ("corktounicode", BIT2BIT, UTF8, false);
+      //use_dictionary ("cork-unicode-oneway", BIT2BIT, UTF8, false);
+    use_dictionary ("tmuniversaltounicode", BIT2BIT, UTF8, false);
+    use_dictionary ("symbol-unicode-oneway", BIT2BIT, UTF8, false);
+    use_dictionary ("symbol-unicode-fallback", BIT2BIT, UTF8, false);
+    use_dictionary ("symbol-unicode-math", BIT2BIT, UTF8, false);
+    use_dictionary ("cork-to-real-ascii", BIT2BIT, BIT2BIT, false);
   }
   else if (from=="SourceCode" && to=="Cork") {
-    hashtree<char,string> dic;
-    hashtree_from_dictionary (dic,"corktounicode", UTF8, BIT2BIT, true);
-    hashtree_from_dictionary (dic,"unicode-cork-oneway", UTF8, BIT2BIT, false);
-    hashtree_from_dictionary (dic,"tmuniversaltounicode", UTF8, BIT2BIT, true);
-    hashtree_from_dictionary (dic,"unicode-symbol-oneway", UTF8, BIT2BIT, true);
-    hashtree_from_dictionary (dic,"cork-to-real-ascii", UTF8, BIT2BIT, true);
-    ht = dic;
+    use_dictionary ("corktounicode", UTF8, BIT2BIT, true);
+    use_dictionary ("unicode-cork-oneway", UTF8, BIT2BIT, false);
+    use_dictionary ("tmuniversaltounicode", UTF8, BIT2BIT, true);
+    use_dictionary ("unicode-symbol-oneway", UTF8, BIT2BIT, true);
+    use_dictionary ("cork-to-real-ascii", UTF8, BIT2BIT, true);
   }
+
+  // reuse the compiled trie from a previous session when possible
+  string stamp= dictionary_stamp (dic_names, dic_modes);
+  url cache= compiled_dictionary_file (from, to);
+  string contents;
+  bool ok= false;
+  if (N(dic_names) > 0 && !load_string (cache, contents, false)) {
+    int l= N(stamp);
+    if (N(contents) > l && contents (0, l) == stamp && contents[l] == '\n')
+      ok= unserialize (contents (l+1, N(contents)));
+  }
+  if (!ok) {
+    for (int i=0; i<N(dic_names); i++) {
+      int mode= dic_modes[i];
+      hashtree_from_dictionary (ht, dic_names[i],
+                                (escape_type) (mode & 7),
+                                (escape_type) ((mode >> 3) & 7),
+                                (mode & 64) != 0);
+    }
+    compile ();
+    if (N(dic_names) > 0)
+      save_string (cache, stamp * "\n" * serialize (), false);
+  }
+  ht= hashtree<char,string> ();
 }
 
 /******************************************************************************
@@ -314,6 +472,10 @@ utf8_to_cork (string input) {
   int start, i, n= N(input);
   string output;
   for (i=0; i<n; ) {
+    if (((unsigned char) input[i]) < 128 && conv->passes (input[i])) {
+      output << input[i++];
+      continue;
+    }
     start= i;
     unsigned int code= decode_from_utf8 (input, i);
     string s= input (start, i);
@@ -331,6 +493,10 @@ sourcecode_to_cork (string input) {
   int start, i, n= N(input);
   string output;
   for (i=0; i<n; ) {
+    if (((unsigned char) input[i]) < 128 && conv->passes (input[i])) {
+      output << input[i++];
+      continue;
+    }
     start= i;
     unsigned int code= decode_from_utf8 (input, i);
     string s= input (start, i);
@@ -399,6 +565,10 @@ utf8_to_t2a (string input) {
   int start, i, n= N(input);
   string output;
   for (i=0; i<n; ) {
+    if (((unsigned char) input[i]) < 128 && conv->passes (input[i])) {
+      output << input[i++];
+      continue;
+    }
     start= i;
     unsigned int code= decode_from_utf8 (input, i);
     string s= input (start, i);
@@ -23,15 +23,29 @@ RESOURCE(converter);
 * The converter class applies a dictionary to a given string.
 * It does so by iterating over a string, finding the longest matching key
 * in the dictionary and replacing the matched substring with the translation.
-* The hashtree and converter classes are used.
+* The dictionaries are first loaded into a hashtree, which is then compiled
+* into a double-array trie: the transition of state s on byte c leads to
+* t = base[s] + c whenever check[t] = s.  Compiled tries are cached on disk.
 ******************************************************************************/
 
 struct converter_rep: rep<converter> {
   hashtree<char,string> ht;
   string output, nil_string, from, to;
   bool copy_unmatched;
+  array<string> dic_names;      // dictionaries, in order of loading
+  array<int>    dic_modes;      // escapes and direction of the dictionaries
+  array<int>    base, check;    // compiled double-array trie
+  array<int>    value;          // index in values or -1 for each state
+  array<string> values;
+  bool pass[256];               // bytes which are always copied unchanged
   void match (string& str, int& index);
+  void use_dictionary (string name, escape_type key_escape,
+                       escape_type val_escape, bool reverse);
   void load ();
+  void compile ();
+  void init_pass ();
+  string serialize ();
+  bool unserialize (string s);
 
 public:
   inline converter_rep(string from2, string to2) : 
@@ -39,6 +53,7 @@ public:
     nil_string(), from(from2), to(to2), copy_unmatched(true) { load(); }
 
   inline bool has_value(hashtree<char,string> node);
+  inline bool passes (char c) { return pass[(unsigned char) c]; }
 
   friend struct converter;
   friend string flush (converter c);
@@ -50,6 +65,9 @@ public:
 * functions that operate on converters
 ******************************************************************************/
   
+// returns the converter between two encodings, which is loaded when needed
+converter load_converter (string from, string to);
+
 // takes a string str and returns its translation. strings contained in the
 // converter are lost in this process. the converter is empty when this
 // method returns.
@@ -11,61 +11,150 @@
 
 #include "fast_search.hpp"
 #include "analyze.hpp"
-#include "iterator.hpp"
+#include "merge_sort.hpp"
 
 /******************************************************************************
-* Subroutines
+* Suffix arrays by induced sorting (SA-IS, Nong, Zhang and Chan 2009)
 ******************************************************************************/
 
-static int
-hash_combine (int c1, int c2, int l) {
-  // FIXME: we should rather compute modulo 2^32 - 1 instead of 2^32,
-  // or modulo some prime number < 2^32, and avoid the cyclicity of period 32
-  int rot= (9 * l) & 31;
-  if (rot == 0) return c1 ^ c2;
-  unsigned int u1= c1;
-  unsigned int u2= c2;
-  unsigned int r2= ((u2 << rot) & 0xffffffff) ^
-                   ((u2 >> (32 - rot)) & 0xffffffff);
-  return (int) (u1 ^ r2);
+#define is_lms(i) ((i) > 0 && t[i] && !t[(i)-1])
+
+static void
+get_buckets (int* s, int n, int k, int* bkt, bool end) {
+  int i, sum= 0;
+  for (i=0; i<=k; i++) bkt[i]= 0;
+  for (i=0; i<n; i++) bkt[s[i]]++;
+  for (i=0; i<=k; i++) {
+    sum += bkt[i];
+    bkt[i]= end? sum: sum - bkt[i];
+  }
 }
 
-static int
-fast_hash (string s) {
-  unsigned int h= 0;
-  for (int i=N(s)-1; i>=0; i--) {
-    h= ((h << 9) & 0xffffffff) ^ ((h >> 23) & 0xffffffff);
-    h= h ^ ((unsigned int) (unsigned char) s[i]);
+static void
+induce_l (bool* t, int* sa, int* s, int* bkt, int n, int k) {
+  get_buckets (s, n, k, bkt, false);
+  for (int i=0; i<n; i++) {
+    int j= sa[i] - 1;
+    if (j >= 0 && !t[j]) sa[bkt[s[j]]++]= j;
+  }
+}
+
+static void
+induce_s (bool* t, int* sa, int* s, int* bkt, int n, int k) {
+  get_buckets (s, n, k, bkt, true);
+  for (int i=n-1; i>=0; i--) {
+    int j= sa[i] - 1;
+    if (j >= 0 && t[j]) sa[--bkt[s[j]]]= j;
+  }
+}
+
+static void
+suffix_array (int* s, int* sa, int n, int k) {
+  // s[0..n-1] has values in [0, k] and s[n-1] = 0 is the unique minimum
+  int i, j;
+  if (n == 1) { sa[0]= 0; return; }
+  bool* t  = tm_new_array<bool> (n);
+  int*  bkt= tm_new_array<int> (k + 1);
+  t[n-1]= true;
+  t[n-2]= false;
+  for (i=n-3; i>=0; i--)
+    t[i]= (s[i] < s[i+1] || (s[i] == s[i+1] && t[i+1]));
+
+  // sort the LMS substrings
+  get_buckets (s, n, k, bkt, true);
+  for (i=0; i<n; i++) sa[i]= -1;
+  for (i=1; i<n; i++)
+    if (is_lms (i)) sa[--bkt[s[i]]]= i;
+  induce_l (t, sa, s, bkt, n, k);
+  induce_s (t, sa, s, bkt, n, k);
+
+  // name the sorted LMS substrings
+  int n1= 0;
+  for (i=0; i<n; i++)
+    if (is_lms (sa[i])) sa[n1++]= sa[i];
+  for (i=n1; i<n; i++) sa[i]= -1;
+  int name= 0, prev= -1;
+  for (i=0; i<n1; i++) {
+    int pos= sa[i];
+    bool diff= false;
+    for (int d=0; d<n; d++)
+      if (prev == -1 || s[pos+d] != s[prev+d] || t[pos+d] != t[prev+d]) {
+        diff= true;
+        break;
+      }
+      else if (d > 0 && (is_lms (pos+d) || is_lms (prev+d))) break;
+    if (diff) { name++; prev= pos; }
+    sa[n1 + (pos >> 1)]= name - 1;
+  }
+  for (i=n-1, j=n-1; i>=n1; i--)
+    if (sa[i] >= 0) sa[j--]= sa[i];
+
+  // sort the LMS suffixes, recursively if the names are not unique
+  int* sa1= sa;
+  int* s1 = sa + n - n1;
+  if (name < n1) suffix_array (s1, sa1, n1, name - 1);
+  else for (i=0; i<n1; i++) sa1[s1[i]]= i;
+
+  // induce the order of all suffixes
+  get_buckets (s, n, k, bkt, true);
+  for (i=1, j=0; i<n; i++)
+    if (is_lms (i)) s1[j++]= i;
+  for (i=0; i<n1; i++) sa1[i]= s1[sa1[i]];
+  for (i=n1; i<n; i++) sa[i]= -1;
+  for (i=n1-1; i>=0; i--) {
+    j= sa[i];
+    sa[i]= -1;
+    sa[--bkt[s[j]]]= j;
   }
-  return (int) h;
+  induce_l (t, sa, s, bkt, n, k);
+  induce_s (t, sa, s, bkt, n, k);
+  tm_delete_array (t);
+  tm_delete_array (bkt);
+}
+
+#undef is_lms
+
+static array<int>
+suffix_array (array<int> s, int k) {
+  // s should end with a unique zero
+  array<int> sa (N(s));
+  if (N(s) > 0) suffix_array (A(s), A(sa), N(s), k);
+  return sa;
+}
+
+static array<int>
+lcp_array (array<int> s, array<int> sa) {
+  // lcp[i] is the length of the longest common prefix of the suffixes
+  // at sa[i-1] and sa[i] (Kasai et al. 2001)
+  int i, n= N(s), h= 0;
+  array<int> rank (n), lcp (n);
+  for (i=0; i<n; i++) rank[sa[i]]= i;
+  for (i=0; i<n; i++) lcp[i]= 0;
+  for (i=0; i<n; i++)
+    if (rank[i] > 0) {
+      int j= sa[rank[i] - 1];
+      while (i+h < n && j+h < n && s[i+h] == s[j+h]) h++;
+      lcp[rank[i]]= h;
+      if (h > 0) h--;
+    }
+    else h= 0;
+  return lcp;
 }
 
 /******************************************************************************
 * Construct search engine
 ******************************************************************************/
 
-string_searcher_rep::string_searcher_rep (string s2): s (s2), a () {
-  // NOTE: a[i] contains a hashmap with all associations c :-> j,
-  // where c is the hash code of the substring s (j, j + 2^i).
+string_searcher_rep::string_searcher_rep (string s2): s (s2) {
+  // NOTE: sa contains the starting positions of the suffixes of s,
+  // in lexicographical order.  Memory usage is linear in N(s)
   int i, n= N(s);
-  array<int> codes (n);
+  array<int> codes (n+1);
   for (i=0; i<n; i++)
-    codes[i]= (int) (unsigned int) (unsigned char) s[i];
-  int l=1;
-  while (l <= n) {
-    hashmap<int,array<int> > h;
-    for (i=0; i+l <= n; i++) {
-      int c= codes[i];
-      if (!h->contains (c))
-        h(c)= array<int> ();
-      h(c) << i;
-    }
-    a << h;
-    int d= 2*l;
-    for (i=0; i+d <= n; i++)
-      codes[i]= hash_combine (codes[i], codes[i+l], l);
-    l= d;
-  }
+    codes[i]= ((int) (unsigned char) s[i]) + 1;
+  codes[n]= 0;
+  array<int> all= suffix_array (codes, 256);
+  sa= range (all, 1, n+1);
 }
 
 string
@@ -77,41 +166,63 @@ string_searcher_rep::get_string () {
 * Search
 ******************************************************************************/
 
+static int
+compare_prefix (string s, int pos, string what) {
+  // compare the suffix of s at pos with what, up to the length of what
+  int n= N(s), m= N(what);
+  for (int i=0; i<m; i++) {
+    if (pos + i >= n) return -1;
+    unsigned char c1= (unsigned char) s[pos+i];
+    unsigned char c2= (unsigned char) what[i];
+    if (c1 != c2) return c1 < c2? -1: 1;
+  }
+  return 0;
+}
+
 array<int>
 string_searcher_rep::search_sub (string what) {
+  // sorted list of all occurrences of what in s
   if (N(what) == 0) {
     array<int> r;
     for (int i=0; i<=N(s); i++) r << i;
     return r;
   }
-  int k=1, l=0;
-  while ((k<<1) <= N(what)) { k <<= 1; l++; }
-  int code= fast_hash (what (0, k));
-  if (!a[l]->contains (code)) return array<int> ();
-  else return a[l][code];
+  if (what == last_what && N(last_what) != 0) return last_hits;
+  int lo= 0, hi= N(sa);
+  while (lo < hi) {
+    int m= (lo + hi) >> 1;
+    if (compare_prefix (s, sa[m], what) < 0) lo= m+1;
+    else hi= m;
+  }
+  int b= lo;
+  hi= N(sa);
+  while (lo < hi) {
+    int m= (lo + hi) >> 1;
+    if (compare_prefix (s, sa[m], what) <= 0) lo= m+1;
+    else hi= m;
+  }
+  array<int> r= range (sa, b, lo);
+  merge_sort (r);
+  last_what= what;
+  last_hits= r;
+  return r;
 }
 
 int
 string_searcher_rep::search_next (string what, int pos) {
   array<int> ps= search_sub (what);
-  for (int i=0; i<N(ps); i++) {
-    int next= ps[i];
-    if (next >= pos && test (s, next, what)) return next;
+  int lo= 0, hi= N(ps);
+  while (lo < hi) {
+    int m= (lo + hi) >> 1;
+    if (ps[m] < pos) lo= m+1;
+    else hi= m;
   }
-  return -1;
+  return lo < N(ps)? ps[lo]: -1;
 }
 
 array<int>
 string_searcher_rep::search_all (string what) {
-  // NOTE: There are better algorithms based on generalized suffix trees.
-  // However, in practice, our approach based on hashtables might be faster
-  array<int> r;
-  array<int> ps= search_sub (what);
-  for (int i=0; i<N(ps); i++) {
-    int pos= ps[i];
-    if (test (s, pos, what)) r << pos;
-  }
-  return r;
+  return search_sub (what);
 }
 
 /******************************************************************************
@@ -120,40 +231,43 @@ string_searcher_rep::search_all (string what) {
 
 void
 get_longest_common (string s1, string s2, int& b1, int& e1, int& b2, int& e2) {
-  // NOTE: There are better algorithms based on generalized suffix trees.
+  // Build the suffix array of s1 # s2 $; the longest common substrings
+  // correspond to the largest common prefixes of adjacent suffixes
+  // which start in different strings.  Among those, we return the one
+  // with the leftmost occurrence in s1, and then in s2.
   b1= e1= b2= e2= 0;
-  int bestl= 0;
-  string_searcher ss1 (s1);
-  string_searcher ss2 (s2);
-  for (int i= min (N(ss1->a), N(ss2->a)) - 1; i>=0; i--) {
-    hashmap<int,array<int> > a1= ss1->a[i];
-    hashmap<int,array<int> > a2= ss2->a[i];
-    iterator<int> it= iterate (a1);
-    while (it->busy ()) {
-      int h= it->next ();
-      array<int> ps1= a1[h];
-      array<int> ps2= a2[h];
-      if (N(ps1) == 0 || N(ps2) == 0) continue;
-      for (int j1=0; j1<N(ps1); j1++) {
-        int pos1= ps1[j1];
-        if (b1 <= pos1 && pos1 < e1) continue;
-        for (int j2=0; j2<N(ps2); j2++) {
-          int pos2= ps2[j2];
-          int bb1= pos1, ee1= pos1, bb2= pos2, ee2= pos2;
-          while (bb1 > 0 && bb2 > 0 && s1[bb1-1] == s2[bb2-1]) {
-            bb1--; bb2--; }
-          while (ee1 < N(s1) && ee2 < N(s2) && s1[ee1] == s2[ee2]) {
-            ee1++; ee2++; }
-          if (ee1 - bb1 > bestl ||
-              (ee1 - bb1 == bestl &&
-               (bb1 < b1 ||
-                (bb1 == b1 && bb2 < b2)))) {
-            b1= bb1; e1= ee1;
-            b2= bb2; e2= ee2;
-            bestl= e1 - b1;
-          }
-        }
-      }
+  int i, n1= N(s1), n2= N(s2), n= n1 + n2 + 2;
+  if (n1 == 0 || n2 == 0) return;
+  array<int> codes (n);
+  for (i=0; i<n1; i++) codes[i]= ((int) (unsigned char) s1[i]) + 2;
+  codes[n1]= 1;
+  for (i=0; i<n2; i++) codes[n1+1+i]= ((int) (unsigned char) s2[i]) + 2;
+  codes[n-1]= 0;
+  array<int> sa = suffix_array (codes, 257);
+  array<int> lcp= lcp_array (codes, sa);
+
+  int best= 0;
+  for (i=1; i<n; i++)
+    if (lcp[i] > best && ((sa[i-1] < n1) != (sa[i] < n1))) best= lcp[i];
+  if (best == 0) return;
+
+  int min1= -1, min2= -1;
+  bool found= false;
+  for (i=0; i<n; i++) {
+    if (i == 0 || lcp[i] < best) min1= min2= -1;
+    int pos= sa[i];
+    if (pos < n1) {
+      if (min1 < 0 || pos < min1) min1= pos;
+    }
+    else if (pos > n1 && pos < n-1) {
+      if (min2 < 0 || pos - n1 - 1 < min2) min2= pos - n1 - 1;
+    }
+    if (min1 >= 0 && min2 >= 0 &&
+        (!found || min1 < b1 || (min1 == b1 && min2 < b2))) {
+      b1= min1; b2= min2;
+      found= true;
     }
   }
+  e1= b1 + best;
+  e2= b2 + best;
 }
@@ -19,7 +19,9 @@
 class string_searcher;
 class string_searcher_rep: concrete_struct {
   string s;
-  array<hashmap<int,array<int> > > a;
+  array<int> sa;           // suffix array of s
+  string last_what;        // last searched string
+  array<int> last_hits;    // sorted occurrences of last_what
   array<int> search_sub (string what);
 
 public:
@@ -28,8 +30,6 @@ public:
   int search_next (string what, int pos);
   array<int> search_all (string what);
   friend class string_searcher;
-  friend void get_longest_common (string s1, string s2,
-                                  int& b1, int& e1, int& b2, int& e2);
 };
 
 class string_searcher {
@@ -0,0 +1,280 @@
+
+/******************************************************************************
+* MODULE     : tree_index.cpp
+* DESCRIPTION: Incrementally maintained n-gram indices of documents
+* COPYRIGHT  : (C) 2026  the TeXmacs team
+*******************************************************************************
+* This software falls under the GNU general public license version 3 or later.
+* It comes WITHOUT ANY WARRANTY WHATSOEVER. For details, see the file LICENSE
+* in the root directory or <http://www.gnu.org/licenses/gpl-3.0.html>.
+*******************************************************************************
+* The paragraphs of documents which are being searched are indexed by
+* the trigrams of their (lowercase) strings.  Searching an atomic string
+* then only needs to visit the paragraphs which contain all its trigrams.
+* The index is kept up to date using the modifications of the edit tree:
+* a modification inside a paragraph marks it as dirty, and insertions,
+* removals, splits and joins of paragraphs shift the index accordingly.
+* Dirty paragraphs are reindexed lazily at the next search.
+******************************************************************************/
+
+#include "tree_index.hpp"
+#include "observer.hpp"
+#include "hashmap.hpp"
+#include "merge_sort.hpp"
+
+extern tree the_et;
+
+#define SEARCH_GRAM 3
+#define SEARCH_MAX_INDICES 8
+
+/******************************************************************************
+* Trigrams
+******************************************************************************/
+
+static inline int
+gram_code (string s, int i) {
+  return (((int) (unsigned char) s[i]) << 16) +
+         (((int) (unsigned char) s[i+1]) << 8) +
+         ((int) (unsigned char) s[i+2]);
+}
+
+static void
+collect_grams (tree t, array<int>& a) {
+  if (is_atomic (t)) {
+    string s= to_lower (t->label);
+    for (int i=0; i+SEARCH_GRAM <= N(s); i++)
+      a << gram_code (s, i);
+  }
+  else
+    for (int i=0; i<N(t); i++)
+      collect_grams (t[i], a);
+}
+
+static array<int>
+unique_grams (array<int> a) {
+  merge_sort (a);
+  array<int> r;
+  for (int i=0; i<N(a); i++)
+    if (i == 0 || a[i] != a[i-1]) r << a[i];
+  return r;
+}
+
+static bool
+contains_gram (array<int> a, int g) {
+  int i= 0, j= N(a);
+  while (i < j) {
+    int m= (i + j) >> 1;
+    if (a[m] < g) i= m+1;
+    else j= m;
+  }
+  return i < N(a) && a[i] == g;
+}
+
+/******************************************************************************
+* Indices of documents
+******************************************************************************/
+
+class search_index_rep {
+public:
+  path rp;                           // location of the document in the_et
+  tree doc;                          // the indexed document
+  array<int> ids;                    // paragraph identifiers, -1 when dirty
+  hashmap<int,array<int> > grams;    // sorted trigrams of live paragraphs
+  hashmap<int,array<int> > postings; // trigram -> (possibly retired) ids
+  hashmap<int,int> position;         // live id -> paragraph number
+  bool position_ok;
+  int  next_id, nr_postings, nr_live;
+
+  search_index_rep (path rp2, tree doc2);
+  void retire (int i);
+  void insert (int i, int nr);
+  void remove (int i, int nr);
+  bool notify (modification mod);
+  void update ();
+  void candidates (string what, array<bool>& cand);
+};
+
+search_index_rep::search_index_rep (path rp2, tree doc2):
+  rp (rp2), doc (doc2), ids (N(doc2)), position (-1), position_ok (false),
+  next_id (0), nr_postings (0), nr_live (0)
+{
+  for (int i=0; i<N(ids); i++) ids[i]= -1;
+}
+
+void
+search_index_rep::retire (int i) {
+  if (i < 0 || i >= N(ids)) return;
+  int id= ids[i];
+  if (id >= 0) {
+    nr_live -= N(grams[id]);
+    grams->reset (id);
+    ids[i]= -1;
+  }
+  position_ok= false;
+}
+
+void
+search_index_rep::insert (int i, int nr) {
+  array<int> r (nr);
+  for (int k=0; k<nr; k++) r[k]= -1;
+  ids= append (append (range (ids, 0, i), r), range (ids, i, N(ids)));
+  position_ok= false;
+}
+
+void
+search_index_rep::remove (int i, int nr) {
+  for (int k=i; k<i+nr; k++) retire (k);
+  ids= append (range (ids, 0, i), range (ids, i+nr, N(ids)));
+  position_ok= false;
+}
+
+bool
+search_index_rep::notify (modification mod) {
+  // returns false if the index can no longer be maintained
+  if (mod->k == MOD_SET_CURSOR) return true;
+  path r= root (mod);
+  if (!(rp <= r)) return !(r <= rp);
+  if (r != rp) {
+    retire ((r / rp)->item);
+    return true;
+  }
+  switch (mod->k) {
+  case MOD_INSERT:
+    if (is_atomic (mod->t)) return false;
+    insert (index (mod), N(mod->t));
+    return true;
+  case MOD_REMOVE:
+    remove (index (mod), argument (mod));
+    return true;
+  case MOD_SPLIT:
+    retire (index (mod));
+    insert (index (mod) + 1, 1);
+    return true;
+  case MOD_JOIN:
+    retire (index (mod));
+    remove (index (mod) + 1, 1);
+    return true;
+  case MOD_ASSIGN_NODE:
+    return L(mod) == DOCUMENT;
+  default:
+    return false;
+  }
+}
+
+void
+search_index_rep::update () {
+  if (N(ids) != N(doc)) {
+    // should not happen, but better be safe
+    ids= array<int> (N(doc));
+    for (int i=0; i<N(ids); i++) ids[i]= -1;
+    grams= hashmap<int,array<int> > ();
+    postings= hashmap<int,array<int> > ();
+    nr_postings= nr_live= 0;
+  }
+  for (int i=0; i<N(ids); i++)
+    if (ids[i] < 0) {
+      int id= next_id++;
+      array<int> a;
+      collect_grams (doc[i], a);
+      a= unique_grams (a);
+      for (int k=0; k<N(a); k++) {
+        if (!postings->contains (a[k])) postings (a[k])= array<int> ();
+        postings (a[k]) << id;
+      }
+      grams (id)= a;
+      ids[i]= id;
+      nr_postings += N(a);
+      nr_live += N(a);
+      position_ok= false;
+    }
+  if (nr_postings > 2 * nr_live + 4096) {
+    // drop the retired identifiers from the postings
+    postings= hashmap<int,array<int> > ();
+    for (int i=0; i<N(ids); i++) {
+      array<int> a= grams[ids[i]];
+      for (int k=0; k<N(a); k++) {
+        if (!postings->contains (a[k])) postings (a[k])= array<int> ();
+        postings (a[k]) << ids[i];
+      }
+    }
+    nr_postings= nr_live;
+  }
+  if (!position_ok) {
+    position= hashmap<int,int> (-1);
+    for (int i=0; i<N(ids); i++)
+      position (ids[i])= i;
+    position_ok= true;
+  }
+}
+
+void
+search_index_rep::candidates (string what, array<bool>& cand) {
+  update ();
+  cand= array<bool> (N(ids));
+  for (int i=0; i<N(cand); i++) cand[i]= false;
+  string s= to_lower (what);
+  array<int> q;
+  for (int i=0; i+SEARCH_GRAM <= N(s); i++)
+    q << gram_code (s, i);
+  q= unique_grams (q);
+  int best= -1;
+  for (int k=0; k<N(q); k++) {
+    if (!postings->contains (q[k])) return;
+    if (best < 0 || N(postings[q[k]]) < N(postings[q[best]])) best= k;
+  }
+  array<int> a= postings[q[best]];
+  for (int j=0; j<N(a); j++) {
+    int i= position[a[j]];
+    if (i < 0) continue;
+    array<int> g= grams[a[j]];
+    bool ok= true;
+    for (int k=0; k<N(q) && ok; k++)
+      if (k != best) ok= contains_gram (g, q[k]);
+    if (ok) cand[i]= true;
+  }
+}
+
+/******************************************************************************
+* Interface
+******************************************************************************/
+
+static array<search_index_rep*> search_indices;
+
+static void
+search_index_drop (int k) {
+  tm_delete (search_indices[k]);
+  search_indices= append (range (search_indices, 0, k),
+                          range (search_indices, k+1, N(search_indices)));
+}
+
+void
+search_index_notify (modification mod) {
+  for (int k= N(search_indices) - 1; k >= 0; k--)
+    if (!search_indices[k]->notify (mod))
+      search_index_drop (k);
+}
+
+bool
+search_index_candidates (tree t, string what, array<bool>& cand) {
+  // determine the children of the document t which may contain
+  // occurrences of the string what; returns false if t is not indexed
+  if (N(what) < SEARCH_GRAM || !is_func (t, DOCUMENT)) return false;
+  path ip= obtain_ip (t);
+  if (!ip_attached (ip)) return false;
+  path rp= reverse (ip);
+  if (!has_subtree (the_et, rp)) return false;
+  int k;
+  for (k=0; k<N(search_indices); k++)
+    if (search_indices[k]->rp == rp) break;
+  if (k < N(search_indices) && !strong_equal (search_indices[k]->doc, t)) {
+    search_index_drop (k);
+    k= N(search_indices);
+  }
+  if (k == N(search_indices)) {
+    if (N(search_indices) >= SEARCH_MAX_INDICES) search_index_drop (0);
+    search_indices << tm_new<search_index_rep> (rp, t);
+    k= N(search_indices) - 1;
+  }
+  search_indices[k]->candidates (what, cand);
+  return true;
+}
@@ -0,0 +1,19 @@
+
+/******************************************************************************
+* MODULE     : tree_index.hpp
+* DESCRIPTION: Incrementally maintained n-gram indices of documents
+* COPYRIGHT  : (C) 2026  the TeXmacs team
+*******************************************************************************
+* This software falls under the GNU general public license version 3 or later.
+* It comes WITHOUT ANY WARRANTY WHATSOEVER. For details, see the file LICENSE
+* in the root directory or <http://www.gnu.org/licenses/gpl-3.0.html>.
+******************************************************************************/
+
+#ifndef TREE_INDEX_H
+#define TREE_INDEX_H
+#include "modification.hpp"
+
+void search_index_notify (modification mod);
+bool search_index_candidates (tree t, string what, array<bool>& cand);
+
+#endif // defined TREE_INDEX_H
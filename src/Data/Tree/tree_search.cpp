@@ -10,6 +10,7 @@
 ******************************************************************************/
 
 #include "tree_search.hpp"
+#include "tree_index.hpp"
 #include "analyze.hpp"
 #include "boot.hpp"
 #include "drd_mode.hpp"
@@ -349,17 +350,34 @@ search (range_set& sel, tree t, tree what, path p) {
     search_compound (sel, t, what, p);
 }
 
+static bool
+search_indexed (tree t, tree what, array<bool>& cand) {
+  // for atomic patterns in large documents, determine the paragraphs
+  // which may contain a match using the search index
+  if (!is_atomic (what) || !is_func (t, DOCUMENT) || N(t) < 16) return false;
+  if (blank_match_flag && what == "") return false;
+  return search_index_candidates (t, what->label, cand);
+}
+
 void
 search (range_set& sel, tree t, tree what, path p, path pos) {
+  array<bool> cand;
   if (is_format (what) || is_atomic (t))
     search (sel, t, what, p);
+  else if (is_nil (pos) && search_indexed (t, what, cand)) {
+    for (int i=0; i<N(t); i++)
+      if (cand[i] && is_accessible_for_search (t, i))
+        search (sel, t[i], what, p * i);
+  }
   else {
     if (is_nil (pos)) search (sel, t, what, p);
     else {
+      bool indexed= search_indexed (t, what, cand);
       int hits= 0;
       array<range_set> sub (N(t));
       if (pos->item >= 0 && pos->item < N(t))
-        if (is_accessible_for_search (t, pos->item)) {
+        if (is_accessible_for_search (t, pos->item) &&
+            (!indexed || cand[pos->item])) {
           search (sub[pos->item], t[pos->item], what, p * pos->item);
           hits += N(sub[pos->item]);
         }
@@ -367,7 +385,7 @@ search (range_set& sel, tree t, tree what, path p, path pos) {
         for (int e=0; e<=1; e++) {
           if (hits > search_max_hits) break;
           int i= (e==0? pos->item + d: pos->item - d);
-          if (i >= 0 && i < N(t))
+          if (i >= 0 && i < N(t) && (!indexed || cand[i]))
             if (is_accessible_for_search (t, i)) {
               search (sub[i], t[i], what, p * i);
               hits += N(sub[i]);
@@ -451,7 +469,7 @@ search (tree t, tree what, path p, int limit) {
   range_set sel;
   //cout << "Search " << what << ", " << contains_select_region (what) << "\n";
   if (contains_select_region (what)) select (sel, t, what, p);
-  else search (sel, t, what, p);
+  else search (sel, t, what, p, path ());
   //cout << "Selected " << sel << "\n";
   search_max_hits= 1000000;
   return sel;
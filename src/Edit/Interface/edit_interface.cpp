@@ -164,6 +164,7 @@ edit_interface_rep::invalidate (rectangles rs) {
 
 void
 edit_interface_rep::invalidate_all () {
+  stored_rects= rectangles ();
   send_invalidate_all (this);
 }
 
@@ -680,6 +681,9 @@ edit_interface_rep::apply_changes () {
     SI x1, y1, x2, y2;
     typeset (x1, y1, x2, y2);
     invalidate (x1- 2*pixel, y1- 2*pixel, x2+ 2*pixel, y2+ 2*pixel);
+    if (x1 < x2 && y1 < y2)
+      backing_store_invalidate (rectangle (x1- 2*pixel, y1- 2*pixel,
+                                           x2+ 2*pixel, y2+ 2*pixel));
     // check_data_integrety ();
     the_ghost_cursor()= eb->find_check_cursor (tp);
   }
@@ -881,8 +885,12 @@ edit_interface_rep::apply_changes () {
   
   // cout << "Handling backing store\n";
   if (!is_nil (stored_rects)) {
-    if (env_change & (THE_TREE+THE_ENVIRONMENT+THE_SELECTION+THE_EXTENTS))
-      stored_rects= rectangles ();
+    // changes of the tree only invalidate the tiles reported by the
+    // typesetter; selections are drawn on top of the stored text,
+    // except for graphics, whose selected objects are part of the text
+    int flush= THE_ENVIRONMENT + THE_EXTENTS;
+    if (inside_active_graphics ()) flush += THE_TREE + THE_SELECTION;
+    if (env_change & flush) stored_rects= rectangles ();
   }
   if (inside_active_graphics ()) {
     SI gx1, gy1, gx2, gy2;
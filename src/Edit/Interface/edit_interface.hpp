@@ -108,9 +108,12 @@ public:
   void draw_cursor (renderer ren);
   void draw_selection (renderer ren, rectangle r);
   void draw_graphics (renderer ren);
-  void draw_pre (renderer win, renderer ren, rectangle r);
+  void draw_pre (renderer win, renderer ren, rectangle r, bool clean= false);
   void draw_post (renderer win, renderer ren, rectangle r);
-  void draw_with_shadow (renderer win, rectangle r);
+  void draw_with_shadow (renderer win, rectangle r, bool clean= false);
+  bool backing_store_enabled ();
+  rectangle backing_store_tiles (rectangle r);
+  void backing_store_invalidate (rectangle r);
   void draw_with_stored (renderer win, rectangle r);
 
   /* handle changes */
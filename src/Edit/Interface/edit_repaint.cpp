@@ -191,13 +191,14 @@ edit_interface_rep::draw_graphics (renderer ren) {
 }
 
 void
-edit_interface_rep::draw_pre (renderer win, renderer ren, rectangle r) {
+edit_interface_rep::draw_pre (renderer win, renderer ren, rectangle r,
+                              bool clean) {
   // draw surroundings
   draw_background (ren, r->x1, r->y1, r->x2, r->y2);
   draw_surround (ren, r);
 
-  // predraw cursor
-  draw_cursor (ren);
+  // predraw cursor, unless the text layer is kept in the backing store
+  if (!clean) draw_cursor (ren);
   rectangles l= copy_always;
   while (!is_nil (l)) {
     rectangle lr (l->item);
@@ -220,7 +221,7 @@ edit_interface_rep::draw_post (renderer win, renderer ren, rectangle r) {
 }
 
 void
-edit_interface_rep::draw_with_shadow (renderer win, rectangle r) {
+edit_interface_rep::draw_with_shadow (renderer win, rectangle r, bool clean) {
   rectangle sr= r * magf;
   win->new_shadow (shadow);
   win->get_shadow (shadow, sr->x1, sr->y1, sr->x2, sr->y2);
@@ -229,7 +230,7 @@ edit_interface_rep::draw_with_shadow (renderer win, rectangle r) {
   rectangles l;
   win->set_zoom_factor (zoomf);
   ren->set_zoom_factor (zoomf);
-  draw_pre (win, ren, r);
+  draw_pre (win, ren, r, clean);
   draw_text (ren, l);
   ren->reset_zoom_factor ();
   win->reset_zoom_factor ();
@@ -258,6 +259,50 @@ edit_interface_rep::draw_with_shadow (renderer win, rectangle r) {
   }
 }
 
+/******************************************************************************
+* The backing store
+******************************************************************************/
+
+// The text layer of the window, i.e. everything drawn by draw_pre and
+// draw_text, is kept in the 'stored' renderer.  The valid part of the
+// store is the union 'stored_rects' of square tiles of the window, which
+// are redrawn as a whole, so that the store does not fragment into many
+// small pieces.  Tiles are invalidated when the typesetter reports
+// changes in the corresponding region (see apply_changes); cursor moves,
+// selections and other decorations from draw_post are simply drawn
+// on top of the stored text layer.
+
+#define TILE_SIZE 128
+
+static SI
+tile_floor (SI x, SI ts) {
+  if (x >= 0) return (x / ts) * ts;
+  return - (((-x) + ts - 1) / ts) * ts;
+}
+
+static SI
+tile_ceil (SI x, SI ts) {
+  return - tile_floor (-x, ts);
+}
+
+bool
+edit_interface_rep::backing_store_enabled () {
+  return get_preference ("tiled backing store", "on") == "on";
+}
+
+rectangle
+edit_interface_rep::backing_store_tiles (rectangle r) {
+  SI ts= TILE_SIZE * pixel;
+  return rectangle (tile_floor (r->x1, ts), tile_floor (r->y1, ts),
+                    tile_ceil  (r->x2, ts), tile_ceil  (r->y2, ts));
+}
+
+void
+edit_interface_rep::backing_store_invalidate (rectangle r) {
+  if (!is_nil (stored_rects))
+    stored_rects= simplify (stored_rects - rectangles (backing_store_tiles (r)));
+}
+
 void
 edit_interface_rep::draw_with_stored (renderer win, rectangle r) {
   //cout << "Redraw " << (r*magf/PIXEL) << "\n";
@@ -286,9 +331,21 @@ edit_interface_rep::draw_with_stored (renderer win, rectangle r) {
   }
   else {
     // cout << "."; cout.flush ();
-    draw_with_shadow (win, r);
+    bool keep= inside_active_graphics (), clean= false;
+    if (!keep && backing_store_enabled ()) {
+      // redraw and store all tiles which meet r, as far as visible
+      update_visible ();
+      rectangle tr= backing_store_tiles (r);
+      r= rectangle (min (r->x1, max (tr->x1, vx1)),
+                    min (r->y1, max (tr->y1, vy1)),
+                    max (r->x2, min (tr->x2, vx2)),
+                    max (r->y2, min (tr->y2, vy2)));
+      sr= r * magf;
+      keep= clean= true;
+    }
+    draw_with_shadow (win, r, clean);
     if (!gui_interrupted ()) {
-      if (inside_active_graphics ()) {
+      if (keep) {
 	shadow->new_shadow (stored);
 	shadow->get_shadow (stored, sr->x1, sr->y1, sr->x2, sr->y2);
 	//stored_rects= /*stored_rects |*/ rectangles (r);
@@ -296,6 +353,12 @@ edit_interface_rep::draw_with_stored (renderer win, rectangle r) {
 	//cout << "Stored: " << stored_rects << "\n";
 	//cout << "M"; cout.flush ();
       }
+      if (clean) {
+        // re-issue the predrawn cursor, which was left out of the store
+        shadow->set_zoom_factor (zoomf);
+        draw_cursor (shadow);
+        shadow->reset_zoom_factor ();
+      }
       draw_post (win, shadow, r);
       win->put_shadow (shadow, sr->x1, sr->y1, sr->x2, sr->y2);
     }
@@ -340,7 +403,9 @@ edit_interface_rep::handle_repaint (renderer win, SI x1, SI y1, SI x2, SI y2) {
   */
 
   // cout << "Repainting\n";
+  picture_cache_defer (true);
   draw_with_stored (win, rectangle (x1, y1, x2, y2) /magf);
+  picture_cache_defer (false);
   if (last_change-last_update > 0)
     last_change = texmacs_time ();
   // cout << "Repainted\n";
@@ -129,10 +129,11 @@ edit_process_rep::generate_bibliography (
       t= as_tree (call (string ("bib-compile"), bib, style, bib_t, bib_file));
     }
     else if (starts (style, "tm-")) {
-      string sbib;
-      if (load_string (bib_file, sbib, false))
+      tree te= parse_bib_entries (bib_file, bib_t);
+      if (te == tree ()) {
 	std_error << "Could not load BibTeX file " << fname;
-      tree te= bib_entries (parse_bib (sbib), bib_t);
+        te= bib_entries (parse_bib (""), bib_t);
+      }
       object ot= tree_to_stree (te);
       eval ("(use-modules (bibtex " * style (3, N(style)) * "))");
       t= stree_to_tree (call (string ("bib-process"),
@@ -73,6 +73,8 @@ public:
   /* spell */
   path test_spellable (path p);
   void spell_next ();
+  void spell_words (path p, path from, array<string>& r);
+  void spell_prefetch ();
   void spell_replace (string by);
   void spell_start ();
   void spell_end ();
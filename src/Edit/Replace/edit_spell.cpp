@@ -20,6 +20,8 @@
 #define ispell_accept mac_spell_accept
 #define ispell_insert mac_spell_insert
 #define ispell_done mac_spell_done
+static void ispell_prefetch (string lan, array<string> a) {
+  (void) lan; (void) a; }
 #else
 #include "Ispell/ispell.hpp"
 #endif
@@ -99,6 +101,64 @@ edit_replace_rep::test_spellable (path p) {
   return path_add (p, e - b);
 }
 
+/******************************************************************************
+* Prefetch the verdicts for the next words
+******************************************************************************/
+
+#define SPELL_PREFETCH 64
+
+static void
+string_words (string s, int i, array<string>& r) {
+  int n= N(s);
+  while (i<n && N(r) < SPELL_PREFETCH) {
+    if ((!is_iso_alpha (s[i])) ||
+        (i>0 && (is_iso_alpha (s[i-1]) || is_digit (s[i-1])))) {
+      i++;
+      continue;
+    }
+    int e= i;
+    while ((e < n) && (is_iso_alpha (s[e]))) e++;
+    if ((e == n) || (!is_digit (s[e]))) r << s (i, e);
+    i= e;
+  }
+}
+
+void
+edit_replace_rep::spell_words (path p, path from, array<string>& r) {
+  // spellable words after the position from in the subtree at p
+  tree t= subtree (et, p);
+  if (is_atomic (t)) {
+    array<string> a;
+    string_words (t->label, is_nil (from)? 0: from->item, a);
+    if (N(a) == 0) return;
+    string mode= as_string (get_env_value (MODE, p * 0));
+    string lan =
+      as_string (get_env_value (MODE_LANGUAGE (mode), p * 0));
+    if ((search_mode == mode) && (search_lan == lan))
+      for (int k=0; k<N(a) && N(r) < SPELL_PREFETCH; k++) r << a[k];
+    return;
+  }
+  int i= 0;
+  if (!is_nil (from)) {
+    i= from->item;
+    if (i < N(t) && !is_nil (from->next) && drd->is_accessible_child (t, i))
+      spell_words (p * i, from->next, r);
+    i++;
+  }
+  for (; i<N(t) && N(r) < SPELL_PREFETCH; i++)
+    if (drd->is_accessible_child (t, i))
+      spell_words (p * i, path (), r);
+}
+
+void
+edit_replace_rep::spell_prefetch () {
+  // let the spell checker work on the next words in the background
+  array<string> a;
+  if (!(rp <= search_end)) return;
+  spell_words (rp, search_end / rp, a);
+  if (N(a) != 0) ispell_prefetch (search_lan, a);
+}
+
 static string
 message_ispell (tree t) {
   int i;
@@ -112,6 +172,7 @@ message_ispell (tree t) {
 
 void
 edit_replace_rep::spell_next () {
+  int nr= 0;
   while (true) {
     if (path_inf (spell_end_p, search_at))
       search_at= rp;
@@ -121,6 +182,7 @@ edit_replace_rep::spell_next () {
     }
     search_end= test_spellable (search_at);
     if (search_end != search_at) {
+      if ((nr++ % (SPELL_PREFETCH >> 1)) == 0) spell_prefetch ();
       spell_t= ispell_check (search_lan, spell_s);
       if (is_atomic (spell_t) && starts (spell_t->label, "Error: ")) {
 	spell_end ();
@@ -136,6 +198,7 @@ edit_replace_rep::spell_next () {
 	  notify_change (THE_SELECTION);
 	  go_to (copy (search_end));
 	  set_message (message_ispell (spell_t), "spelling error");
+	  spell_prefetch ();
 	  return;
 	}
       }
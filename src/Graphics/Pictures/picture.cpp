@@ -177,13 +177,33 @@ picture_is_cached (url file_name, int w, int h) {
   }
 }
 
+static bool picture_defer= false;
+
+void
+picture_cache_defer (bool flag) {
+  // while rendering on the screen, images which require an external
+  // conversion are converted in the background and a placeholder is
+  // drawn meanwhile; the window is repainted once the conversion is done
+  picture_defer= flag;
+}
+
 picture
 cached_load_picture (url file_name, int w, int h, bool permanent) {
   tree key= tuple (file_name->t, as_string (w), as_string (h));
   if (picture_is_cached (file_name, w, h))
     return picture_cache [key];
   //cout << "Loading " << key << "\n";
-  picture pic= load_picture (file_name, w, h);
+  picture pic;
+  if (picture_defer && background_image_conversion (file_name)) {
+    url png= cached_image_conversion (file_name, "png", w, h, 0, false);
+    if (is_none (png)) {
+      pic= raster_picture (w, h);
+      draw_on (pic, 0x20808080, compose_source);
+      return pic;
+    }
+    pic= load_picture (png, w, h);
+  }
+  else pic= load_picture (file_name, w, h);
   if (permanent || picture_count[key] > 0) {
     int pic_modif= last_modified (file_name, false);
     picture_cache (key)= pic;
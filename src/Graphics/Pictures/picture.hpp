@@ -78,6 +78,7 @@ void picture_cache_reserve (url u, int w, int h);
 void picture_cache_release (url u, int w, int h);
 void picture_cache_clean ();
 picture cached_load_picture (url u, int w, int h, bool permanent= true);
+void picture_cache_defer (bool flag);
 string picture_as_eps (picture pic, int dpi);
 
 /******************************************************************************
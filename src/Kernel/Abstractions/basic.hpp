@@ -187,14 +187,26 @@ struct abstract_struct {
 * indirect structures
 ******************************************************************************/
 
-#define INC_COUNT(R) { (R)->ref_count++; }
-#define DEC_COUNT(R) { if(0==--((R)->ref_count)) { tm_delete (R);}}
+// When USE_ATOMIC_REFCOUNT is defined, reference counts are updated
+// atomically, so that kernel objects may be shared between threads
+#ifdef USE_ATOMIC_REFCOUNT
+#define REF_COUNT_INC(R) __atomic_add_fetch (&((R)->ref_count), 1, \
+                                             __ATOMIC_RELAXED)
+#define REF_COUNT_DEC(R) __atomic_sub_fetch (&((R)->ref_count), 1, \
+                                             __ATOMIC_ACQ_REL)
+#else
+#define REF_COUNT_INC(R) (++((R)->ref_count))
+#define REF_COUNT_DEC(R) (--((R)->ref_count))
+#endif
+
+#define INC_COUNT(R) { REF_COUNT_INC (R); }
+#define DEC_COUNT(R) { if(0==REF_COUNT_DEC (R)) { tm_delete (R);}}
 //#define DEC_COUNT(R) { if(0==--((R)->ref_count)) { tm_delete (R); R=NULL;}}
-#define INC_COUNT_NULL(R) { if ((R)!=NULL) (R)->ref_count++; }
+#define INC_COUNT_NULL(R) { if ((R)!=NULL) REF_COUNT_INC (R); }
 /*#define DEC_COUNT_NULL(R) \
   { if ((R)!=NULL && 0==--((R)->ref_count)) { tm_delete (R); } } */
 #define DEC_COUNT_NULL(R) \
-  { if ((R)!=NULL && 0==--((R)->ref_count)) { tm_delete (R); R=NULL;} }
+  { if ((R)!=NULL && 0==REF_COUNT_DEC (R)) { tm_delete (R); R=NULL;} }
 
 // concrete
 #define CONCRETE(PTR)               \
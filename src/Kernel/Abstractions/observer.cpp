@@ -19,6 +19,7 @@
 observer nil_observer;
 extern tree the_et;
 extern bool packrat_invalid_colors;
+extern void search_index_notify (modification mod);
 
 /******************************************************************************
 * Debugging facilities
@@ -412,6 +413,7 @@ apply (tree& ref, modification mod) {
       upcoming  = list<modification> (reverse (ip) * mod);
       while (!is_nil (upcoming)) {
 	//cout << "Handle " << upcoming->item << "\n";
+	search_index_notify (upcoming->item);
 	raw_apply (the_et, upcoming->item);
 	//cout << "Done " << upcoming->item << "\n";
 	upcoming= upcoming->next;
@@ -701,6 +703,18 @@ observer_rep::set_ip (path ip) {
   return false;
 }
 
+bool
+observer_rep::get_order (order_item_rep*& open, order_item_rep*& close) {
+  (void) open; (void) close;
+  return false;
+}
+
+bool
+observer_rep::set_order (order_item_rep* open, order_item_rep* close) {
+  (void) open; (void) close;
+  return false;
+}
+
 bool
 observer_rep::get_position (tree& t, int& index) {
   (void) t; (void) index;
@@ -18,6 +18,7 @@ class hard_link_rep;
 class observer;
 class modification;
 class blackbox;
+struct order_item_rep;
 template<class T> class list;
 template<class T> class array;
 typedef hard_link_rep* weak_link;
@@ -79,6 +80,8 @@ public:
   // Extra routines for particular types of observers
   virtual bool get_ip (path& ip);
   virtual bool set_ip (path ip);
+  virtual bool get_order (order_item_rep*& open, order_item_rep*& close);
+  virtual bool set_order (order_item_rep* open, order_item_rep* close);
   virtual bool get_position (tree& t, int& index);
   virtual bool set_position (tree t, int index);
   virtual observer& get_child (int which);
@@ -156,6 +159,9 @@ path obtain_ip (tree& ref);
 void attach_ip (tree& ref, path ip);
 void detach_ip (tree& ref);
 bool ip_attached (path ip);
+bool tree_attached (tree& t);
+bool tree_precedes (tree& t1, tree& t2);
+bool tree_inside (tree& t, tree& anc);
 
 tree obtain_tree (observer o);
 observer tree_pointer_new (tree t);
@@ -0,0 +1,189 @@
+
+/******************************************************************************
+* MODULE     : thread_pool.cpp
+* DESCRIPTION: Work-stealing pool of worker threads with futures
+* COPYRIGHT  : (C) 2026  the TeXmacs team
+*******************************************************************************
+* This software falls under the GNU general public license version 3 or later.
+* It comes WITHOUT ANY WARRANTY WHATSOEVER. For details, see the file LICENSE
+* in the root directory or <http://www.gnu.org/licenses/gpl-3.0.html>.
+******************************************************************************/
+
+#include "thread_pool.hpp"
+#include "mpsc_queue.hpp"
+#include <deque>
+#include <thread>
+#include <vector>
+
+/******************************************************************************
+* Workers
+******************************************************************************/
+
+struct worker_rep {
+  std::mutex m;
+  std::deque<task_rep*> tasks;
+  std::thread th;
+};
+
+static std::vector<worker_rep*> workers;
+static std::mutex idle_m;
+static std::condition_variable idle_cv;
+static std::atomic<int> pending (0);
+static std::atomic<bool> stopping (false);
+static std::atomic<unsigned int> next_worker (0);
+static thread_local int worker_id= -1;
+
+static task_rep*
+take_task (int id) {
+  // pop one of our own tasks, or steal the oldest task of another worker
+  int n= (int) workers.size ();
+  if (id >= 0) {
+    worker_rep* w= workers[id];
+    std::lock_guard<std::mutex> lock (w->m);
+    if (!w->tasks.empty ()) {
+      task_rep* t= w->tasks.back ();
+      w->tasks.pop_back ();
+      return t;
+    }
+  }
+  int start= (id >= 0? id + 1: 0);
+  for (int k=0; k<n; k++) {
+    worker_rep* w= workers[(start + k) % n];
+    std::lock_guard<std::mutex> lock (w->m);
+    if (!w->tasks.empty ()) {
+      task_rep* t= w->tasks.front ();
+      w->tasks.pop_front ();
+      return t;
+    }
+  }
+  return NULL;
+}
+
+static void
+run_task (task_rep* t) {
+  pending--;
+  t->run ();
+  tm_delete (t);
+}
+
+static void
+worker_loop (int id) {
+  worker_id= id;
+  while (!stopping.load ()) {
+    task_rep* t= take_task (id);
+    if (t != NULL) run_task (t);
+    else {
+      std::unique_lock<std::mutex> lock (idle_m);
+      idle_cv.wait (lock, [] {
+          return stopping.load () || pending.load () > 0; });
+    }
+  }
+}
+
+/******************************************************************************
+* The pool
+******************************************************************************/
+
+void
+thread_pool_start (int nr_workers) {
+  // start the workers; without thread-safe reference counting, kernel
+  // objects cannot be shared, so that tasks are run in the calling thread
+#ifdef USE_ATOMIC_REFCOUNT
+  if (!workers.empty ()) return;
+  if (nr_workers <= 0)
+    nr_workers= max (1, (int) std::thread::hardware_concurrency ());
+  stopping= false;
+  for (int i=0; i<nr_workers; i++)
+    workers.push_back (new worker_rep ());
+  for (int i=0; i<nr_workers; i++)
+    workers[i]->th= std::thread (worker_loop, i);
+#else
+  (void) nr_workers;
+#endif
+}
+
+void
+thread_pool_stop () {
+  // join the workers and run the remaining tasks in the calling thread
+  if (workers.empty ()) return;
+  {
+    std::lock_guard<std::mutex> lock (idle_m);
+    stopping= true;
+  }
+  idle_cv.notify_all ();
+  for (int i=0; i<(int) workers.size (); i++)
+    workers[i]->th.join ();
+  while (true) {
+    task_rep* t= take_task (-1);
+    if (t == NULL) break;
+    run_task (t);
+  }
+  for (int i=0; i<(int) workers.size (); i++)
+    delete workers[i];
+  workers.clear ();
+}
+
+int
+thread_pool_size () {
+  return (int) workers.size ();
+}
+
+bool
+thread_pool_is_worker () {
+  return worker_id >= 0;
+}
+
+void
+thread_pool_submit (task_rep* t) {
+  // workers keep their own subtasks, others are distributed round robin
+  int n= (int) workers.size ();
+  if (n == 0) { t->run (); tm_delete (t); return; }
+  int id= (worker_id >= 0? worker_id: (int) (next_worker++ % n));
+  worker_rep* w= workers[id];
+  {
+    std::lock_guard<std::mutex> lock (w->m);
+    w->tasks.push_back (t);
+  }
+  pending++;
+  { std::lock_guard<std::mutex> lock (idle_m); }
+  idle_cv.notify_one ();
+}
+
+bool
+thread_pool_help () {
+  // run one pending task in the calling thread, if there is any
+  if (workers.empty ()) return false;
+  task_rep* t= take_task (worker_id);
+  if (t == NULL) return false;
+  run_task (t);
+  return true;
+}
+
+/******************************************************************************
+* Posting commands to the main thread
+******************************************************************************/
+
+static mpsc_queue<command>&
+main_thread_queue () {
+  static mpsc_queue<command> q;
+  return q;
+}
+
+void
+main_thread_post (command cmd) {
+  main_thread_queue () .push (cmd);
+}
+
+int
+main_thread_dispatch () {
+  // execute the commands which were posted so far; to be called
+  // regularly from the event loop of the main thread
+  mpsc_queue<command>& q= main_thread_queue ();
+  command cmd;
+  int n= 0;
+  while (q.pop (cmd)) {
+    cmd ();
+    n++;
+  }
+  return n;
+}
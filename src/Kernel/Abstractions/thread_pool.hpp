@@ -0,0 +1,111 @@
+
+/******************************************************************************
+* MODULE     : thread_pool.hpp
+* DESCRIPTION: Work-stealing pool of worker threads with futures
+* COPYRIGHT  : (C) 2026  the TeXmacs team
+*******************************************************************************
+* This software falls under the GNU general public license version 3 or later.
+* It comes WITHOUT ANY WARRANTY WHATSOEVER. For details, see the file LICENSE
+* in the root directory or <http://www.gnu.org/licenses/gpl-3.0.html>.
+******************************************************************************/
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+#include "command.hpp"
+#include "promise.hpp"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+/******************************************************************************
+* Each worker owns a deque of tasks: it pushes and pops its own tasks
+* at the back and steals the oldest tasks of other workers at the front.
+* Kernel objects (trees, strings, arrays, commands, ...) may only be
+* passed between threads when the kernel is built with USE_ATOMIC_REFCOUNT;
+* in other builds the pool has no workers and tasks are run immediately
+* by the thread which spawns them.  Shared global tables (such as hashmaps
+* or the table of interned trees) remain the property of the main thread.
+******************************************************************************/
+
+class task_rep {
+public:
+  inline task_rep () {}
+  inline virtual ~task_rep () {}
+  virtual void run () = 0;
+};
+
+void thread_pool_start (int nr_workers= 0);
+void thread_pool_stop ();
+int  thread_pool_size ();
+bool thread_pool_is_worker ();
+void thread_pool_submit (task_rep* t);
+bool thread_pool_help ();
+
+// Posting commands from any thread to the main (GUI) thread
+void main_thread_post (command cmd);
+int  main_thread_dispatch ();
+
+/******************************************************************************
+* Futures are promises whose value is computed by the pool
+******************************************************************************/
+
+template<class T>
+struct future_state {
+  std::mutex m;
+  std::condition_variable cv;
+  std::atomic<bool> ready;
+  T val;
+  future_state (): ready (false) {}
+  void set (const T& x) {
+    std::lock_guard<std::mutex> lock (m);
+    val= x;
+    ready.store (true, std::memory_order_release);
+    cv.notify_all (); }
+};
+
+template<class T>
+class future_rep: public promise_rep<T> {
+  std::shared_ptr<future_state<T> > st;
+public:
+  inline future_rep (std::shared_ptr<future_state<T> > st2): st (st2) {}
+  inline tm_ostream& print (tm_ostream& out) { return out << "future"; }
+  inline bool is_ready () {
+    return st->ready.load (std::memory_order_acquire); }
+  T eval () {
+    // help the pool while waiting, so that nested futures cannot deadlock
+    while (!is_ready ()) {
+      if (thread_pool_help ()) continue;
+      std::unique_lock<std::mutex> lock (st->m);
+      st->cv.wait_for (lock, std::chrono::milliseconds (1),
+                       [this] { return is_ready (); });
+    }
+    return st->val; }
+};
+
+template<class T, class F>
+class spawn_task_rep: public task_rep {
+  F fun;
+  std::shared_ptr<future_state<T> > st;
+public:
+  inline spawn_task_rep (const F& fun2, std::shared_ptr<future_state<T> > st2):
+    fun (fun2), st (st2) {}
+  void run () { st->set (fun ()); }
+};
+
+template<class T, class F> promise<T>
+spawn (F fun) {
+  // run fun () asynchronously and return a promise for its result
+  std::shared_ptr<future_state<T> > st (new future_state<T> ());
+  if (thread_pool_size () == 0) st->set (fun ());
+  else thread_pool_submit (tm_new<spawn_task_rep<T,F> > (fun, st));
+  return promise<T> (tm_new<future_rep<T> > (st));
+}
+
+template<class T> inline bool
+is_ready (promise<T> p) {
+  future_rep<T>* f= dynamic_cast<future_rep<T>*> (p.rep);
+  return f == NULL || f->is_ready (); }
+
+#endif // defined THREAD_POOL_H
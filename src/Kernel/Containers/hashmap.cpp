@@ -41,38 +41,128 @@ operator != (H h1, H h2) {
   return (h1.code!=h2.code) || (h1.key!=h2.key) || (h1.im!=h2.im);
 }
 
+/******************************************************************************
+* Management of the slots
+******************************************************************************/
+
+inline int
+hashmap_start (int hv, int m) {
+  // the low bits of many hash functions are poorly distributed,
+  // which would lead to long clusters when probing linearly
+  unsigned int x= ((unsigned int) hv) * 2654435761u;
+  return (int) ((x ^ (x >> 15)) & m);
+}
+
+TMPL void
+hashmap_rep<T,U>::allocate (int n2) {
+  n= n2;
+  a= (H*) fast_alloc (n * (sizeof (H) + sizeof (bool)));
+  used= (bool*) (a + n);
+  for (int i=0; i<n; i++) used[i]= false;
+}
+
+TMPL void
+hashmap_rep<T,U>::release () {
+  for (int i=0; i<n; i++)
+    if (used[i]) a[i].~H ();
+  fast_free ((void*) a, n * (sizeof (H) + sizeof (bool)));
+}
+
+TMPL int
+hashmap_rep<T,U>::find (T x, int hv) {
+  register int m= n-1, i= hashmap_start (hv, m);
+  while (used[i]) {
+    if (a[i].code == hv && a[i].key == x) return i;
+    i= (i+1) & m;
+  }
+  return -1;
+}
+
+TMPL U&
+hashmap_rep<T,U>::insert (int hv, T x, U y) {
+  // x should not yet be a key
+  if (((size+1) << 2) > 3*n) resize (n<<1);
+  register int m= n-1, i= hashmap_start (hv, m);
+  while (used[i]) i= (i+1) & m;
+  (void) new ((void*) (a+i)) H (hv, x, y);
+  used[i]= true;
+  size ++;
+  return a[i].im;
+}
+
+TMPL void
+hashmap_rep<T,U>::detach_iterators () {
+  // entries are about to move: let the iterators copy their remaining keys
+  while (iterators != NULL) {
+    hashmap_iterator_base* it= iterators;
+    iterators= it->next_iterator;
+    it->next_iterator= NULL;
+    it->detach ();
+  }
+}
+
+TMPL void
+hashmap_rep<T,U>::attach_iterator (hashmap_iterator_base* it) {
+  it->next_iterator= iterators;
+  iterators= it;
+}
+
+TMPL void
+hashmap_rep<T,U>::forget_iterator (hashmap_iterator_base* it) {
+  hashmap_iterator_base** p= &iterators;
+  while (*p != NULL && *p != it) p= &((*p)->next_iterator);
+  if (*p == it) *p= it->next_iterator;
+  it->next_iterator= NULL;
+}
+
+TMPL void
+hashmap_rep<T,U>::remove (int i) {
+  // remove the entry at slot i and shift back the entries after it
+  if (iterators != NULL) detach_iterators ();
+  register int m= n-1, j= i;
+  a[i].~H ();
+  while (true) {
+    j= (j+1) & m;
+    if (!used[j]) break;
+    int k= hashmap_start (a[j].code, m);
+    if (i <= j? (i < k && k <= j): (i < k || k <= j)) continue;
+    (void) new ((void*) (a+i)) H (a[j]);
+    a[j].~H ();
+    i= j;
+  }
+  used[i]= false;
+  size --;
+}
+
 /******************************************************************************
 * Routines for hashmaps
 ******************************************************************************/
 
 TMPL void
 hashmap_rep<T,U>::resize (int n2) {
-  int i;
+  // n2 is a hint; the table always keeps a load factor of at most 3/4
+  int i, n3= 1;
+  while (n3 < n2 || (size << 2) > 3*n3) n3 <<= 1;
+  if (n3 == n) return;
+  if (iterators != NULL) detach_iterators ();
   int oldn= n;
-  list<hashentry<T,U> >* olda= a;
-  n= n2;
-  a= tm_new_array<list<hashentry<T,U> > > (n);
-  for (i=0; i<oldn; i++) {
-    list<hashentry<T,U> > l(olda[i]);
-    while (!is_nil (l)) {
-      list<hashentry<T,U> >& newl= a[hash(l->item.key)&(n-1)];
-      newl= list<hashentry<T,U> > (l->item, newl);
-      l=l->next;
+  H* olda= a;
+  bool* oldu= used;
+  allocate (n3);
+  for (i=0; i<oldn; i++)
+    if (oldu[i]) {
+      register int m= n-1, j= hashmap_start (olda[i].code, m);
+      while (used[j]) j= (j+1) & m;
+      (void) new ((void*) (a+j)) H (olda[i]);
+      used[j]= true;
+      olda[i].~H ();
     }
-  }
-  tm_delete_array (olda);
+  fast_free ((void*) olda, oldn * (sizeof (H) + sizeof (bool)));
 }
 
 TMPL bool
 hashmap_rep<T,U>::contains (T x) {
-  register int hv= hash (x);
-  list<hashentry<T,U> >  l (a [hv & (n-1)]);
-  while (!is_nil (l)) {
-    if (l->item.code == hv && l->item.key == x)
-      return true;
-    l= l->next;
-  }
-  return false;
+  return find (x, hash (x)) >= 0;
 }
 
 TMPL bool
@@ -83,69 +173,43 @@ hashmap_rep<T,U>::empty () {
 TMPL U&
 hashmap_rep<T,U>::bracket_rw (T x) {
   register int hv= hash (x);
-  list<hashentry<T,U> >  l (a [hv & (n-1)]);
-  while (!is_nil (l)) {
-    if (l->item.code == hv && l->item.key == x)
-      return l->item.im;
-    l= l->next;
-  }
-  if (size >= n*max) resize (n<<1);
-  list<hashentry<T,U> >& rl= a [hv & (n-1)];
-  rl= list<hashentry<T,U> > (H (hv, x, init), rl);
-  size ++;
-  return rl->item.im;
+  register int i = find (x, hv);
+  if (i >= 0) return a[i].im;
+  return insert (hv, x, init);
 }
 
 TMPL U
 hashmap_rep<T,U>::bracket_ro (T x) {
-  register int hv= hash (x);
-  list<hashentry<T,U> >  l (a [hv & (n-1)]);
-  while (!is_nil (l)) {
-    if (l->item.code == hv && l->item.key == x)
-      return l->item.im;
-    l= l->next;
-  }
+  register int i= find (x, hash (x));
+  if (i >= 0) return a[i].im;
   return init;
 }
 
 TMPL void
 hashmap_rep<T,U>::reset (T x) {
-  register int hv= hash (x);
-  list<hashentry<T,U> > *l= &(a [hv & (n-1)]);
-  while (!is_nil (*l)) {
-    if ((*l)->item.code == hv && (*l)->item.key == x) {
-      *l= (*l)->next;
-      size --;
-      if (size < (n>>1) * max) resize (n>>1);
-      return;
-    }
-    l= &((*l)->next);
-  }
+  register int i= find (x, hash (x));
+  if (i < 0) return;
+  remove (i);
+  if (n > 8 && (size << 3) < n) resize (n>>1);
 }
 
 TMPL void
 hashmap_rep<T,U>::generate (void (*routine) (T)) {
   int i;
-  for (i=0; i<n; i++) {
-    list<hashentry<T,U> > l (a[i]);
-    while (!is_nil (l)) {
-      routine (l->item.key);
-      l=l->next;
-    }
-  }
+  for (i=0; i<n; i++)
+    if (used[i]) routine (a[i].key);
 }
 
 TMPL tm_ostream&
 operator << (tm_ostream& out, hashmap<T,U> h) {
   int i= 0, j= 0, n= h->n, size= h->size;
   out << "{ ";
-  for (; i<n; i++) {
-    list<hashentry<T,U> > l= h->a[i];
-    for (; !is_nil (l); l= l->next, j++) {
-      out << l->item;
+  for (; i<n; i++)
+    if (h->used[i]) {
+      out << h->a[i];
       if (j != size-1) out << ", ";
+      j++;
     }
-  }
   out << " }";
   return out;
 }
@@ -153,33 +217,27 @@ operator << (tm_ostream& out, hashmap<T,U> h) {
 TMPL hashmap<T,U>::operator tree () {
   int i=0, j=0, n=rep->n, size=rep->size;
   tree t (COLLECTION, size);
-  for (; i<n; i++) {
-    list<hashentry<T,U> > l= rep->a[i];
-    for (; !is_nil (l); l= l->next, j++)
-      t[j]= (tree) l->item;
-  }
+  for (; i<n; i++)
+    if (rep->used[i]) t[j++]= (tree) rep->a[i];
   return t;
 }
 
 TMPL void
 hashmap_rep<T,U>::join (hashmap<T,U> h) {
   int i= 0, n= h->n;
-  for (; i<n; i++) {
-    list<hashentry<T,U> > l= h->a[i];
-    for (; !is_nil(l); l= l->next)
-      bracket_rw (l->item.key)= copy (l->item.im);
-  }
+  for (; i<n; i++)
+    if (h->used[i]) {
+      U y= copy (h->a[i].im);
+      bracket_rw (h->a[i].key)= y;
+    }
 }
 
 TMPL bool
 operator == (hashmap<T,U> h1, hashmap<T,U> h2) {
   if (h1->size != h2->size) return false;
   int i= 0, n= h1->n;
-  for (; i<n; i++) {
-    list<hashentry<T,U> > l= h1->a[i];
-    for (; !is_nil(l); l=l->next)
-      if (h2[l->item.key] != l->item.im) return false;
-  }
+  for (; i<n; i++)
+    if (h1->used[i] && h2[h1->a[i].key] != h1->a[i].im) return false;
   return true;
 }
 
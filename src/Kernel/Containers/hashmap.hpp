@@ -7,6 +7,19 @@
 * This software falls under the GNU general public license version 3 or later.
 * It comes WITHOUT ANY WARRANTY WHATSOEVER. For details, see the file LICENSE
 * in the root directory or <http://www.gnu.org/licenses/gpl-3.0.html>.
+*******************************************************************************
+* The entries are stored in a flat table using open addressing with linear
+* probing, together with the hash codes of their keys.  Entries never move
+* when new keys are inserted, unless the table grows.  Removals use backward
+* shifting instead of tombstones, so that they may move any other entry.
+* Hence, references returned by bracket_rw remain valid until the next
+* insertion of a new key, but not across any removal, contrary to the
+* former chained implementation where a removal only invalidated the
+* removed entry.  Iterators walk the slots and take a snapshot of the
+* remaining keys when the map is modified by a removal or a resize.
+* The hash code of a key is computed once per lookup or insertion, and
+* probing compares the stored codes before the keys.  For tree keys,
+* this code only takes constant time when the key is interned.
 ******************************************************************************/
 
 #ifndef HASHMAP_H
@@ -20,6 +33,13 @@ template<class T,class U> class rel_hashmap;
 template<class T,class U> class rel_hashmap_rep;
 template<class T,class U> class hashmap_iterator_rep;
 
+class hashmap_iterator_base {
+public:
+  hashmap_iterator_base* next_iterator;
+  inline virtual ~hashmap_iterator_base () {}
+  virtual void detach () = 0;
+};
+
 template<class T,class U> int N (hashmap<T,U> a);
 template<class T,class U> tm_ostream& operator << (tm_ostream& out, hashmap<T,U> h);
 template<class T,class U> hashmap<T,U> copy (hashmap<T,U> h);
@@ -39,16 +59,28 @@ template<class T, class U> struct hashentry {
 
 template<class T, class U> class hashmap_rep: concrete_struct {
   int size;                  // size of hashmap (nr of entries)
-  int n;                     // nr of keys (a power of two)
-  int max;                   // mean number of entries per key
+  int n;                     // nr of slots (a power of two)
+  int max;                   // unused, the load factor is at most 3/4
   U   init;                  // default entry
-  list<hashentry<T,U> >* a;  // the array of entries
+  hashentry<T,U>* a;         // the slots, with the hash codes of the keys
+  bool* used;                // which slots are occupied
+  hashmap_iterator_base* iterators; // iterators which walk the slots
+
+  void allocate (int n2);
+  void release ();
+  int  find (T x, int hv);
+  U&   insert (int hv, T x, U y);
+  void remove (int i);
+  void detach_iterators ();
+  void attach_iterator (hashmap_iterator_base* it);
+  void forget_iterator (hashmap_iterator_base* it);
 
 public:
   inline hashmap_rep<T,U>(U init2, int n2=1, int max2=1):
-    size(0), n(n2), max(max2), init(init2),
-    a(tm_new_array<list<hashentry<T,U> > > (n)) {}
-  inline ~hashmap_rep<T,U> () { tm_delete_array (a); }
+    size(0), n(1), max(max2), init(init2), iterators(NULL) {
+      while (n < n2) n <<= 1;
+      allocate (n); }
+  inline ~hashmap_rep<T,U> () { release (); }
   void resize (int n);
   void reset (T x);
   void generate (void (*routine) (T));
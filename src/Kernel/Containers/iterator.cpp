@@ -91,41 +91,57 @@ iterate (hashset<T> h) {
 
 // hashmap_iterator
 template<class T, class U>
-class hashmap_iterator_rep: public iterator_rep<T> {
+class hashmap_iterator_rep:
+  public iterator_rep<T>, public hashmap_iterator_base
+{
   hashmap<T,U> h;
-  int i;
-  list<hashentry<T,U> > l;
-  void spool ();
+  int i;         // the next slot to be inspected
+  bool walking;  // are we still walking the slots of h?
+  list<T> l;     // the remaining keys, once h has been modified
 
 public:
   hashmap_iterator_rep (hashmap<T,U> h);
+  ~hashmap_iterator_rep ();
+  void detach ();
   bool busy ();
   T next ();
 };
 
 template<class T, class U>
 hashmap_iterator_rep<T,U>::hashmap_iterator_rep (hashmap<T,U> h2):
-  h (h2), i (0), l (h2->a[0]) {}
+  h (h2), i (0), walking (true) {
+    next_iterator= NULL;
+    h->attach_iterator (this); }
+
+template<class T, class U>
+hashmap_iterator_rep<T,U>::~hashmap_iterator_rep () {
+  if (walking) h->forget_iterator (this);
+}
 
 template<class T, class U> void
-hashmap_iterator_rep<T,U>::spool () {
-  if (i >= h->n) return;
-  while (is_nil (l)) {
-    if ((++i) >= h->n) return;
-    l= h->a[i];
-  }
+hashmap_iterator_rep<T,U>::detach () {
+  // called by h before its entries move, so that h may be
+  // modified while it is being iterated over
+  for (int j= h->n - 1; j >= i; j--)
+    if (h->used[j]) l= list<T> (h->a[j].key, l);
+  walking= false;
 }
 
 template<class T, class U> bool
 hashmap_iterator_rep<T,U>::busy () {
-  spool ();
-  return i < h->n;
+  if (!walking) return !is_nil (l);
+  while (i < h->n && !h->used[i]) i++;
+  if (i < h->n) return true;
+  h->forget_iterator (this);
+  walking= false;
+  return false;
 }
 
 template<class T, class U> T
 hashmap_iterator_rep<T,U>::next () {
   ASSERT (busy (), "end of iterator");
-  T x (l->item.key);
+  if (walking) return h->a[i++].key;
+  T x (l->item);
   l= l->next;
   return x;
 }
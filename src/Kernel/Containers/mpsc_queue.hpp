@@ -0,0 +1,70 @@
+
+/******************************************************************************
+* MODULE     : mpsc_queue.hpp
+* DESCRIPTION: Lock-free queues with several producers and a single consumer
+* COPYRIGHT  : (C) 2026  the TeXmacs team
+*******************************************************************************
+* This software falls under the GNU general public license version 3 or later.
+* It comes WITHOUT ANY WARRANTY WHATSOEVER. For details, see the file LICENSE
+* in the root directory or <http://www.gnu.org/licenses/gpl-3.0.html>.
+******************************************************************************/
+
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+#include "basic.hpp"
+#include <atomic>
+
+/******************************************************************************
+* Intrusive queue of Vyukov: any thread may push an item with a single
+* atomic exchange, whereas only one thread (the owner) may pop items.
+* The queue always contains a stub node, whose successor is the oldest item.
+* Items pushed by a same thread are popped in the order of pushing.
+* Nodes allocated in one thread and freed in another one are only
+* safe when the kernel is built with USE_ATOMIC_REFCOUNT.
+******************************************************************************/
+
+template<class T>
+class mpsc_queue {
+  struct node {
+    std::atomic<node*> next;
+    T item;
+    node (): next (NULL) {}
+    node (const T& x): next (NULL), item (x) {}
+  };
+  std::atomic<node*> head; // most recently pushed node
+  node* tail;              // stub node, owned by the consumer
+
+  mpsc_queue (const mpsc_queue&);
+  mpsc_queue& operator = (const mpsc_queue&);
+
+public:
+  inline mpsc_queue (): head (NULL), tail (tm_new<node> ()) {
+    head.store (tail, std::memory_order_relaxed); }
+  inline ~mpsc_queue () {
+    T x;
+    while (pop (x)) {}
+    tm_delete (tail); }
+
+  inline void push (const T& x) {
+    // may be called from any thread
+    node* n= tm_new<node> (x);
+    node* prev= head.exchange (n, std::memory_order_acq_rel);
+    prev->next.store (n, std::memory_order_release); }
+
+  inline bool pop (T& x) {
+    // only to be called from the consumer thread; fails if the queue
+    // is empty or if a concurrent push has not been completed yet
+    node* next= tail->next.load (std::memory_order_acquire);
+    if (next == NULL) return false;
+    x= next->item;
+    next->item= T ();
+    tm_delete (tail);
+    tail= next;
+    return true; }
+
+  inline bool is_empty () {
+    // only reliable in the consumer thread
+    return tail->next.load (std::memory_order_acquire) == NULL; }
+};
+
+#endif // defined MPSC_QUEUE_H
@@ -65,17 +65,12 @@ template <class T, class U> void
 rel_hashmap_rep<T,U>::find_changes (hashmap<T,U>& CH) {
   int i;
   rel_hashmap<T,U> h (item, next);
-  list<hashentry<T,U> > remove;
-  for (i=0; i<CH->n; i++) {
-    list<hashentry<T,U> > l (CH->a[i]);
-    while (!is_nil (l)) {
-      if (h [l->item.key] == l->item.im)
-	remove= list<hashentry<T,U> > (l->item, remove);
-      l=l->next;
-    }
-  }
+  list<T> remove;
+  for (i=0; i<CH->n; i++)
+    if (CH->used[i] && h [CH->a[i].key] == CH->a[i].im)
+      remove= list<T> (CH->a[i].key, remove);
   while (!is_nil (remove)) {
-    CH->reset (remove->item.key);
+    CH->reset (remove->item);
     remove= remove->next;
   }
 }
@@ -83,17 +78,12 @@ rel_hashmap_rep<T,U>::find_changes (hashmap<T,U>& CH) {
 template <class T, class U> void
 rel_hashmap_rep<T,U>::find_differences (hashmap<T,U>& CH) {
   int i;
-  list<hashentry<T,U> > add;
-  for (i=0; i<item->n; i++) {
-    list<hashentry<T,U> > l (item->a[i]);
-    while (!is_nil (l)) {
-      if (!CH->contains (l->item.key))
-	add= list<hashentry<T,U> > (l->item, add);
-      l=l->next;
-    }
-  }
+  list<T> add;
+  for (i=0; i<item->n; i++)
+    if (item->used[i] && !CH->contains (item->a[i].key))
+      add= list<T> (item->a[i].key, add);
   while (!is_nil (add)) {
-    CH (add->item.key)= next [add->item.key];
+    CH (add->item)= next [add->item];
     add= add->next;
   }
   find_changes (CH);
@@ -102,13 +92,9 @@ rel_hashmap_rep<T,U>::find_differences (hashmap<T,U>& CH) {
 template <class T, class U> void
 rel_hashmap_rep<T,U>::change (hashmap<T,U> CH) {
   int i;
-  for (i=0; i<CH->n; i++) {
-    list<hashentry<T,U> > l (CH->a[i]);
-    while (!is_nil (l)) {
-      item (l->item.key)= l->item.im;
-      l=l->next;
-    }
-  }
+  for (i=0; i<CH->n; i++)
+    if (CH->used[i])
+      item (CH->a[i].key)= CH->a[i].im;
 }
 
 template <class T, class U> tm_ostream&
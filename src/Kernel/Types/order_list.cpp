@@ -0,0 +1,80 @@
+
+/******************************************************************************
+* MODULE     : order_list.cpp
+* DESCRIPTION: Order maintenance for constant time comparisons of positions
+* COPYRIGHT  : (C) 2026  the TeXmacs team
+*******************************************************************************
+* This software falls under the GNU general public license version 3 or later.
+* It comes WITHOUT ANY WARRANTY WHATSOEVER. For details, see the file LICENSE
+* in the root directory or <http://www.gnu.org/licenses/gpl-3.0.html>.
+******************************************************************************/
+
+#include "order_list.hpp"
+
+#define ORDER_BITS 62
+#define ORDER_END  (((DN) 1) << ORDER_BITS)
+
+static order_item order_head= NULL;
+
+order_item
+order_first () {
+  // the head of the list, which precedes all other items
+  if (order_head == NULL) {
+    order_head= tm_new<order_item_rep> ();
+    order_head->label= 0;
+    order_head->prev = NULL;
+    order_head->next = NULL;
+  }
+  return order_head;
+}
+
+static void
+order_relabel (order_item x) {
+  // find the smallest aligned range of labels around x whose density
+  // is below (3/4)^i, and distribute the labels in that range evenly
+  order_item lo= x, hi= x;
+  int i, n= 1;
+  double capacity= 1.0;
+  for (i=1; i<=ORDER_BITS; i++) {
+    DN w= ((DN) 1) << i, base= x->label & ~(w-1);
+    while (lo->prev != NULL && lo->prev->label >= base) { lo= lo->prev; n++; }
+    while (hi->next != NULL && hi->next->label < base + w) { hi= hi->next; n++; }
+    capacity *= 4.0 / 3.0;
+    if (i >= 2 && ((double) (n + 1)) <= capacity) {
+      DN gap= w / ((DN) (n + 1)), l= base;
+      for (order_item it= lo; true; it= it->next) {
+        it->label= l;
+        l += gap;
+        if (it == hi) break;
+      }
+      return;
+    }
+  }
+  FAILED ("order list overflow");
+}
+
+order_item
+order_new (order_item after) {
+  // create a new item immediately after a given one
+  if (after == NULL) after= order_first ();
+  DN hi= (after->next == NULL? ORDER_END: after->next->label);
+  if (hi - after->label < 2) {
+    order_relabel (after);
+    hi= (after->next == NULL? ORDER_END: after->next->label);
+  }
+  order_item it= tm_new<order_item_rep> ();
+  it->label= after->label + ((hi - after->label) >> 1);
+  it->prev = after;
+  it->next = after->next;
+  if (after->next != NULL) after->next->prev= it;
+  after->next= it;
+  return it;
+}
+
+void
+order_delete (order_item it) {
+  ASSERT (it != order_head, "cannot delete head of order list");
+  if (it->prev != NULL) it->prev->next= it->next;
+  if (it->next != NULL) it->next->prev= it->prev;
+  tm_delete (it);
+}
@@ -0,0 +1,37 @@
+
+/******************************************************************************
+* MODULE     : order_list.hpp
+* DESCRIPTION: Order maintenance for constant time comparisons of positions
+* COPYRIGHT  : (C) 2026  the TeXmacs team
+*******************************************************************************
+* This software falls under the GNU general public license version 3 or later.
+* It comes WITHOUT ANY WARRANTY WHATSOEVER. For details, see the file LICENSE
+* in the root directory or <http://www.gnu.org/licenses/gpl-3.0.html>.
+******************************************************************************/
+
+#ifndef ORDER_LIST_H
+#define ORDER_LIST_H
+#include "basic.hpp"
+
+/******************************************************************************
+* The order list is a global doubly linked list of items whose labels
+* increase along the list, so that the relative order of two items is
+* obtained by comparing their labels.  When there is no room left for
+* a new label, a small range of neighbouring items is relabeled evenly
+* (Dietz and Sleator 1987, Bender et al. 2002), in O(log n) amortized time.
+******************************************************************************/
+
+struct order_item_rep {
+  DN label;
+  order_item_rep* prev;
+  order_item_rep* next;
+};
+typedef order_item_rep* order_item;
+
+order_item order_first ();
+order_item order_new (order_item after);
+void       order_delete (order_item it);
+inline bool order_less (order_item x, order_item y) {
+  return x->label < y->label; }
+
+#endif // defined ORDER_LIST_H
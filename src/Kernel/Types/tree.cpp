@@ -12,6 +12,7 @@
 #include "generic_tree.hpp"
 #include "drd_std.hpp"
 #include "hashset.hpp"
+#include "hashmap.hpp"
 
 /******************************************************************************
 * Main routines for trees
@@ -217,10 +218,32 @@ hash (array<tree> a) {
   return h;
 }
 
+// The tables of interned trees are global and not thread-safe: intern and
+// intern_collect update them and hash consults them without locking,
+// so that trees should only be interned and hashed from one thread.
+static hashmap<pointer,int> intern_codes (0); // representative -> hash
+
+static int
+hash_uncached (tree t) {
+  if (is_atomic (t)) return hash (t->label);
+  int i, h= 0, n= N(t);
+  for (i=0; i<n; i++) {
+    h= (h<<7) + (h>>25);
+    h= h + hash_uncached (t[i]);
+  }
+  return ((int) L(t)) ^ h;
+}
+
 int
 hash (tree t) {
+  // the table of interned trees is only consulted at the top level.
+  // Hashes are only memoized for interned trees: other trees may be
+  // modified in place through any handle on one of their subtrees,
+  // which would not invalidate a hash stored in their ancestors.
   if (is_atomic (t)) return hash (t->label);
-  else return ((int) L(t)) ^ hash (A(t));
+  if (N(intern_codes) != 0 && is_interned (t))
+    return intern_codes [(pointer) inside (t)]; // cached hash
+  return hash_uncached (t);
 }
 
 string
@@ -532,3 +555,133 @@ simplify_correct (tree t) {
   if (is_document (r)) r= simplify_document (r);
   return r;
 }
+
+/******************************************************************************
+* Hash-consing of immutable trees
+*******************************************************************************
+* intern (t) returns a canonical representative of t, which is shared by
+* all interned trees that are structurally equal to t.  Representatives are
+* built bottom-up from interned subtrees, so that two interned trees are
+* equal if and only if they are strong_equal, and their hashes are cached
+* (the cached hashes coincide with hash (t), which uses them in turn).
+* Trees with generic subtrees cannot be hashed and are left alone.
+* Interned trees should never be modified in place, nor be inserted into
+* documents which are being edited.  Representatives which are only
+* referenced by the table itself are released by intern_collect.
+******************************************************************************/
+
+static array<tree> intern_slots;              // open addressing table
+static array<int>  intern_slot_codes;         // hashes of the slots
+static array<bool> intern_used;
+static int         intern_nr= 0;
+
+static inline int
+intern_start (int h, int mask) {
+  unsigned int x= ((unsigned int) h) * 2654435761u;
+  return (int) ((x ^ (x >> 15)) & mask);
+}
+
+static int
+intern_code (tree t) {
+  if (is_atomic (t)) return hash (t->label);
+  int i, h= 0, n= N(t);
+  for (i=0; i<n; i++) {
+    h= (h<<7) + (h>>25);
+    h= h + intern_codes [(pointer) inside (t[i])];
+  }
+  return ((int) L(t)) ^ h;
+}
+
+static bool
+intern_same (tree t, tree u) {
+  // t and u have interned children
+  if (L(t) != L(u)) return false;
+  if (is_atomic (t)) return t->label == u->label;
+  int i, n= N(t);
+  if (N(u) != n) return false;
+  for (i=0; i<n; i++)
+    if (!strong_equal (t[i], u[i])) return false;
+  return true;
+}
+
+static void
+intern_insert (tree t, int h) {
+  int mask= N(intern_slots) - 1, i= intern_start (h, mask);
+  while (intern_used[i]) i= (i+1) & mask;
+  intern_slots[i]= t;
+  intern_slot_codes[i]= h;
+  intern_used[i]= true;
+  intern_nr++;
+}
+
+static void
+intern_resize (int size) {
+  array<tree> old_slots= intern_slots;
+  array<int>  old_codes= intern_slot_codes;
+  array<bool> old_used = intern_used;
+  intern_slots= array<tree> (size);
+  intern_slot_codes= array<int> (size);
+  intern_used = array<bool> (size);
+  intern_nr= 0;
+  for (int i=0; i<size; i++) intern_used[i]= false;
+  for (int i=0; i<N(old_slots); i++)
+    if (old_used[i]) intern_insert (old_slots[i], old_codes[i]);
+}
+
+void
+intern_collect () {
+  bool changed= true;
+  while (changed) {
+    changed= false;
+    for (int i=0; i<N(intern_slots); i++)
+      if (intern_used[i] && inside (intern_slots[i])->ref_count == 1) {
+        intern_codes->reset ((pointer) inside (intern_slots[i]));
+        intern_slots[i]= tree ();
+        intern_used[i]= false;
+        intern_nr--;
+        changed= true;
+      }
+  }
+  intern_resize (N(intern_slots));
+}
+
+bool
+is_interned (tree t) {
+  return intern_codes->contains ((pointer) inside (t));
+}
+
+int
+interned_hash (tree t) {
+  return hash (t);
+}
+
+tree
+intern (tree t) {
+  if (is_generic (t) || is_interned (t)) return t;
+  tree r;
+  if (is_atomic (t)) r= tree (copy (t->label));
+  else {
+    int i, n= N(t);
+    r= tree (t, n);
+    for (i=0; i<n; i++) {
+      r[i]= intern (t[i]);
+      if (!is_interned (r[i])) return t; // generic subtree
+    }
+  }
+  int h= intern_code (r);
+  if (N(intern_slots) == 0) intern_resize (1024);
+  int mask= N(intern_slots) - 1, i= intern_start (h, mask);
+  while (intern_used[i]) {
+    if (intern_slot_codes[i] == h && intern_same (intern_slots[i], r))
+      return intern_slots[i];
+    i= (i+1) & mask;
+  }
+  if (2 * (intern_nr + 1) > N(intern_slots)) {
+    intern_collect ();
+    if (4 * (intern_nr + 1) > N(intern_slots))
+      intern_resize (2 * N(intern_slots));
+  }
+  intern_codes ((pointer) inside (r))= h;
+  intern_insert (r, h);
+  return r;
+}
@@ -97,6 +97,9 @@ public:
   friend class QTMTreeModel;  // hack: wouldn't need it with a widget_observer
 #endif
   friend blackbox as_blackbox (const tree& t);
+  friend inline tree_rep* hold_tree_rep (tree t);
+  friend inline tree open_tree_rep (tree_rep* rep);
+  friend inline void release_tree_rep (tree_rep* rep);
 };
 
 class tree_rep: concrete_struct {
@@ -105,6 +108,9 @@ public:
   observer obs;
   inline tree_rep (tree_label op2): op (op2) {}
   friend class tree;
+  friend void intern_collect ();
+  friend inline tree_rep* hold_tree_rep (tree t);
+  friend inline void release_tree_rep (tree_rep* rep);
 };
 
 class atomic_rep: public tree_rep {
@@ -152,19 +158,27 @@ typedef tree scheme_tree;
 #endif
 
 void destroy_tree_rep (tree_rep* rep);
-inline tree::tree (tree_rep* rep2): rep (rep2) { rep->ref_count++; }
-inline tree::tree (const tree& x): rep (x.rep) { rep->ref_count++; }
+inline tree::tree (tree_rep* rep2): rep (rep2) { REF_COUNT_INC (rep); }
+inline tree::tree (const tree& x): rep (x.rep) { REF_COUNT_INC (rep); }
 inline tree::~tree () {
-  if ((--rep->ref_count)==0) { destroy_tree_rep (rep); rep= NULL; } }
+  if (REF_COUNT_DEC (rep)==0) { destroy_tree_rep (rep); rep= NULL; } }
 inline atomic_rep* tree::operator -> () {
   CHECK_ATOMIC (*this);
   return static_cast<atomic_rep*> (rep); }
 inline tree& tree::operator = (tree x) {
-  x.rep->ref_count++;
-  if ((--rep->ref_count)==0) destroy_tree_rep (rep);
+  REF_COUNT_INC (x.rep);
+  if (REF_COUNT_DEC (rep)==0) destroy_tree_rep (rep);
   rep= x.rep;
   return *this; }
 
+// references to tree representations held outside of trees (scheme handles)
+inline tree_rep* hold_tree_rep (tree t) {
+  REF_COUNT_INC (t.rep); return t.rep; }
+inline tree open_tree_rep (tree_rep* rep) {
+  return tree (rep); }
+inline void release_tree_rep (tree_rep* rep) {
+  if (REF_COUNT_DEC (rep)==0) destroy_tree_rep (rep); }
+
 inline tree::tree ():
   rep (tm_new<atomic_rep> (string ())) {}
 inline tree::tree (const char *s):
@@ -289,6 +303,15 @@ tree simplify_concat (tree t);
 tree simplify_document (tree t);
 tree simplify_correct (tree t);
 
+/******************************************************************************
+* Hash-consing of immutable trees
+******************************************************************************/
+
+tree intern (tree t);
+bool is_interned (tree t);
+int  interned_hash (tree t);
+void intern_collect ();
+
 /******************************************************************************
 * Compound trees
 ******************************************************************************/
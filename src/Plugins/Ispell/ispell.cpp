@@ -15,6 +15,14 @@
 #include "tm_link.hpp"
 #include "convert.hpp"
 #include "language.hpp"
+#include "persistent.hpp"
+#include "analyze.hpp"
+#include "iterator.hpp"
+#include "sys_utils.hpp"
+
+#define ISPELL_PIPELINE 64
+#define ISPELL_CACHE_SIZE 8192
+#define ISPELL_STORE_SIZE 65536
 
 string ispell_encode (string lan, string s);
 string ispell_decode (string lan, string s);
@@ -23,16 +31,61 @@ string ispell_decode (string lan, string s);
 * The connection resource
 ******************************************************************************/
 
+/******************************************************************************
+* Words are sent to the spell checker without waiting for the answers,
+* with at most ISPELL_PIPELINE pending words, and the answers are parsed
+* in the order of the queries as soon as they arrive.  The verdicts are
+* memorized in two generations of at most ISPELL_CACHE_SIZE words, which
+* approximates a least recently used cache.  They are also saved on disk,
+* in batches whenever a word is accepted or inserted and at the end of
+* spell checking, together with a stamp of the dictionaries in use.
+* On disk, the verdicts are kept in two generations of at most
+* ISPELL_STORE_SIZE words as well: when the current one is full, the
+* older one is cleared and becomes the current one, and the verdicts
+* which are found in the older generation are saved again in the
+* current one.  The personal word list is not part of the stamp, since
+* it is saved at the end of each session; the words which are inserted
+* from TeXmacs are saved as correct in any case.
+* When a dictionary has been provided using ispell_dictionary, then
+* the words are checked locally, without any external spell checker.
+******************************************************************************/
+
 RESOURCE(ispeller);
 struct ispeller_rep: rep<ispeller> {
-  string  lan; // name of the session
-  tm_link ln;  // the pipe
+  string  lan;                      // name of the session
+  string  checker;                  // aspell or hunspell
+  tm_link ln;                       // the pipe
+  string  buf;                      // answers which have not been parsed yet
+  array<string> pending;            // words whose answers are still to come
+  int     done;                     // number of answered pending words
+  hashmap<string,bool> queued;      // the pending words
+  hashmap<string,tree> verdicts;    // recently checked words
+  hashmap<string,tree> old_verdicts;// previous generation of verdicts
+  hashmap<string,bool> accepted;    // words accepted during this session
+  url     store;                    // persistent storage for the verdicts
+  url     old_store;                // previous generation of saved verdicts
+  int     stored;                   // number of verdicts saved in store
+  bool    persist;                  // whether verdicts are saved on disk
+  array<string> unsaved;            // verdicts still to be saved
+  array<string> unsaved_verdicts;
+  bool    local;                    // use a local dictionary
+  hashmap<string,bool> dictionary;  // the local dictionary
 
 public:
   ispeller_rep (string lan);
   string start ();
   string retrieve ();
   void   send (string cmd);
+  bool   alive ();
+  bool   known (string s, tree& t);
+  void   remember (string s, tree t, bool save);
+  void   open_store (string banner);
+  void   rotate_store ();
+  void   save ();
+  void   query (string s);
+  bool   receive (bool wait);
+  tree   check (string s);
+  tree   local_check (string s);
 };
 RESOURCE_CODE(ispeller);
 
@@ -40,7 +93,10 @@ RESOURCE_CODE(ispeller);
 * Routines for ispellers
 ******************************************************************************/
 
-ispeller_rep::ispeller_rep (string lan2): rep<ispeller> (lan2), lan (lan2) {}
+ispeller_rep::ispeller_rep (string lan2):
+  rep<ispeller> (lan2), lan (lan2), done (0), queued (false),
+  verdicts (UNINIT), old_verdicts (UNINIT), accepted (false),
+  stored (0), persist (false), local (false), dictionary (false) {}
 
 #ifdef OS_MINGW
 bool find_win_spell(string &cmd , string &name) {
@@ -75,6 +131,7 @@ bool find_win_spell(string &cmd , string &name) {
 
 string
 ispeller_rep::start () {
+  if (local) return "ok";
   if (is_nil (ln)) {
     string cmd,lang_opt,enc_opt,name;
 #ifdef OS_WIN32
@@ -83,12 +140,12 @@ ispeller_rep::start () {
 #else
     if (exists_in_path ("aspell")) {
       cmd= "aspell";
-      name = cmd;
+      name = copy (cmd);
     }
     else 
       if (exists_in_path ("hunspell")) {
         cmd= "hunspell";
-        name = cmd;
+        name = copy (cmd);
       }
       else 
 #ifdef OS_MINGW
@@ -111,8 +168,16 @@ ispeller_rep::start () {
       cmd << lang_opt << language_to_locale (lan);
 #endif
     ln= make_pipe_link (cmd);
+#ifdef OS_WIN32
+    name= "aspell";
+#endif
+    checker= name;
   }
   if (ln->alive) return "ok";
+  buf= "";
+  pending= array<string> ();
+  done= 0;
+  queued= hashmap<string,bool> (false);
   string message= ln->start ();
   if (DEBUG_IO) debug_spell << "Received " << message << "\n";
   if (starts (message, "Error: ")) {
@@ -122,10 +187,14 @@ ispeller_rep::start () {
   message= retrieve ();
   if (DEBUG_IO) debug_spell << "Received " << message << "\n";
 #ifdef OS_WIN32
-  if (search_forwards (message, 0, "@(#)")) return "ok";
+  bool ok= search_forwards (message, 0, "@(#)");
 #else
-  if (starts (message, "@(#)")) return "ok";
+  bool ok= starts (message, "@(#)");
 #endif
+  if (ok) {
+    open_store (message);
+    return "ok";
+  }
   if (ln->alive) ln->stop ();
   return "Error: no dictionary for " * lan;
 }
@@ -159,6 +228,11 @@ ispeller_rep::send (string cmd) {
   ln->write (ispell_encode (lan, cmd) * "\n", LINK_IN);
 }
 
+bool
+ispeller_rep::alive () {
+  return local || (!is_nil (ln) && ln->alive);
+}
+
 /******************************************************************************
 * Internationalization
 ******************************************************************************/
@@ -211,17 +285,263 @@ parse_ispell (string s) {
 static void
 ispell_send (string lan, string s) {
   ispeller sc= ispeller (lan);
-  if ((!is_nil (sc)) && sc->ln->alive) sc->send (s);
+  if ((!is_nil (sc)) && (!sc->local) && sc->alive ()) sc->send (s);
 }
 
+/******************************************************************************
+* Memorizing verdicts
+******************************************************************************/
+
 static string
-ispell_eval (string lan, string s) {
-  ispeller sc= ispeller (lan);
-  if ((!is_nil (sc)) && sc->ln->alive) {
-    sc->send (s);
-    return sc->retrieve ();
+encode_verdict (tree t) {
+  if (is_atomic (t)) return t->label;
+  string r= "#";
+  for (int i=0; i<N(t); i++) r << "\n" << t[i]->label;
+  return r;
+}
+
+static tree
+decode_verdict (string s) {
+  if (!starts (s, "#")) return s;
+  tree t (TUPLE);
+  int i, start= 2;
+  for (i=start; i<=N(s); i++)
+    if (i == N(s) || s[i] == '\n') {
+      t << s (start, i);
+      start= i+1;
+    }
+  return t;
+}
+
+bool
+ispeller_rep::known (string s, tree& t) {
+  if (accepted->contains (s)) t= "ok";
+  else if (verdicts->contains (s)) t= verdicts[s];
+  else if (old_verdicts->contains (s)) {
+    t= old_verdicts[s];
+    remember (s, t, false);
+  }
+  else if (persist && persistent_contains (store, s)) {
+    t= decode_verdict (persistent_get (store, s));
+    remember (s, t, false);
+  }
+  else if (persist && persistent_contains (old_store, s)) {
+    t= decode_verdict (persistent_get (old_store, s));
+    remember (s, t, true);
+  }
+  else return false;
+  return true;
+}
+
+void
+ispeller_rep::remember (string s, tree t, bool save) {
+  if (N(verdicts) >= ISPELL_CACHE_SIZE) {
+    old_verdicts= verdicts;
+    verdicts= hashmap<string,tree> (UNINIT);
+  }
+  verdicts (s)= t;
+  if (save && persist) {
+    unsaved << s;
+    unsaved_verdicts << encode_verdict (t);
   }
-  return "";
+}
+
+static string
+dictionary_stamp (string checker, string lan, string banner) {
+  // identifies the dictionaries in use, so that the saved verdicts
+  // can be dropped when the checker or one of its word lists changes
+  string loc= language_to_locale (lan);
+  array<url> a;
+#ifdef OS_WIN32
+  a << url ("$TEXMACS_PATH/bin/aspell/dict");
+#else
+  if (checker == "hunspell") {
+    url dirs= url_system ("/usr/share/hunspell") |
+              url_system ("/usr/share/myspell") |
+              url_system ("/usr/share/myspell/dicts") |
+              url_system ("/Library/Spelling") |
+              url_system ("$HOME/Library/Spelling");
+    if (get_env ("DICPATH") != "") dirs= url_system ("$DICPATH") | dirs;
+    a << resolve (dirs * url (loc * ".dic"));
+  }
+  else {
+    string dir= trim_spaces (eval_system ("aspell config dict-dir"));
+    if (dir != "") a << url_system (dir);
+  }
+#endif
+  string r= checker * "\n" * trim_spaces (banner);
+  for (int i=0; i<N(a); i++)
+    if (!is_none (a[i]) && exists (a[i]))
+      r << "\n" << as_string (a[i]) << " "
+        << as_string (last_modified (a[i], false));
+  return r;
+}
+
+static void
+open_generation (url u, string stamp) {
+  // drop the saved verdicts if the dictionaries changed since
+  if (persistent_get (u, "#stamp") != stamp) {
+    persistent_clear (u);
+    persistent_set (u, "#stamp", stamp);
+  }
+}
+
+static int
+generation_number (url u) {
+  string s= persistent_get (u, "#generation");
+  return is_int (s)? as_int (s): 0;
+}
+
+void
+ispeller_rep::open_store (string banner) {
+  if (persist) return;
+  string name= checker * "-" * lan;
+  url u1= url ("$TEXMACS_HOME_PATH/system/spell", name * "-1");
+  url u2= url ("$TEXMACS_HOME_PATH/system/spell", name * "-2");
+  string stamp= dictionary_stamp (checker, lan, banner);
+  open_generation (u1, stamp);
+  open_generation (u2, stamp);
+  bool second= generation_number (u2) > generation_number (u1);
+  store    = second? u2: u1;
+  old_store= second? u1: u2;
+  string n= persistent_get (store, "#count");
+  stored= is_int (n)? as_int (n): 0;
+  persist= true;
+}
+
+void
+ispeller_rep::rotate_store () {
+  // the older generation of saved verdicts is dropped and reused
+  int gen= generation_number (store);
+  string stamp= persistent_get (store, "#stamp");
+  url u= old_store;
+  old_store= store;
+  store= u;
+  persistent_clear (store);
+  persistent_set (store, "#stamp", stamp);
+  persistent_set (store, "#generation", as_string (gen + 1));
+  stored= 0;
+}
+
+void
+ispeller_rep::save () {
+  if (persist && N(unsaved) != 0) {
+    if (stored + N(unsaved) > ISPELL_STORE_SIZE) rotate_store ();
+    persistent_set (store, unsaved, unsaved_verdicts);
+    stored += N(unsaved);
+    persistent_set (store, "#count", as_string (stored));
+  }
+  unsaved= array<string> ();
+  unsaved_verdicts= array<string> ();
+}
+
+/******************************************************************************
+* Local dictionaries
+******************************************************************************/
+
+static bool
+near_miss (string s, string w) {
+  // can w be obtained from s by one insertion, deletion, substitution
+  // or transposition of adjacent letters?
+  int n= N(s), m= N(w), i= 0;
+  if (m > n+1 || n > m+1) return false;
+  while (i<n && i<m && s[i] == w[i]) i++;
+  if (n == m) {
+    if (i == n) return false;
+    if (s (i+1, n) == w (i+1, m)) return true;
+    return i+1 < n && s[i] == w[i+1] && s[i+1] == w[i] &&
+           s (i+2, n) == w (i+2, m);
+  }
+  if (n < m) return s (i, n) == w (i+1, m);
+  return s (i+1, n) == w (i, m);
+}
+
+tree
+ispeller_rep::local_check (string s) {
+  if (dictionary->contains (s) || dictionary->contains (locase_all (s)))
+    return "ok";
+  tree t (TUPLE, "0");
+  iterator<string> it= iterate (dictionary);
+  while (it->busy ()) {
+    string w= it->next ();
+    if (near_miss (s, w)) t << w;
+  }
+  t[0]= as_string (N(t) - 1);
+  return t;
+}
+
+/******************************************************************************
+* Pipelined queries
+******************************************************************************/
+
+void
+ispeller_rep::query (string s) {
+  if (local) {
+    remember (s, local_check (s), false);
+    return;
+  }
+  while (N(pending) - done >= ISPELL_PIPELINE)
+    if (!receive (true)) return;
+  send ("^" * s);
+  pending << s;
+  queued (s)= true;
+}
+
+bool
+ispeller_rep::receive (bool wait) {
+  // parse the answer for the next pending word, if available
+  while (done < N(pending)) {
+#ifdef OS_MINGW
+    string eol= "\r\n";
+#else
+    string eol= "\n";
+#endif
+    int pos= -1, skip= 0;
+    if (starts (buf, eol)) skip= N(eol);
+    else {
+      pos= search_forwards (eol * eol, buf);
+      if (pos >= 0) skip= pos + 2 * N(eol);
+    }
+    if (skip > 0) {
+      string s= pending[done++];
+      tree   t= parse_ispell (ispell_decode (lan, buf (0, skip)));
+      buf= buf (skip, N(buf));
+      queued->reset (s);
+      if (!accepted->contains (s)) remember (s, t, true);
+      if (done == N(pending)) {
+        pending= array<string> ();
+        done= 0;
+      }
+      return true;
+    }
+    if (!alive ()) break;
+    ln->listen (wait? 10000: 0);
+    string mess = ln->read (LINK_ERR);
+    string extra= ln->read (LINK_OUT);
+    if (mess  != "") io_error << "Aspell error: " << mess << "\n";
+    if (extra == "") {
+      if (!wait) return false;
+      ln->stop ();
+      break;
+    }
+    buf << extra;
+  }
+  pending= array<string> ();
+  done= 0;
+  queued= hashmap<string,bool> (false);
+  buf= "";
+  return false;
+}
+
+tree
+ispeller_rep::check (string s) {
+  tree t;
+  if (known (s, t)) return t;
+  if (!queued->contains (s)) query (s);
+  while (queued->contains (s))
+    if (!receive (true)) break;
+  if (known (s, t)) return t;
+  return "Error: aspell does not respond";
 }
 
 /******************************************************************************
@@ -240,29 +560,91 @@ tree
 ispell_check (string lan, string s) {
   if (DEBUG_IO) debug_spell << "Check " << s << "\n";
   ispeller sc= ispeller (lan);
-  if (is_nil (sc) || (!sc->ln->alive)) {
+  if (is_nil (sc) || (!sc->alive ())) {
     string message= ispell_start (lan);
     if (starts (message, "Error: ")) return message;
   }
-  string ret_s= ispell_eval (lan, "^" * s);
-  if (starts (ret_s, "Error: ")) return ret_s;
-  return parse_ispell (ret_s);
+  return ispeller (lan)->check (s);
+}
+
+array<tree>
+ispell_check (string lan, array<string> a) {
+  if (DEBUG_IO) debug_spell << "Check " << N(a) << " words\n";
+  array<tree> r (N(a));
+  ispeller sc= ispeller (lan);
+  if (is_nil (sc) || (!sc->alive ())) {
+    string message= ispell_start (lan);
+    if (starts (message, "Error: ")) {
+      for (int i=0; i<N(a); i++) r[i]= message;
+      return r;
+    }
+    sc= ispeller (lan);
+  }
+  tree t;
+  int i, j= 0;
+  for (i=0; i<N(a); i++) {
+    for (; j<N(a); j++) {
+      if (!sc->local && N(sc->pending) - sc->done >= ISPELL_PIPELINE) break;
+      if (!sc->queued->contains (a[j]) && !sc->known (a[j], t))
+        sc->query (a[j]);
+    }
+    r[i]= sc->check (a[i]);
+  }
+  return r;
+}
+
+void
+ispell_prefetch (string lan, array<string> a) {
+  ispeller sc= ispeller (lan);
+  if (is_nil (sc) || (!sc->alive ())) return;
+  tree t;
+  for (int i=0; i<N(a); i++)
+    if (!sc->queued->contains (a[i]) && !sc->known (a[i], t)) {
+      if (!sc->local && N(sc->pending) - sc->done >= ISPELL_PIPELINE) break;
+      sc->query (a[i]);
+    }
+  while (sc->receive (false)) {}
+}
+
+void
+ispell_dictionary (string lan, array<string> a) {
+  if (DEBUG_IO) debug_spell << "Dictionary " << lan << "\n";
+  ispeller sc= ispeller (lan);
+  if (is_nil (sc)) sc= tm_new<ispeller_rep> (lan);
+  sc->local= true;
+  for (int i=0; i<N(a); i++) sc->dictionary (a[i])= true;
+  sc->verdicts= hashmap<string,tree> (UNINIT);
+  sc->old_verdicts= hashmap<string,tree> (UNINIT);
 }
 
 void
 ispell_accept (string lan, string s) {
   if (DEBUG_IO) debug_spell << "Accept " << s << "\n";
+  ispeller sc= ispeller (lan);
+  if (!is_nil (sc)) {
+    sc->accepted (s)= true;
+    sc->save ();
+  }
   ispell_send (lan, "@" * s);
 }
 
 void
 ispell_insert (string lan, string s) {
   if (DEBUG_IO) debug_spell << "Insert " << s << "\n";
+  ispeller sc= ispeller (lan);
+  if (!is_nil (sc)) {
+    sc->accepted (s)= true;
+    if (sc->local) sc->dictionary (s)= true;
+    else sc->remember (s, "ok", true);
+    sc->save ();
+  }
   ispell_send (lan, "*" * s);
 }
 
 void
 ispell_done (string lan) {
   if (DEBUG_IO) debug_spell << "End " << lan << "\n";
+  ispeller sc= ispeller (lan);
+  if (!is_nil (sc)) sc->save ();
   ispell_send (lan, "#");
 }
@@ -15,6 +15,9 @@
 
 string ispell_start (string lan);
 tree   ispell_check (string lan, string s);
+array<tree> ispell_check (string lan, array<string> a);
+void   ispell_prefetch (string lan, array<string> a);
+void   ispell_dictionary (string lan, array<string> a);
 void   ispell_accept (string lan, string s);
 void   ispell_insert (string lan, string s);
 void   ispell_done (string lan);
@@ -46,6 +46,14 @@
 #include "PDFWriter/PDFPageInput.h"
 #include "PDFWriter/PDFTiledPattern.h"
 #include "PDFWriter/TiledPatternContentContext.h"
+#include "PDFWriter/AbstractContentContext.h"
+#include "PDFWriter/OutputStringBufferStream.h"
+#include "PDFWriter/ResourcesDictionary.h"
+
+#include "zlib.h"
+#ifndef OS_MINGW
+#include <pthread.h>
+#endif
  
 /******************************************************************************
  * pdf_hummus_renderer
@@ -61,6 +69,20 @@ class pdf_image;
 class pdf_raw_image;
 class t3font;
 class pdf_pattern;
+class pdf_deflate_pool;
+
+// page content streams which are waiting for compression and assembly,
+// together with the page objects which were already written to memory
+struct pdf_pending_page {
+  ObjectIDType stream_id;
+  ObjectIDType length_id;
+  struct pdf_deflate_job* job;
+  std::string objects;
+  array<ObjectIDType> ids;
+  array<int> offsets;
+};
+
+#define PDF_PENDING_PAGES 16
 
 class pdf_hummus_renderer_rep : public renderer_rep {
   
@@ -121,7 +143,14 @@ class pdf_hummus_renderer_rep : public renderer_rep {
   
   PDFWriter pdfWriter;
   PDFPage* page;
-  PageContentContext* contentContext;
+  AbstractContentContext* contentContext;
+
+  // parallel compression of page content streams
+  bool buffered;
+  pdf_deflate_pool* pool;
+  ObjectIDType stream_id;
+  ObjectIDType length_id;
+  array<pdf_pending_page> pending;
   
   // geometry
   
@@ -155,6 +184,9 @@ class pdf_hummus_renderer_rep : public renderer_rep {
   
   void begin_page();
   void end_page();
+  void write_page (pdf_pending_page& p);
+  void assemble_page (pdf_pending_page p);
+  void assemble_pages (int keep);
   
   int get_label_id(string label);
 
@@ -276,6 +308,218 @@ write_indirect_obj(ObjectsContext&  objectsContext, ObjectIDType destId, string
 
 void pdf_image_info (url image, int& w, int& h, PDFRectangle& cropBox, double (&tMat)[6], PDFPageInput& pageInput);
   
+/******************************************************************************
+* Buffered page content streams
+******************************************************************************/
+
+// When exporting with several threads, the content stream of each page
+// is first written uncompressed into a memory buffer.  The buffers are
+// deflated by a pool of worker threads and the pages are assembled
+// into the PDF file in page order on the main thread.  The worker
+// threads only use malloc and zlib, since the TeXmacs allocator and
+// the reference counting of TeXmacs types are not thread safe.
+// Object numbers are allocated in the same order as by the sequential
+// writer and the page objects are written to memory at the end of
+// each page, so that the assembled file is identical to the file
+// produced with a single thread.  This requires that streams are
+// neither encrypted nor modified by an objects context extender.
+
+class buffered_content_context : public AbstractContentContext {
+  PDFPage* page;
+  OutputStringBufferStream buffer;
+  PDFStream* stream;
+
+public:
+  buffered_content_context (PDFHummus::DocumentContext* dc, PDFPage* p):
+    AbstractContentContext (dc), page (p),
+    stream (new PDFStream (false, &buffer, NULL, (ObjectIDType) 1, NULL)) {
+      SetPDFStreamForWrite (stream); }
+  ~buffered_content_context () { if (stream != NULL) delete stream; }
+
+  std::string finish () {
+    stream->FinalizeStreamWrite ();
+    delete stream;
+    stream= NULL;
+    return buffer.ToString (); }
+
+private:
+  ResourcesDictionary* GetResourcesDictionary () {
+    return &(page->GetResourcesDictionary ()); }
+  void ScheduleImageWrite (const std::string& inImagePath,
+                           unsigned long inImageIndex,
+                           ObjectIDType inObjectID,
+                           const PDFParsingOptions& inParsingOptions) {
+    // images are always included as form XObjects by the renderer
+    (void) inImagePath; (void) inImageIndex;
+    (void) inObjectID; (void) inParsingOptions;
+    convert_error << "pdf_hummus, unexpected image in buffered page\n"; }
+};
+
+struct pdf_deflate_job {
+  unsigned char* in;
+  size_t in_n;
+  unsigned char* out;
+  size_t out_n;
+  bool done;
+  pdf_deflate_job* next;
+};
+
+static pdf_deflate_job*
+pdf_deflate_job_create (std::string s) {
+  pdf_deflate_job* job= (pdf_deflate_job*) malloc (sizeof (pdf_deflate_job));
+  job->in_n = s.size ();
+  job->in   = (unsigned char*) malloc (job->in_n + 1);
+  memcpy (job->in, s.data (), job->in_n);
+  job->out  = NULL;
+  job->out_n= 0;
+  job->done = false;
+  job->next = NULL;
+  return job;
+}
+
+static void
+pdf_deflate_job_destroy (pdf_deflate_job* job) {
+  free (job->in);
+  free (job->out);
+  free (job);
+}
+
+static void
+pdf_deflate (pdf_deflate_job* job) {
+  // same settings as OutputFlateEncodeStream in the Hummus library
+  z_stream zs;
+  memset (&zs, 0, sizeof (z_stream));
+  zs.zalloc= Z_NULL;
+  zs.zfree = Z_NULL;
+  zs.opaque= Z_NULL;
+  // the input is only released once the compression succeeded,
+  // so that the page can still be written uncompressed otherwise
+  if (deflateInit (&zs, Z_DEFAULT_COMPRESSION) != Z_OK) return;
+  uLong bound= deflateBound (&zs, (uLong) job->in_n);
+  job->out= (unsigned char*) malloc (bound);
+  if (job->out != NULL) {
+    zs.next_in  = job->in;
+    zs.avail_in = (uInt) job->in_n;
+    zs.next_out = job->out;
+    zs.avail_out= (uInt) bound;
+    if (deflate (&zs, Z_FINISH) == Z_STREAM_END) job->out_n= zs.total_out;
+    else {
+      free (job->out);
+      job->out= NULL;
+    }
+  }
+  deflateEnd (&zs);
+  if (job->out != NULL) {
+    free (job->in);
+    job->in= NULL;
+  }
+}
+
+static string
+pdf_deflate_string (string s) {
+  z_stream zs;
+  memset (&zs, 0, sizeof (z_stream));
+  if (deflateInit (&zs, Z_DEFAULT_COMPRESSION) != Z_OK) return "";
+  c_string buf (s);
+  uLong bound= deflateBound (&zs, (uLong) N(s));
+  string r ((int) bound);
+  zs.next_in  = (unsigned char*) (char*) buf;
+  zs.avail_in = (uInt) N(s);
+  zs.next_out = (unsigned char*) &(r[0]);
+  zs.avail_out= (uInt) bound;
+  bool ok= (deflate (&zs, Z_FINISH) == Z_STREAM_END);
+  r->resize (ok? (int) zs.total_out: 0);
+  deflateEnd (&zs);
+  return r;
+}
+
+#ifndef OS_MINGW
+
+class pdf_deflate_pool {
+  pthread_mutex_t lock;
+  pthread_cond_t  wake;
+  pthread_cond_t  finished;
+  pthread_t*      threads;
+  int             nr_threads;
+  bool            stop;
+  pdf_deflate_job* first;
+  pdf_deflate_job* last;
+
+  static void* work (void* pool_as_void_ptr) {
+    pdf_deflate_pool* pool= (pdf_deflate_pool*) pool_as_void_ptr;
+    pthread_mutex_lock (&pool->lock);
+    while (true) {
+      while (pool->first == NULL && !pool->stop)
+        pthread_cond_wait (&pool->wake, &pool->lock);
+      if (pool->first == NULL) break;
+      pdf_deflate_job* job= pool->first;
+      pool->first= job->next;
+      if (pool->first == NULL) pool->last= NULL;
+      pthread_mutex_unlock (&pool->lock);
+      pdf_deflate (job);
+      pthread_mutex_lock (&pool->lock);
+      job->done= true;
+      pthread_cond_broadcast (&pool->finished);
+    }
+    pthread_mutex_unlock (&pool->lock);
+    return (void*) NULL; }
+
+public:
+  pdf_deflate_pool (int n):
+    nr_threads (0), stop (false), first (NULL), last (NULL) {
+      pthread_mutex_init (&lock, NULL);
+      pthread_cond_init (&wake, NULL);
+      pthread_cond_init (&finished, NULL);
+      threads= (pthread_t*) malloc (n * sizeof (pthread_t));
+      for (int i=0; i<n; i++)
+        if (pthread_create (&threads[nr_threads], NULL, work,
+                            (void*) this) == 0)
+          nr_threads++; }
+  ~pdf_deflate_pool () {
+    pthread_mutex_lock (&lock);
+    stop= true;
+    pthread_cond_broadcast (&wake);
+    pthread_mutex_unlock (&lock);
+    for (int i=0; i<nr_threads; i++)
+      pthread_join (threads[i], NULL);
+    free (threads);
+    pthread_cond_destroy (&finished);
+    pthread_cond_destroy (&wake);
+    pthread_mutex_destroy (&lock); }
+
+  bool is_running () { return nr_threads > 0; }
+  void post (pdf_deflate_job* job) {
+    pthread_mutex_lock (&lock);
+    if (last == NULL) first= job;
+    else last->next= job;
+    last= job;
+    pthread_cond_signal (&wake);
+    pthread_mutex_unlock (&lock); }
+  void wait (pdf_deflate_job* job) {
+    pthread_mutex_lock (&lock);
+    while (!job->done)
+      pthread_cond_wait (&finished, &lock);
+    pthread_mutex_unlock (&lock); }
+};
+
+#else
+
+class pdf_deflate_pool {
+public:
+  pdf_deflate_pool (int n) { (void) n; }
+  bool is_running () { return false; }
+  void post (pdf_deflate_job* job) { pdf_deflate (job); job->done= true; }
+  void wait (pdf_deflate_job* job) { (void) job; }
+};
+
+#endif
+
+static int
+pdf_export_threads () {
+  int n= as_int (get_preference ("texmacs->pdf:threads", "1"));
+  return max (1, min (n, 64));
+}
+
 
 /******************************************************************************
 * constructors and destructors
@@ -297,7 +541,9 @@ pdf_hummus_renderer_rep::pdf_hummus_renderer_rep (
     pdf_fonts (0),
     destId(0),
     label_count(0),
-    outlineId(0)
+    outlineId(0),
+    page (NULL), contentContext (NULL),
+    buffered (false), pool (NULL), stream_id (0), length_id (0)
 {
   width = default_dpi * paper_w / 2.54;
   height= default_dpi * paper_h / 2.54;
@@ -326,6 +572,15 @@ pdf_hummus_renderer_rep::pdf_hummus_renderer_rep (
 		started=true;
 		pdfWriter.GetDocumentContext().AddDocumentContextExtender (new DestinationsWriter(this));
 
+		// DestinationsWriter only acts on the catalog and no objects
+		// context extender is installed, so only encryption matters here
+		int threads= pdf_export_threads ();
+		if (threads > 1 && nr_pages > 1 &&
+		    !settings.DocumentEncryptionOptions.ShouldEncrypt) {
+		  pool= new pdf_deflate_pool (threads);
+		  buffered= pool->is_running ();
+		}
+
 		// start real work
 
 		begin_page();
@@ -335,6 +590,8 @@ pdf_hummus_renderer_rep::pdf_hummus_renderer_rep (
 pdf_hummus_renderer_rep::~pdf_hummus_renderer_rep () {
   if (!started) return; // no cleanup to do
   end_page();
+  assemble_pages (0);
+  if (pool != NULL) delete pool;
   
   flush_images();
   flush_patterns();
@@ -406,7 +663,17 @@ pdf_hummus_renderer_rep::begin_page() {
 
   page = new PDFPage();
   page->SetMediaBox(PDFRectangle(0,0,width,height));
-  contentContext = pdfWriter.StartPageContentContext(page);
+  if (buffered) {
+    // same allocation order as PageContentContext and StartPDFStream
+    IndirectObjectsReferenceRegistry& registry=
+      pdfWriter.GetObjectsContext().GetInDirectObjectsRegistry();
+    stream_id= registry.AllocateNewObjectID();
+    length_id= registry.AllocateNewObjectID();
+    page->AddContentStreamReference(stream_id);
+    contentContext = new buffered_content_context(&pdfWriter.GetDocumentContext(), page);
+  }
+  else
+    contentContext = pdfWriter.StartPageContentContext(page);
   if (NULL == contentContext) {
     //status = PDFHummus::eFailure;
     convert_error << "Failed to create content context for page\n";
@@ -447,7 +714,26 @@ pdf_hummus_renderer_rep::end_page(){
   // outmost restore for the graphics state (see begin_page)
   contentContext->Q();
 
-  status = pdfWriter.EndPageContentContext(contentContext);
+  if (buffered) {
+    buffered_content_context* bcc= (buffered_content_context*) contentContext;
+    pdf_pending_page p;
+    p.stream_id= stream_id;
+    p.length_id= length_id;
+    p.job= pdf_deflate_job_create (bcc->finish ());
+    delete bcc;
+    pool->post (p.job);
+    write_page (p);
+    pending << p;
+    page= NULL;
+    contentContext= NULL;
+    page_num++;
+    // the assembly points only depend on the page numbers,
+    // so that the output does not depend on the number of threads
+    assemble_pages (PDF_PENDING_PAGES);
+    return;
+  }
+
+  status = pdfWriter.EndPageContentContext((PageContentContext*) contentContext);
   if (status != PDFHummus::eSuccess) {
     convert_error << "Failed to end page content context\n";
   }
@@ -462,6 +748,83 @@ pdf_hummus_renderer_rep::end_page(){
   page_num++;
 }
 
+void
+pdf_hummus_renderer_rep::write_page (pdf_pending_page& p) {
+  // write the page object into memory, at the moment when the
+  // sequential writer would write it, and remember the offsets
+  // of the objects which have been written
+  ObjectsContext& objectsContext = pdfWriter.GetObjectsContext();
+  IndirectObjectsReferenceRegistry& registry=
+    objectsContext.GetInDirectObjectsRegistry();
+  IByteWriterWithPosition* file= objectsContext.StartFreeContext();
+  objectsContext.EndFreeContext();
+  OutputStringBufferStream buffer;
+  ObjectIDType first= registry.GetObjectsCount();
+  objectsContext.SetOutputStream(&buffer);
+  EStatusCodeAndObjectIDType res = pdfWriter.GetDocumentContext().WritePageAndRelease(page);
+  objectsContext.SetOutputStream(file);
+  if (res.first != PDFHummus::eSuccess) {
+    convert_error << "Failed to write page and release\n";
+  }
+  for (ObjectIDType id= first; id < registry.GetObjectsCount(); id++) {
+    GetObjectWriteInformationResult info= registry.GetObjectWriteInformation(id);
+    if (info.first && info.second.mObjectWritten) {
+      p.ids << id;
+      p.offsets << (int) info.second.mWritePosition;
+    }
+  }
+  p.objects= buffer.ToString();
+  page_id (page_num) = res.second;
+}
+
+void
+pdf_hummus_renderer_rep::assemble_page (pdf_pending_page p) {
+  // same layout as StartPDFStream and EndPDFStream with an indirect length
+  pool->wait (p.job);
+  ObjectsContext& objectsContext = pdfWriter.GetObjectsContext();
+  objectsContext.StartNewIndirectObject(p.stream_id);
+  DictionaryContext* streamContext = objectsContext.StartDictionary();
+  if (p.job->out != NULL) {
+    streamContext->WriteKey("Filter");
+    streamContext->WriteNameValue("FlateDecode");
+  }
+  else convert_error << "Failed to compress page content stream\n";
+  unsigned char* data = (p.job->out != NULL? p.job->out: p.job->in);
+  size_t n = (p.job->out != NULL? p.job->out_n: p.job->in_n);
+  streamContext->WriteKey("Length");
+  streamContext->WriteNewObjectReferenceValue(p.length_id);
+  objectsContext.EndDictionary(streamContext);
+  objectsContext.WriteKeyword("stream");
+  objectsContext.StartFreeContext()->Write(data, n);
+  objectsContext.EndFreeContext();
+  objectsContext.EndLine();
+  objectsContext.WriteKeyword("endstream");
+  objectsContext.EndIndirectObject();
+  objectsContext.StartNewIndirectObject(p.length_id);
+  objectsContext.WriteInteger(n, eTokenSeparatorEndLine);
+  objectsContext.EndIndirectObject();
+  pdf_deflate_job_destroy (p.job);
+
+  // copy the page objects and move their cross reference entries
+  IndirectObjectsReferenceRegistry& registry=
+    objectsContext.GetInDirectObjectsRegistry();
+  LongFilePositionType base= objectsContext.GetCurrentPosition();
+  objectsContext.StartFreeContext()->Write(
+    (const IOBasicTypes::Byte*) p.objects.data(), p.objects.size());
+  objectsContext.EndFreeContext();
+  for (int i=0; i<N(p.ids); i++)
+    registry.MarkObjectAsUpdated(p.ids[i], base + p.offsets[i]);
+}
+
+void
+pdf_hummus_renderer_rep::assemble_pages (int keep) {
+  int i, n= N(pending) - keep;
+  if (n <= 0) return;
+  for (i=0; i<n; i++)
+    assemble_page (pending[i]);
+  pending= range (pending, n, N(pending));
+}
+
 void
 pdf_hummus_renderer_rep::begin_text () {
   if (!inText) {
@@ -1535,11 +1898,19 @@ pdf_image_rep::flush (PDFWriter& pdfw)
     // 		      << "But current PDF version has been set to " << ((double) ePDFVersion)/10
     // 		      << " (see the preference menu)." << LF;
     if (get_preference ("texmacs->pdf:distill inclusion") == "on") {
-      temp= url_temp (".pdf");
-      if (!gs_PDF_EmbedAllFonts (name, temp)) {
-	temp= name;
+      url cached= conversion_cache_file (name, "distill", ".pdf");
+      if (conversion_cache_hit (cached)) {
+	temp= cached;
 	name= url_none ();
       }
+      else {
+	temp= url_temp (".pdf");
+	if (!gs_PDF_EmbedAllFonts (name, temp)) {
+	  temp= name;
+	  name= url_none ();
+	}
+	else conversion_cache_store (cached, temp);
+      }
     }
     else {
       temp= name;
@@ -1556,7 +1927,12 @@ pdf_image_rep::flush (PDFWriter& pdfw)
       if (flush_jpg(pdfw, name)) return;
           
     // other formats we generate a pdf (with available converters) that we'll embbed
-    image_to_pdf (name, temp, w, h, 300);
+    url cached= cached_image_conversion (name, "pdf", w, h, 300);
+    if (!is_none (cached)) {
+      temp= cached;
+      name= url_none ();
+    }
+    else image_to_pdf (name, temp, w, h, 300);
     // the 300 dpi setting is the maximum dpi of raster images that will be generated:
     // images that are to dense will de downsampled to keep file small
     // (other are not up-sampled) 
@@ -1792,21 +2168,12 @@ pdf_image_rep::flush_raster (PDFWriter& pdfw, url image) {
 }
 */
 
-bool
-pdf_image_rep::flush_for_pattern (PDFWriter& pdfw) {
-  string data, smask, palette;
-  int iw = 0, ih =0;
-#ifdef QTTEXMACS
-  qt_image_data (u, iw, ih, data, palette, smask);
-#else
-  convert_error << "pdf_image_rep::flush_for_pattern: cannot export pattern "
-		<< u << "  to PDF" << LF;
-#endif
-  if ((iw==0)||(ih==0)) return false;
-  
-  ObjectsContext& objectsContext = pdfw.GetObjectsContext();
+static void
+write_deflated_image (ObjectsContext& objectsContext, ObjectIDType id,
+                      int iw, int ih, const std::string& colorSpace,
+                      ObjectIDType smaskId,
+                      string data) {
   objectsContext.StartNewIndirectObject(id);
-
   DictionaryContext* imageContext = objectsContext.StartDictionary();
   imageContext->WriteKey(scType);
   imageContext->WriteNameValue(scXObject);
@@ -1819,49 +2186,77 @@ pdf_image_rep::flush_for_pattern (PDFWriter& pdfw) {
   imageContext->WriteKey(scBitsPerComponent);
   imageContext->WriteIntegerValue(8);
   imageContext->WriteKey(scColorSpace);
-  imageContext->WriteNameValue(scDeviceRGB);
-  ObjectIDType smaskId = objectsContext.GetInDirectObjectsRegistry().AllocateNewObjectID();
-  imageContext->WriteKey("SMask");
-  imageContext->WriteNewObjectReferenceValue(smaskId);
-  PDFStream* imageStream = objectsContext.StartPDFStream(imageContext, true);
-  OutputStreamTraits outputTraits(imageStream->GetWriteStream());
-  c_string buf (data);
-  InputByteArrayStream reader((IOBasicTypes::Byte*)(char *)buf, N(data));
-  EStatusCode status = outputTraits.CopyToOutputStream(&reader);
-  if(status != PDFHummus::eSuccess) {
-    delete imageStream;
-    return false;
+  imageContext->WriteNameValue(colorSpace);
+  if (smaskId != 0) {
+    imageContext->WriteKey("SMask");
+    imageContext->WriteNewObjectReferenceValue(smaskId);
+  }
+  imageContext->WriteKey(scFilter);
+  imageContext->WriteNameValue("FlateDecode");
+  imageContext->WriteKey(scLength);
+  imageContext->WriteIntegerValue(N(data));
+  objectsContext.EndDictionary(imageContext);
+  objectsContext.WriteKeyword("stream");
+  {
+    c_string buf (data);
+    objectsContext.StartFreeContext()->Write((unsigned char*)(char *)buf, N(data));
+    objectsContext.EndFreeContext();
   }
-  objectsContext.EndPDFStream(imageStream);
-  delete imageStream;
+  objectsContext.EndLine();
+  objectsContext.WriteKeyword("endstream");
   objectsContext.EndIndirectObject();
+}
 
-  objectsContext.StartNewIndirectObject(smaskId);
-  DictionaryContext* smaskContext = objectsContext.StartDictionary();
-  smaskContext->WriteKey(scType);
-  smaskContext->WriteNameValue(scXObject);
-  smaskContext->WriteKey(scSubType);
-  smaskContext->WriteNameValue(scImage);
-  smaskContext->WriteKey(scWidth);
-  smaskContext->WriteIntegerValue(iw);
-  smaskContext->WriteKey(scHeight);
-  smaskContext->WriteIntegerValue(ih);
-  smaskContext->WriteKey(scBitsPerComponent);
-  smaskContext->WriteIntegerValue(8);
-  smaskContext->WriteKey(scColorSpace);
-  smaskContext->WriteNameValue(scDeviceGray);
-  PDFStream* smaskStream = objectsContext.StartPDFStream(smaskContext, true);
-  OutputStreamTraits smaskOutputTraits (smaskStream->GetWriteStream());
-  c_string buf_smask (smask);
-  InputByteArrayStream smaskReader ((IOBasicTypes::Byte*)(char *)buf_smask, N(smask));
-  status = smaskOutputTraits.CopyToOutputStream(&smaskReader);
-  if(status != PDFHummus::eSuccess) {
-    delete smaskStream;
-    return false;
+static bool
+load_deflated_image (url cached, int& iw, int& ih, string& data, string& smask) {
+  string s;
+  if (load_string (cached, s, false)) return false;
+  int i= search_forwards ("\n", s);
+  if (i < 0) return false;
+  array<string> h= tokenize (s (0, i), " ");
+  if (N(h) != 3) return false;
+  int n= as_int (h[2]);
+  if (i + 1 + n > N(s)) return false;
+  iw   = as_int (h[0]);
+  ih   = as_int (h[1]);
+  data = s (i + 1, i + 1 + n);
+  smask= s (i + 1 + n, N(s));
+  return iw > 0 && ih > 0;
+}
+
+static void
+save_deflated_image (url cached, int iw, int ih, string data, string smask) {
+  if (is_none (cached)) return;
+  string s= as_string (iw) * " " * as_string (ih) * " " * as_string (N(data));
+  s << '\n' << data << smask;
+  if (!save_string (cached, s)) conversion_cache_stored (cached);
+}
+
+bool
+pdf_image_rep::flush_for_pattern (PDFWriter& pdfw) {
+  string data, smask;
+  int iw = 0, ih =0;
+  url cached= conversion_cache_file (u, "pattern", ".raw");
+  if (!conversion_cache_hit (cached) ||
+      !load_deflated_image (cached, iw, ih, data, smask)) {
+    string raw_data, raw_smask, palette;
+#ifdef QTTEXMACS
+    qt_image_data (u, iw, ih, raw_data, palette, raw_smask);
+#else
+    convert_error << "pdf_image_rep::flush_for_pattern: cannot export pattern "
+                  << u << "  to PDF" << LF;
+#endif
+    if ((iw==0)||(ih==0)) return false;
+    data = pdf_deflate_string (raw_data);
+    smask= pdf_deflate_string (raw_smask);
+    if (N(data) == 0 || N(smask) == 0) return false;
+    save_deflated_image (cached, iw, ih, data, smask);
   }
-  objectsContext.EndPDFStream(smaskStream);
-  delete smaskStream;
-  objectsContext.EndIndirectObject();
+
+  ObjectsContext& objectsContext = pdfw.GetObjectsContext();
+  ObjectIDType smaskId = objectsContext.GetInDirectObjectsRegistry().AllocateNewObjectID();
+  write_deflated_image (objectsContext, id, iw, ih, scDeviceRGB, smaskId, data);
+  write_deflated_image (objectsContext, smaskId, iw, ih, scDeviceGray, 0, smask);
   return true;
 }
 
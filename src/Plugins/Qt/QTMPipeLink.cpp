@@ -35,11 +35,12 @@ void
 QTMPipeLink::readErrOut () {
 BEGIN_SLOT
   feedBuf (QProcess::StandardError);
-  feedBuf (QProcess::StandardOutput);
+  if (!paused) feedBuf (QProcess::StandardOutput);
 END_SLOT
 }
 
-QTMPipeLink::QTMPipeLink (string cmd2) : cmd (cmd2), outbuf (""), errbuf ("") {}
+QTMPipeLink::QTMPipeLink (string cmd2):
+  cmd (cmd2), outbuf (""), errbuf (""), paused (false) {}
 
 QTMPipeLink::~QTMPipeLink () {
   killProcess (1000);
@@ -51,6 +52,7 @@ QTMPipeLink::launchCmd () {
   //FIXME: is UTF8 the right encoding here?
   QProcess::start(utf8_to_qstring(cmd));
   bool r= waitForStarted ();
+  paused= false;
   if (r) {
     connect (this, SIGNAL(readyReadStandardOutput ()), SLOT(readErrOut ()));
     connect (this, SIGNAL(readyReadStandardError ()), SLOT(readErrOut ()));
@@ -26,6 +26,7 @@ public:
   string cmd;
   string outbuf;
   string errbuf;
+  bool   paused;
   command* feed_cmd;
 
   QTMPipeLink (string);
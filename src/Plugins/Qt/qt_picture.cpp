@@ -159,10 +159,14 @@ get_image (url u, int w, int h) {
   if (qt_supports (u))
     pm= new QImage (os8bits_to_qstring (concretize (u)));
   else {
-    url temp= url_temp (".png");
-    image_to_png (u, temp, w, h);
+    url temp= cached_image_conversion (u, "png", w, h);
+    bool cached= !is_none (temp);
+    if (!cached) {
+      temp= url_temp (".png");
+      image_to_png (u, temp, w, h);
+    }
     pm= new QImage (os8bits_to_qstring (as_string (temp)));
-    remove (temp);
+    if (!cached) remove (temp);
   }
   if (pm == NULL || pm->isNull ()) {
       if (pm != NULL) delete pm;
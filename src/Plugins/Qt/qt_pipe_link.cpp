@@ -47,6 +47,7 @@ public:
   bool    is_readable (int channel);
   void    interrupt ();
   void    stop ();
+  void    pause (bool flag);
   void    feed (int channel);
 };
 
@@ -123,7 +124,8 @@ qt_pipe_link_rep::listen (int msecs) {
   if (!alive) return;
   time_t wait_until= texmacs_time () + msecs;
   while ((PipeLink.getOutbuf() == "") && (PipeLink.getErrbuf() == "")) {
-    PipeLink.listenChannel (QProcess::StandardOutput, 0);
+    if (!PipeLink.paused)
+      PipeLink.listenChannel (QProcess::StandardOutput, 0);
     PipeLink.listenChannel (QProcess::StandardError, 0);
     if (texmacs_time () - wait_until > 0) break;
   }
@@ -155,6 +157,14 @@ qt_pipe_link_rep::stop () {
   alive= false;
 }
 
+void
+qt_pipe_link_rep::pause (bool flag) {
+  // while paused, the output of the process remains in its QProcess buffer
+  if (!alive || flag == PipeLink.paused) return;
+  PipeLink.paused= flag;
+  if (!flag) PipeLink.feedBuf (QProcess::StandardOutput);
+}
+
 /******************************************************************************
 * Main builder function for qt_pipe_links
 ******************************************************************************/
@@ -196,6 +196,8 @@
   (tree-child-insert tree_child_insert (tree content int content))
   (tree-ip obtain_ip (path tree))
   (tree-active? tree_active (bool tree))
+  (tree-within? tree_inside (bool tree tree))
+  (tree-precedes? tree_precedes (bool tree tree))
   (tree-eq? strong_equal (bool tree tree))
   (subtree subtree (tree tree path))
   (tree-range tree_range (tree tree int int))
@@ -627,6 +629,10 @@
   (connection-eval connection_eval (tree string string content))
   (connection-interrupt connection_interrupt (void string string))
   (connection-stop connection_stop (void string string))
+  (connection-eval-async connection_eval_async (int string string content command))
+  (connection-async-cancel connection_async_cancel (void int))
+  (connection-async-status connection_async_status (string int))
+  (connection-async-result connection_async_result (tree int))
 
   ;; widgets
   (widget-printer printer_widget (widget command url))
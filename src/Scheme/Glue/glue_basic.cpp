@@ -2060,6 +2060,36 @@ tmg_tree_activeP (tmscm arg1) {
   return bool_to_tmscm (out);
 }
 
+tmscm
+tmg_tree_withinP (tmscm arg1, tmscm arg2) {
+  TMSCM_ASSERT_TREE (arg1, TMSCM_ARG1, "tree-within?");
+  TMSCM_ASSERT_TREE (arg2, TMSCM_ARG2, "tree-within?");
+
+  tree in1= tmscm_to_tree (arg1);
+  tree in2= tmscm_to_tree (arg2);
+
+  // TMSCM_DEFER_INTS;
+  bool out= tree_inside (in1, in2);
+  // TMSCM_ALLOW_INTS;
+
+  return bool_to_tmscm (out);
+}
+
+tmscm
+tmg_tree_precedesP (tmscm arg1, tmscm arg2) {
+  TMSCM_ASSERT_TREE (arg1, TMSCM_ARG1, "tree-precedes?");
+  TMSCM_ASSERT_TREE (arg2, TMSCM_ARG2, "tree-precedes?");
+
+  tree in1= tmscm_to_tree (arg1);
+  tree in2= tmscm_to_tree (arg2);
+
+  // TMSCM_DEFER_INTS;
+  bool out= tree_precedes (in1, in2);
+  // TMSCM_ALLOW_INTS;
+
+  return bool_to_tmscm (out);
+}
+
 tmscm
 tmg_tree_eqP (tmscm arg1, tmscm arg2) {
   TMSCM_ASSERT_TREE (arg1, TMSCM_ARG1, "tree-eq?");
@@ -7541,6 +7571,64 @@ tmg_connection_stop (tmscm arg1, tmscm arg2) {
   return TMSCM_UNSPECIFIED;
 }
 
+tmscm
+tmg_connection_eval_async (tmscm arg1, tmscm arg2, tmscm arg3, tmscm arg4) {
+  TMSCM_ASSERT_STRING (arg1, TMSCM_ARG1, "connection-eval-async");
+  TMSCM_ASSERT_STRING (arg2, TMSCM_ARG2, "connection-eval-async");
+  TMSCM_ASSERT_CONTENT (arg3, TMSCM_ARG3, "connection-eval-async");
+  TMSCM_ASSERT_COMMAND (arg4, TMSCM_ARG4, "connection-eval-async");
+
+  string in1= tmscm_to_string (arg1);
+  string in2= tmscm_to_string (arg2);
+  content in3= tmscm_to_content (arg3);
+  command in4= tmscm_to_command (arg4);
+
+  // TMSCM_DEFER_INTS;
+  int out= connection_eval_async (in1, in2, in3, in4);
+  // TMSCM_ALLOW_INTS;
+
+  return int_to_tmscm (out);
+}
+
+tmscm
+tmg_connection_async_cancel (tmscm arg1) {
+  TMSCM_ASSERT_INT (arg1, TMSCM_ARG1, "connection-async-cancel");
+
+  int in1= tmscm_to_int (arg1);
+
+  // TMSCM_DEFER_INTS;
+  connection_async_cancel (in1);
+  // TMSCM_ALLOW_INTS;
+
+  return TMSCM_UNSPECIFIED;
+}
+
+tmscm
+tmg_connection_async_status (tmscm arg1) {
+  TMSCM_ASSERT_INT (arg1, TMSCM_ARG1, "connection-async-status");
+
+  int in1= tmscm_to_int (arg1);
+
+  // TMSCM_DEFER_INTS;
+  string out= connection_async_status (in1);
+  // TMSCM_ALLOW_INTS;
+
+  return string_to_tmscm (out);
+}
+
+tmscm
+tmg_connection_async_result (tmscm arg1) {
+  TMSCM_ASSERT_INT (arg1, TMSCM_ARG1, "connection-async-result");
+
+  int in1= tmscm_to_int (arg1);
+
+  // TMSCM_DEFER_INTS;
+  tree out= connection_async_result (in1);
+  // TMSCM_ALLOW_INTS;
+
+  return tree_to_tmscm (out);
+}
+
 tmscm
 tmg_widget_printer (tmscm arg1, tmscm arg2) {
   TMSCM_ASSERT_COMMAND (arg1, TMSCM_ARG1, "widget-printer");
@@ -9619,6 +9707,8 @@ initialize_glue_basic () {
   tmscm_install_procedure ("tree-child-insert",  tmg_tree_child_insert, 3, 0, 0);
   tmscm_install_procedure ("tree-ip",  tmg_tree_ip, 1, 0, 0);
   tmscm_install_procedure ("tree-active?",  tmg_tree_activeP, 1, 0, 0);
+  tmscm_install_procedure ("tree-within?",  tmg_tree_withinP, 2, 0, 0);
+  tmscm_install_procedure ("tree-precedes?",  tmg_tree_precedesP, 2, 0, 0);
   tmscm_install_procedure ("tree-eq?",  tmg_tree_eqP, 2, 0, 0);
   tmscm_install_procedure ("subtree",  tmg_subtree, 2, 0, 0);
   tmscm_install_procedure ("tree-range",  tmg_tree_range, 3, 0, 0);
@@ -10006,6 +10096,10 @@ initialize_glue_basic () {
   tmscm_install_procedure ("connection-eval",  tmg_connection_eval, 3, 0, 0);
   tmscm_install_procedure ("connection-interrupt",  tmg_connection_interrupt, 2, 0, 0);
   tmscm_install_procedure ("connection-stop",  tmg_connection_stop, 2, 0, 0);
+  tmscm_install_procedure ("connection-eval-async",  tmg_connection_eval_async, 4, 0, 0);
+  tmscm_install_procedure ("connection-async-cancel",  tmg_connection_async_cancel, 1, 0, 0);
+  tmscm_install_procedure ("connection-async-status",  tmg_connection_async_status, 1, 0, 0);
+  tmscm_install_procedure ("connection-async-result",  tmg_connection_async_result, 1, 0, 0);
   tmscm_install_procedure ("widget-printer",  tmg_widget_printer, 2, 0, 0);
   tmscm_install_procedure ("widget-color-picker",  tmg_widget_color_picker, 3, 0, 0);
   tmscm_install_procedure ("widget-extend",  tmg_widget_extend, 2, 0, 0);
@@ -425,16 +425,27 @@ tmscm_is_blackbox (tmscm t) {
   return SCM_BLACKBOXP (t);
 }
 
+// NOTE: the smob directly holds a reference to the representation
+// of the blackbox, so that no separate handle needs to be allocated
+
 tmscm
 blackbox_to_tmscm (blackbox b) {
   SCM blackbox_smob;
-  SET_SMOB (blackbox_smob, (void*) (tm_new<blackbox> (b)), (SCM) blackbox_tag);
+  blackbox_rep* rep= b.rep;
+  INC_COUNT_NULL (rep);
+  SET_SMOB (blackbox_smob, (void*) rep, (SCM) blackbox_tag);
   return blackbox_smob;
 }
 
 blackbox
 tmscm_to_blackbox (tmscm blackbox_smob) {
-  return *((blackbox*) SCM_CDR (blackbox_smob));
+  return blackbox ((blackbox_rep*) SCM_CDR (blackbox_smob));
+}
+
+blackbox_rep*
+tmscm_to_blackbox_rep (tmscm blackbox_smob) {
+  // borrowed pointer, which remains valid as long as the smob is alive
+  return (blackbox_rep*) SCM_CDR (blackbox_smob);
 }
 
 static SCM
@@ -445,11 +456,11 @@ mark_blackbox (SCM blackbox_smob) {
 
 static scm_sizet
 free_blackbox (SCM blackbox_smob) {
-  blackbox *ptr = (blackbox *) SCM_CDR (blackbox_smob);
+  blackbox_rep* ptr= (blackbox_rep*) SCM_CDR (blackbox_smob);
 #ifdef DEBUG_ON
   scm_busy= true;
 #endif
-  tm_delete (ptr);
+  DEC_COUNT_NULL (ptr);
 #ifdef DEBUG_ON
   scm_busy= false;
 #endif
@@ -462,7 +473,7 @@ print_blackbox (SCM blackbox_smob, SCM port, scm_print_state *pstate) {
   string s = "<blackbox>";
   int type_ = type_box (tmscm_to_blackbox(blackbox_smob)) ;
   if (type_ == type_helper<tree>::id) {
-    tree t= tmscm_to_tree (blackbox_smob);
+    tree t= open_box<tree> (tmscm_to_blackbox (blackbox_smob));
     s= "<tree " * tree_to_texmacs (t) * ">";
   }
   else if (type_ == type_helper<observer>::id) {
@@ -497,6 +508,70 @@ cmp_blackbox (SCM t1, SCM t2) {
   return scm_bool2scm (tmscm_to_blackbox (t1) == tmscm_to_blackbox (t2));
 }
 
+/******************************************************************************
+ * Trees
+ ******************************************************************************/
+
+static long tree_tag;
+
+#define SCM_TREEP(t) \
+(SCM_NIMP (t) && (((long) SCM_CAR (t)) == tree_tag))
+
+// NOTE: trees have a smob type of their own, which directly holds
+// a reference to the tree_rep; the type of a tree is checked on the tag
+// of the smob and no whitebox needs to be allocated or opened
+
+bool
+tmscm_is_tree_handle (tmscm t) {
+  return SCM_TREEP (t);
+}
+
+tmscm
+tree_handle_to_tmscm (tree t) {
+  SCM tree_smob;
+  SET_SMOB (tree_smob, (void*) hold_tree_rep (t), (SCM) tree_tag);
+  return tree_smob;
+}
+
+tree
+tmscm_to_tree_handle (tmscm tree_smob) {
+  return open_tree_rep ((tree_rep*) SCM_CDR (tree_smob));
+}
+
+static SCM
+mark_tree_handle (SCM tree_smob) {
+  (void) tree_smob;
+  return SCM_BOOL_F;
+}
+
+static scm_sizet
+free_tree_handle (SCM tree_smob) {
+  tree_rep* rep= (tree_rep*) SCM_CDR (tree_smob);
+#ifdef DEBUG_ON
+  scm_busy= true;
+#endif
+  release_tree_rep (rep);
+#ifdef DEBUG_ON
+  scm_busy= false;
+#endif
+  return 0;
+}
+
+static int
+print_tree_handle (SCM tree_smob, SCM port, scm_print_state *pstate) {
+  (void) pstate;
+  tree t= tmscm_to_tree_handle (tree_smob);
+  string s= "<tree " * tree_to_texmacs (t) * ">";
+  scm_display (string_to_tmscm (s), port);
+  return 1;
+}
+
+static SCM
+cmp_tree_handle (SCM t1, SCM t2) {
+  tree u1= tmscm_to_tree_handle (t1), u2= tmscm_to_tree_handle (t2);
+  return scm_bool2scm (u1 == u2);
+}
+
 
 
 /******************************************************************************
@@ -512,6 +587,11 @@ initialize_smobs () {
   scm_set_smob_free (blackbox_tag, free_blackbox);
   scm_set_smob_print (blackbox_tag, print_blackbox);
   scm_set_smob_equalp (blackbox_tag, cmp_blackbox);
+  tree_tag= scm_make_smob_type (const_cast<char*> ("tree"), 0);
+  scm_set_smob_mark (tree_tag, mark_tree_handle);
+  scm_set_smob_free (tree_tag, free_tree_handle);
+  scm_set_smob_print (tree_tag, print_tree_handle);
+  scm_set_smob_equalp (tree_tag, cmp_tree_handle);
 }
 
 #else
@@ -520,10 +600,15 @@ scm_smobfuns blackbox_smob_funcs = {
   mark_blackbox, free_blackbox, print_blackbox, cmp_blackbox
 };
 
+scm_smobfuns tree_smob_funcs = {
+  mark_tree_handle, free_tree_handle, print_tree_handle, cmp_tree_handle
+};
+
 
 void
 initialize_smobs () {
   blackbox_tag= scm_newsmob (&blackbox_smob_funcs);
+  tree_tag= scm_newsmob (&tree_smob_funcs);
 }
 
 #endif
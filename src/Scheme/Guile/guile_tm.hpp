@@ -212,6 +212,11 @@ typedef SCM tmscm;
 bool tmscm_is_blackbox (tmscm obj);
 tmscm blackbox_to_tmscm (blackbox b);
 blackbox tmscm_to_blackbox (tmscm obj);
+blackbox_rep* tmscm_to_blackbox_rep (tmscm obj);
+class tree;
+bool tmscm_is_tree_handle (tmscm obj);
+tmscm tree_handle_to_tmscm (tree t);
+tree tmscm_to_tree_handle (tmscm obj);
 
 inline tmscm tmscm_null () { return SCM_NULL; }
 inline tmscm tmscm_true () { return SCM_BOOL_T; }
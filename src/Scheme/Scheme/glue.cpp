@@ -35,6 +35,22 @@ blackboxP (tmscm t) {
   return bool_to_tmscm (b);
 }
 
+template<class T> inline bool
+tmscm_is_box (tmscm obj) {
+  // check the type of a blackbox without copying its handle
+  if (!tmscm_is_blackbox (obj)) return false;
+  blackbox_rep* rep= tmscm_to_blackbox_rep (obj);
+  return rep != NULL && rep->get_type () == type_helper<T>::id;
+}
+
+template<class T> inline T
+tmscm_unbox (tmscm obj) {
+  blackbox_rep* rep= tmscm_to_blackbox_rep (obj);
+  ASSERT (rep != NULL && rep->get_type () == type_helper<T>::id,
+          "type mismatch");
+  return ((whitebox_rep<T>*) rep) -> data;
+}
+
 #if 0
 template<class T> tmscm box_to_tmscm (T o) {
   return blackbox_to_tmscm (close_box<T> (o)); }
@@ -210,24 +226,22 @@ tmscm_to_tree_label (tmscm p) {
 
 bool
 tmscm_is_tree (tmscm u) {
-  return (tmscm_is_blackbox (u) && 
-         (type_box (tmscm_to_blackbox(u)) == type_helper<tree>::id));
+  return tmscm_is_tree_handle (u);
 }
 
 tmscm 
 tree_to_tmscm (tree o) {
-  return blackbox_to_tmscm (close_box<tree> (o));
+  return tree_handle_to_tmscm (o);
 }
 
 tree
 tmscm_to_tree (tmscm obj) {
-  return open_box<tree>(tmscm_to_blackbox (obj));
+  return tmscm_to_tree_handle (obj);
 }
 
 tmscm 
 treeP (tmscm t) {
-  bool b= tmscm_is_blackbox (t) && 
-          (type_box (tmscm_to_blackbox(t)) == type_helper<tree>::id);
+  bool b= tmscm_is_tree_handle (t);
   return bool_to_tmscm (b);
 }
 
@@ -264,8 +278,7 @@ tree_append (tree t1, tree t2) {
 
 bool
 tree_active (tree t) {
-  path ip= obtain_ip (t);
-  return is_nil (ip) || last_item (ip) != DETACHED;
+  return tree_attached (t);
 }
 
 tree
@@ -518,8 +531,7 @@ TMSCM_ASSERT (tmscm_is_observer (o), o, arg, rout)
 
 bool
 tmscm_is_observer (tmscm o) {
-  return (tmscm_is_blackbox (o) &&
-         (type_box (tmscm_to_blackbox(o)) == type_helper<observer>::id));
+  return tmscm_is_box<observer> (o);
 }
 
 tmscm 
@@ -529,13 +541,12 @@ observer_to_tmscm (observer o) {
 
 static observer
 tmscm_to_observer (tmscm obj) {
-  return open_box<observer>(tmscm_to_blackbox (obj));
+  return tmscm_unbox<observer> (obj);
 }
 
 tmscm 
 observerP (tmscm t) {
-  bool b= tmscm_is_blackbox (t) && 
-  (type_box (tmscm_to_blackbox(t)) == type_helper<observer>::id);
+  bool b= tmscm_is_box<observer> (t);
   return bool_to_tmscm (b);
 }
 
@@ -549,8 +560,7 @@ TMSCM_ASSERT (tmscm_is_widget (o), o, arg, rout)
 
 bool
 tmscm_is_widget (tmscm u) {
-  return (tmscm_is_blackbox (u) &&
-         (type_box (tmscm_to_blackbox(u)) == type_helper<widget>::id));
+  return tmscm_is_box<widget> (u);
 }
 
 
@@ -561,7 +571,7 @@ widget_to_tmscm (widget o) {
 
 widget
 tmscm_to_widget (tmscm o) {
-  return open_box<widget> (tmscm_to_blackbox (o));
+  return tmscm_unbox<widget> (o);
 }
 
 /******************************************************************************
@@ -573,8 +583,7 @@ TMSCM_ASSERT (tmscm_is_command (o), o, arg, rout)
 
 bool
 tmscm_is_command (tmscm u) {
-  return (tmscm_is_blackbox (u) && 
-      (type_box (tmscm_to_blackbox(u)) == type_helper<command>::id));
+  return tmscm_is_box<command> (u);
 }
 
 static tmscm 
@@ -584,7 +593,7 @@ command_to_tmscm (command o) {
 
 static command
 tmscm_to_command (tmscm o) {
-  return open_box<command> (tmscm_to_blackbox (o));
+  return tmscm_unbox<command> (o);
 }
 
 /******************************************************************************
@@ -598,8 +607,7 @@ TMSCM_ASSERT (tmscm_is_promise_widget (o), o, arg, rout)
 
 bool
 tmscm_is_promise_widget (tmscm u) {
-  return (tmscm_is_blackbox (u) && 
-         (type_box (tmscm_to_blackbox(u)) == type_helper<promise_widget>::id));
+  return tmscm_is_box<promise_widget> (u);
 }
 
 static tmscm 
@@ -609,7 +617,7 @@ promise_widget_to_tmscm (promise_widget o) {
 
 static promise_widget
 tmscm_to_promise_widget (tmscm o) {
-  return open_box<promise_widget> (tmscm_to_blackbox (o));
+  return tmscm_unbox<promise_widget> (o);
 }
 
 /******************************************************************************
@@ -618,8 +626,7 @@ tmscm_to_promise_widget (tmscm o) {
 
 bool
 tmscm_is_url (tmscm u) {
-  return (tmscm_is_blackbox (u)
-              && (type_box (tmscm_to_blackbox(u)) == type_helper<url>::id))
+  return (tmscm_is_box<url> (u))
          || (tmscm_is_string(u));
 }
 
@@ -636,7 +643,7 @@ tmscm_to_url (tmscm obj) {
 #else
   return tmscm_to_string (obj);
 #endif
-  return open_box<url> (tmscm_to_blackbox (obj));
+  return tmscm_unbox<url> (obj);
 }
 
 tmscm 
@@ -659,8 +666,7 @@ url url_ref (url u, int i) { return u[i]; }
 
 bool
 tmscm_is_modification (tmscm m) {
-  return (tmscm_is_blackbox (m) &&
-	  (type_box (tmscm_to_blackbox(m)) == type_helper<modification>::id))
+  return (tmscm_is_box<modification> (m))
     || (tmscm_is_string (m));
 }
 
@@ -671,7 +677,7 @@ modification_to_tmscm (modification m) {
 
 modification
 tmscm_to_modification (tmscm obj) {
-  return open_box<modification> (tmscm_to_blackbox (obj));
+  return tmscm_unbox<modification> (obj);
 }
 
 tmscm 
@@ -697,8 +703,7 @@ var_clean_apply (tree& t, modification m) {
 
 bool
 tmscm_is_patch (tmscm p) {
-  return (tmscm_is_blackbox (p) &&
-	  (type_box (tmscm_to_blackbox(p)) == type_helper<patch>::id))
+  return (tmscm_is_box<patch> (p))
     || (tmscm_is_string (p));
 }
 
@@ -709,7 +714,7 @@ patch_to_tmscm (patch p) {
 
 patch
 tmscm_to_patch (tmscm obj) {
-  return open_box<patch> (tmscm_to_blackbox (obj));
+  return tmscm_unbox<patch> (obj);
 }
 
 tmscm 
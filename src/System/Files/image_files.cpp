@@ -32,8 +32,19 @@
 #include "sys_utils.hpp"
 #include "analyze.hpp"
 #include "hashmap.hpp"
+#include "iterator.hpp"
 #include "scheme.hpp"
+#include "data_cache.hpp"
+#include "merge_sort.hpp"
+#include "subprocess.hpp"
+#include "tm_timer.hpp"
 #include "Imlib2/imlib2.hpp"
+#include <stdio.h>
+#include <utime.h>
+
+#ifndef OS_MINGW
+#include <unistd.h>
+#endif
 
 #ifdef MACOSX_EXTENSIONS
 #include "MacOS/mac_images.h"
@@ -59,6 +70,8 @@ typedef struct { int w; int h; int xmin; int ymin;} imgbox ;
 hashmap<tree,imgbox> img_box;
 // cache for storing image sizes
 // (for ps/eps we also store the image offset so that we have the full bbox info)
+static bool image_probe_cache_get (url image);
+static void image_probe_cache_set (url image);
 
 /******************************************************************************
 * Loading xpm pixmaps
@@ -209,9 +222,12 @@ ps_bounding_box (url image, int& x1, int& y1, int& x2, int& y2, bool set_default
       <<" : "<< x1<<" , "<<y1<<" , "<<x2<<" , "<<y2<< LF;
     return true;
   }
+  else if (image_probe_cache_get (image))
+    return ps_bounding_box (image, x1, y1, x2, y2, set_default);
   else {
     string s= ps_load (image, false);
-    if (!ps_read_bbox (s, x1, y1, x2, y2)) {
+    bool found= ps_read_bbox (s, x1, y1, x2, y2);
+    if (!found) {
       if (set_default) { 
         x1= y1= 0; x2= 596; y2= 842;
       }
@@ -221,6 +237,8 @@ ps_bounding_box (url image, int& x1, int& y1, int& x2, int& y2, bool set_default
       }
     }
     set_imgbox_cache(lookup, x2-x1, y2-y1, x1, y1);
+    // the default A4 box is not kept for the next sessions
+    if (found) image_probe_cache_set (image);
     return true;
   }
 }
@@ -231,6 +249,12 @@ ps_read_bbox (string buf, int& x1, int& y1, int& x2, int& y2 ) {
   if (pos < 0) pos = search_forwards ("%%BoundingBox:", buf);
   if (pos < 0) return false;
   if (buf[pos] == '\n') pos++;
+  if (test (buf, pos, "%%BoundingBox: (atend)")) {
+    // the bounding box is given in the trailer
+    int end= search_backwards ("%%BoundingBox:", buf);
+    if (end <= pos) return false;
+    pos= end;
+  }
   bool ok= read (buf, pos, "%%BoundingBox:");
   double X1, Y1, X2, Y2;
   skip_spaces (buf, pos);
@@ -259,6 +283,209 @@ void
 clear_imgbox_cache(tree t){
     img_box->reset (t);
 }
+
+/******************************************************************************
+* Persistent cache for image sizes
+******************************************************************************/
+
+// Image boxes of local files are also kept in the image_cache.scm file
+// of the cache directory, so that the sizes of all figures of a document
+// need not to be determined again when the document is reopened.
+// The entries are validated against the size and modification time.
+
+static string
+image_probe_key (url image) {
+  url name= resolve (image);
+  if (is_none (name) || !is_rooted_name (name) || is_rooted_web (name))
+    return "";
+  return concretize (name);
+}
+
+static tree
+image_probe_stamp (string key) {
+  url u= url_system (key);
+  return tuple (as_string (file_size (u)),
+                as_string (last_modified (u, false)));
+}
+
+static bool
+image_probe_cache_get (url image) {
+  string key= image_probe_key (image);
+  if (key == "") return false;
+  cache_load ("image_cache.scm");
+  if (!is_cached ("image_cache.scm", key)) return false;
+  tree t= cache_get ("image_cache.scm", key);
+  if (!is_tuple (t) || N(t) != 6) return false;
+  tree stamp= image_probe_stamp (key);
+  if (t[0] != stamp[0] || t[1] != stamp[1]) return false;
+  set_imgbox_cache (image->t, as_int (t[2]), as_int (t[3]),
+                    as_int (t[4]), as_int (t[5]));
+  if (DEBUG_CONVERT)
+    debug_convert << "image box in persistent cache for " << image << LF;
+  return true;
+}
+
+static void
+image_probe_cache_set (url image) {
+  string key= image_probe_key (image);
+  if (key == "" || !img_box->contains (image->t)) return;
+  imgbox box= img_box [image->t];
+  tree stamp= image_probe_stamp (key);
+  cache_load ("image_cache.scm");
+  tree t (TUPLE, 6);
+  t[0]= stamp[0];
+  t[1]= stamp[1];
+  t[2]= as_string (box.w);
+  t[3]= as_string (box.h);
+  t[4]= as_string (box.xmin);
+  t[5]= as_string (box.ymin);
+  cache_set ("image_cache.scm", key, t);
+}
+
+/******************************************************************************
+* Reading image sizes directly from the file headers
+******************************************************************************/
+
+static string
+load_header (url image, int max_size, int& size) {
+  // load at most max_size bytes and return the size of the whole file
+  size= 0;
+  url name= resolve (image);
+  if (is_none (name)) return "";
+  c_string _name (concretize (name));
+  FILE* fin= fopen (_name, "rb");
+  if (fin == NULL) return "";
+  string s (max_size);
+  int n= (int) fread (&(s[0]), 1, max_size, fin);
+  if (n >= 0 && n < max_size) size= n;
+  else if (fseek (fin, 0, SEEK_END) == 0) {
+    long l= ftell (fin);
+    size= (l < 0 || l > (long) 0x7fffffff? 0x7fffffff: (int) l);
+  }
+  fclose (fin);
+  return s (0, max (n, 0));
+}
+
+static int
+get_be (string s, int i, int n) {
+  // lengths beyond 2^31-1 become negative
+  unsigned int r= 0;
+  for (int k=0; k<n; k++) r= (r << 8) + ((unsigned char) s[i+k]);
+  return (int) r;
+}
+
+static int
+get_le (string s, int i, int n) {
+  unsigned int r= 0;
+  for (int k=n-1; k>=0; k--) r= (r << 8) + ((unsigned char) s[i+k]);
+  return (int) r;
+}
+
+static bool
+png_header_size (string s, int size,
+                 int& w, int& h, double& dpmx, double& dpmy) {
+  if (N(s) < 24 || !starts (s, "\x89PNG\r\n\x1a\n")) return false;
+  if (s (12, 16) != "IHDR") return false;
+  w= get_be (s, 16, 4);
+  h= get_be (s, 20, 4);
+  int i= 8;
+  while (i + 8 <= N(s)) {
+    int len= get_be (s, i, 4);
+    string type= s (i+4, i+8);
+    if (type == "IDAT" || type == "IEND") break;
+    if (len < 0 || len > size - i - 12) break; // truncated or corrupt
+    if (type == "pHYs" && i + 17 <= N(s) && s[i+16] == '\1') {
+      dpmx= (double) get_be (s, i+8, 4);
+      dpmy= (double) get_be (s, i+12, 4);
+    }
+    i += len + 12;
+  }
+  return w > 0 && h > 0;
+}
+
+static bool
+jpeg_header_size (string s, int& w, int& h, double& dpmx, double& dpmy) {
+  if (N(s) < 4 || s[0] != '\xff' || s[1] != '\xd8') return false;
+  int i= 2;
+  while (i + 4 <= N(s)) {
+    if (s[i] != '\xff') return false;
+    int marker= (unsigned char) s[i+1];
+    if (marker == 0xff) { i++; continue; }
+    if (marker == 0xd8 || (marker >= 0xd0 && marker <= 0xd7)) { i += 2; continue; }
+    if (marker == 0xd9 || marker == 0xda) return false;
+    int len= get_be (s, i+2, 2);
+    if (marker == 0xe0 && i + 18 <= N(s) && s (i+4, i+9) == string ("JFIF\0", 5)) {
+      int units= (unsigned char) s[i+11];
+      double dx= (double) get_be (s, i+12, 2);
+      double dy= (double) get_be (s, i+14, 2);
+      if (units == 1) { dpmx= dx / 0.0254; dpmy= dy / 0.0254; }
+      if (units == 2) { dpmx= dx * 100.0; dpmy= dy * 100.0; }
+    }
+    if (marker >= 0xc0 && marker <= 0xcf &&
+        marker != 0xc4 && marker != 0xc8 && marker != 0xcc) {
+      if (i + 9 > N(s)) return false;
+      h= get_be (s, i+5, 2);
+      w= get_be (s, i+7, 2);
+      return w > 0 && h > 0;
+    }
+    i += len + 2;
+  }
+  return false;
+}
+
+static bool
+gif_header_size (string s, int& w, int& h) {
+  if (N(s) < 10 || (!starts (s, "GIF87a") && !starts (s, "GIF89a")))
+    return false;
+  w= get_le (s, 6, 2);
+  h= get_le (s, 8, 2);
+  return w > 0 && h > 0;
+}
+
+static bool
+pdf_header_size (url image, int& w, int& h) {
+  // only a rough fallback for when the Pdf renderer is not available:
+  // take the first /MediaBox in the file, without handling rotations
+  string s;
+  if (load_string (image, s, false)) return false;
+  int pos= search_forwards ("/MediaBox", s);
+  if (pos < 0) return false;
+  pos += 9;
+  skip_spaces (s, pos);
+  if (pos >= N(s) || s[pos] != '[') return false;
+  pos++;
+  double x[4];
+  for (int k=0; k<4; k++) {
+    skip_spaces (s, pos);
+    if (!read_double (s, pos, x[k])) return false;
+  }
+  w= (int) ceil (x[2] - x[0]);
+  h= (int) ceil (x[3] - x[1]);
+  return w > 0 && h > 0;
+}
+
+bool
+native_image_size (url image, int& w, int& h) {
+  // returns w,h in units of pt (1/72 inch) whenever the resolution
+  // of the image is specified in its header
+  string suf= locase_all (suffix (image));
+  if (suf != "png" && suf != "jpg" && suf != "jpeg" && suf != "gif")
+    return false;
+  int size;
+  string s= load_header (image, 1 << 16, size);
+  int w_px= 0, h_px= 0;
+  double dpmx= 0.0, dpmy= 0.0;
+  bool ok= png_header_size (s, size, w_px, h_px, dpmx, dpmy) ||
+           jpeg_header_size (s, w_px, h_px, dpmx, dpmy) ||
+           gif_header_size (s, w_px, h_px);
+  if (!ok || dpmx <= 0.0 || dpmy <= 0.0) return false;
+  // same conversion as for Qt images
+  w= (int) rint ((((double) w_px) * 2834) / dpmx);
+  h= (int) rint ((((double) h_px) * 2834) / dpmy);
+  if (DEBUG_CONVERT)
+    debug_convert << "image_size native : " << w << " x " << h << "\n";
+  return w > 0 && h > 0;
+}
 /******************************************************************************
 * Getting the original size of an image, using internal plug-ins if possible
 ******************************************************************************/
@@ -277,18 +504,25 @@ image_size (url image, int& w, int& h) {
     if (DEBUG_CONVERT) debug_convert<< "image_size in cache for " << image <<LF
       << w << " x " << h << LF;
   }
+  else if (image_probe_cache_get (image)) {
+    imgbox box= img_box [lookup];
+    w= box.w;
+    h= box.h;
+  }
   else {
     w=h=0;
     image_size_sub (image, w, h);
-    if ((w <= 0) || (h <= 0)) {
+    bool found= (w > 0) && (h > 0);
+    if (!found) {
       convert_error << "bad image size for '" << image << "'"
         << " setting 35x35 " << LF;
       w= 35; h= 35;
     }
     // for ps and eps images the imgbox should have been cached
     // during the image_size_sub call
-    if (img_box->contains (lookup)) return;
-    set_imgbox_cache(lookup, w, h);
+    if (!img_box->contains (lookup)) set_imgbox_cache(lookup, w, h);
+    // the fallback size is not kept for the next sessions
+    if (found) image_probe_cache_set (image);
   }
 }
 
@@ -309,6 +543,7 @@ image_size_sub (url image, int& w, int& h) { // returns w,h in units of pt (1/72
       return;
     }
   }
+  if (native_image_size (image, w, h)) return;
 #ifdef QTTEXMACS
   if (qt_supports (image)) { // native support by Qt : most bitmaps & svg  
     qt_image_size (image, w, h); 
@@ -355,6 +590,7 @@ pdf_image_size (url image, int& w, int& h) {
   hummus_pdf_image_size (image, w, h);
   return;
 #endif
+  if (pdf_header_size (image, w, h)) return;
 #ifdef USE_GS
   gs_PDFimage_size (image, w, h);
   return;
@@ -494,6 +730,339 @@ call_scm_converter(url image, url dest) {
   return false;
 }
 
+/******************************************************************************
+* Cache of converted images
+******************************************************************************/
+
+// Converted images are stored in the cache directory under a name derived
+// from the location, size and modification time of the source file and
+// from the conversion parameters, so that they can be shared between
+// sessions.  The modification times of the cached files record their last
+// use.  A running total of the size of the cache is kept during the session:
+// once it exceeds CONVERSION_CACHE_SIZE bytes or CONVERSION_CACHE_FILES
+// entries, the cache directory is scanned and the least recently used
+// entries are removed.
+
+#define CONVERSION_CACHE_SIZE  (128 << 20)
+#define CONVERSION_CACHE_FILES 1024
+
+static long conversion_cache_total= -1;  // size of the cache, -1 if unknown
+static int  conversion_cache_count= 0;   // number of entries in the cache
+
+static url
+conversion_cache_dir () {
+  return url ("$TEXMACS_HOME_PATH/system/cache");
+}
+
+url
+conversion_cache_file (url u, string params, string suffix) {
+  if (get_preference ("image conversion cache", "on") != "on")
+    return url_none ();
+  url name= resolve (u);
+  if (is_none (name)) return url_none ();
+  string s= concretize (name) * "\n" *
+            as_string (file_size (name)) * "\n" *
+            as_string (last_modified (name, false)) * "\n" * params;
+  // 64 bit FNV-1a hash of the description of the conversion
+  unsigned long long h= 14695981039346656037ULL;
+  for (int i=0; i<N(s); i++) {
+    h ^= (unsigned char) s[i];
+    h *= 1099511628211ULL;
+  }
+  string key= as_hexadecimal ((int) (h >> 32), 8) *
+              as_hexadecimal ((int) (h & 0xffffffff), 8);
+  return conversion_cache_dir () * url ("conv-" * key * suffix);
+}
+
+bool
+conversion_cache_hit (url cached) {
+  // a hit renews the modification time, which serves as the date of last use
+  if (is_none (cached) || !exists (cached)) return false;
+  c_string path (concretize (cached));
+  (void) utime (path, NULL);
+  return true;
+}
+
+static void
+conversion_cache_evict () {
+  // determine the size of the cache and remove the least recently used
+  // entries as long as it exceeds the bounds
+  bool error_flag;
+  url dir= conversion_cache_dir ();
+  array<string> a= read_directory (dir, error_flag);
+  if (error_flag) return;
+  array<url> files;
+  array<int> used;
+  array<int> sizes;
+  long total= 0;
+  for (int i=0; i<N(a); i++)
+    if (starts (a[i], "conv-")) {
+      url f= dir * url (a[i]);
+      files << f;
+      used  << last_modified (f, false);
+      sizes << max (file_size (f), 0);
+      total += sizes[N(sizes)-1];
+    }
+  int n= N(files);
+  if (total > CONVERSION_CACHE_SIZE || n > CONVERSION_CACHE_FILES) {
+    array<int> order= merge_sort_leq_permutation (used);
+    for (int k=0; k<N(order); k++) {
+      if (total <= CONVERSION_CACHE_SIZE && n <= CONVERSION_CACHE_FILES)
+        break;
+      int i= order[k];
+      remove (files[i]);
+      total -= sizes[i];
+      n--;
+    }
+  }
+  conversion_cache_total= total;
+  conversion_cache_count= n;
+}
+
+void
+conversion_cache_stored (url cached) {
+  // account for a new entry of the cache
+  if (conversion_cache_total < 0) conversion_cache_evict ();
+  else {
+    conversion_cache_total += max (file_size (cached), 0);
+    conversion_cache_count++;
+    if (conversion_cache_total > CONVERSION_CACHE_SIZE ||
+        conversion_cache_count > CONVERSION_CACHE_FILES)
+      conversion_cache_evict ();
+  }
+}
+
+void
+conversion_cache_store (url cached, url u) {
+  if (is_none (cached) || !exists (u)) return;
+  copy (u, cached);
+  conversion_cache_stored (cached);
+}
+
+/******************************************************************************
+* Cached conversions, possibly performed in the background
+******************************************************************************/
+
+// When rendering on the screen, conversions may be delegated to a bounded
+// number of worker processes.  The conversion routines above rely on the
+// scheme converters and on global state of the kernel, which may not be
+// used from another thread, nor from a child which is forked from the
+// multi-threaded editor.  The workers are therefore separate instances
+// of TeXmacs, started with the option -batch-worker (see tm_batch.cpp),
+// which receive one job at a time and are stopped when they remain idle.
+
+#define IMAGE_WORKER_IDLE 60000
+
+int batch_spawn (int& in, int& out);
+
+struct image_worker {
+  int pid, in, out;
+  string key;    // the file being produced, or "" when idle
+  string buf;    // partial answer
+  time_t last;   // time of the last answer
+};
+
+static array<tree>         image_jobs_queue;
+static hashmap<string,int> image_jobs_running (-1);
+static array<image_worker> image_workers;
+static bool                image_jobs_done= false;
+
+url
+image_conversion_file (url image, string fm, int w, int h, int dpi) {
+  string params= "convert " * fm * " " * as_string (w) * "x" *
+                 as_string (h) * " " * as_string (dpi);
+  return conversion_cache_file (image, params, "." * fm);
+}
+
+void
+convert_image (url image, url dest, string fm, int w, int h, int dpi) {
+  // write to a temporary file first, so that a partial result
+  // is never mistaken for a cached conversion
+  url part= glue (unglue (dest, N(fm) + 1), "-part." * fm);
+  if (fm == "png") image_to_png (image, part, w, h);
+  else if (fm == "pdf") image_to_pdf (image, part, w, h, dpi);
+  else image_to_eps (image, part, w, h, dpi);
+  if (exists (part)) move (part, dest);
+}
+
+static int
+image_jobs_max () {
+  int n= as_int (get_preference ("background image conversions", "2"));
+  return max (0, min (n, 16));
+}
+
+bool
+background_image_conversion (url image) {
+#if defined(OS_MINGW) || !defined(QTTEXMACS)
+  (void) image;
+  return false;
+#else
+  if (image_jobs_max () == 0) return false;
+  if (qt_supports (image)) return false;
+  return is_rooted_name (resolve (image));
+#endif
+}
+
+#ifndef OS_MINGW
+static void
+image_worker_stop (int w) {
+  image_worker& iw= image_workers[w];
+  close (iw.in);
+  close (iw.out);
+  (void) subprocess_wait (iw.pid);
+  iw.pid= -1;
+}
+
+static void
+image_worker_finish (int w, bool alive) {
+  // the current job of the worker has been answered, or the worker died
+  image_worker& iw= image_workers[w];
+  string key= iw.key;
+  int pos= search_forwards ("\n", iw.buf);
+  bool ok= (pos >= 0 && iw.buf (0, pos) == "ok");
+  iw.buf= (pos >= 0)? iw.buf (pos + 1, N(iw.buf)): string ();
+  iw.key= "";
+  iw.last= texmacs_time ();
+  if (!alive) image_worker_stop (w);
+  image_jobs_running->reset (key);
+  image_jobs_done= true;
+  if (ok && exists (url_system (key)))
+    conversion_cache_stored (url_system (key));
+  else convert_error << "background conversion to " << key
+                     << " failed" << LF;
+}
+
+static void
+image_jobs_wait (string key) {
+  // wait for the termination of a running conversion
+  int w= image_jobs_running [key];
+  image_worker& iw= image_workers[w];
+  bool alive= true;
+  while (alive && search_forwards ("\n", iw.buf) < 0)
+    alive= subprocess_read (iw.out, iw.buf) > 0;
+  image_worker_finish (w, alive);
+}
+
+static void
+image_jobs_start () {
+  while (N(image_jobs_queue) > 0) {
+    int w, idle= -1, alive= 0;
+    for (w=0; w<N(image_workers); w++)
+      if (image_workers[w].pid > 0) {
+        alive++;
+        if (idle < 0 && image_workers[w].key == "") idle= w;
+      }
+    if (idle < 0 && alive >= image_jobs_max ()) break;
+    tree job= image_jobs_queue[0];
+    image_jobs_queue= range (image_jobs_queue, 1, N(image_jobs_queue));
+    url image= as_url (job[0]);
+    string key= as_string (job[1]);
+    if (idle < 0) {
+      image_worker iw;
+      iw.pid= batch_spawn (iw.in, iw.out);
+      iw.last= texmacs_time ();
+      if (iw.pid > 0) {
+        for (w=0; w<N(image_workers); w++)
+          if (image_workers[w].pid < 0) break;
+        if (w == N(image_workers)) image_workers << iw;
+        else image_workers[w]= iw;
+        idle= w;
+      }
+    }
+    string cmd= "image\t" * concretize (image) * "\t" * key;
+    for (int i=2; i<6; i++) cmd << "\t" << as_string (job[i]);
+    if (idle < 0 || !subprocess_write (image_workers[idle].in, cmd * "\n")) {
+      if (idle >= 0) image_worker_stop (idle);
+      convert_warning << "cannot convert " << image
+                      << " in the background" << LF;
+      convert_image (image, url_system (key), as_string (job[2]),
+                     as_int (job[3]), as_int (job[4]), as_int (job[5]));
+      if (exists (url_system (key))) conversion_cache_stored (url_system (key));
+      image_jobs_done= true;
+      continue;
+    }
+    image_workers[idle].key= key;
+    image_jobs_running (key)= idle;
+    if (DEBUG_CONVERT)
+      debug_convert << "background conversion of " << image
+                    << " to " << key << LF;
+  }
+}
+#endif
+
+url
+cached_image_conversion (url image, string fm, int w, int h, int dpi,
+                         bool wait) {
+  url dest= image_conversion_file (image, fm, w, h, dpi);
+  if (is_none (dest)) return dest;
+  string key= concretize (dest);
+#ifndef OS_MINGW
+  if (image_jobs_running->contains (key)) {
+    if (!wait) return url_none ();
+    image_jobs_wait (key);
+  }
+#endif
+  if (conversion_cache_hit (dest)) return dest;
+#ifndef OS_MINGW
+  if (!wait) {
+    for (int i=0; i<N(image_jobs_queue); i++)
+      if (image_jobs_queue[i][1] == key) return url_none ();
+    tree job (TUPLE, 6);
+    job[0]= image->t;
+    job[1]= key;
+    job[2]= fm;
+    job[3]= as_string (w);
+    job[4]= as_string (h);
+    job[5]= as_string (dpi);
+    image_jobs_queue << job;
+    image_jobs_start ();
+    return url_none ();
+  }
+  for (int i=0; i<N(image_jobs_queue); i++)
+    if (image_jobs_queue[i][1] == key) {
+      image_jobs_queue= append (range (image_jobs_queue, 0, i),
+                                range (image_jobs_queue, i+1,
+                                       N(image_jobs_queue)));
+      break;
+    }
+#endif
+  convert_image (image, dest, fm, w, h, dpi);
+  if (!exists (dest)) return url_none ();
+  conversion_cache_stored (dest);
+  return dest;
+}
+
+bool
+poll_image_conversions () {
+#ifndef OS_MINGW
+  if (N(image_workers) > 0) {
+    array<int> fds;
+    array<bool> ready;
+    for (int w=0; w<N(image_workers); w++)
+      fds << ((image_workers[w].key != "")? image_workers[w].out: -1);
+    if (N(image_jobs_running) > 0 && subprocess_poll (fds, ready, 0) > 0)
+      for (int w=0; w<N(image_workers); w++)
+        if (ready[w]) {
+          image_worker& iw= image_workers[w];
+          bool alive= subprocess_read (iw.out, iw.buf) > 0;
+          if (!alive || search_forwards ("\n", iw.buf) >= 0)
+            image_worker_finish (w, alive);
+        }
+    image_jobs_start ();
+    // stop the workers which have been idle for a while
+    time_t now= texmacs_time ();
+    for (int w=0; w<N(image_workers); w++)
+      if (image_workers[w].pid > 0 && image_workers[w].key == "" &&
+          now - image_workers[w].last > IMAGE_WORKER_IDLE)
+        image_worker_stop (w);
+  }
+  else image_jobs_start ();
+#endif
+  bool r= image_jobs_done;
+  image_jobs_done= false;
+  return r;
+}
+
 /******************************************************************************
 * Imagemagick stuff 
 * last resort solution -- should rarely be useful.
@@ -23,12 +23,22 @@ void          set_imgbox_cache(tree t, int w,  int h, int xmin=0, int ymin=0);
 void          clear_imgbox_cache(tree t);
 string 	      ps_load (url image, bool conv=true);
 void          image_size (url image, int& w, int& h);
+bool          native_image_size (url image, int& w, int& h);
 void          pdf_image_size (url image, int& w, int& h) ;
 void          image_to_eps (url image, url eps, int w_pt= 0, int h_pt= 0, int dpi= 0);
 void          image_to_pdf (url image, url eps, int w_pt= 0, int h_pt= 0, int dpi= 0);
 string        image_to_psdoc (url image);
 void          image_to_png (url image, url png, int w= 0, int h= 0);
 bool          call_scm_converter(url image, url dest);
+url           conversion_cache_file (url u, string params, string suffix);
+bool          conversion_cache_hit (url cached);
+void          conversion_cache_stored (url cached);
+void          conversion_cache_store (url cached, url u);
+url           image_conversion_file (url image, string fm, int w, int h, int dpi);
+void          convert_image (url image, url dest, string fm, int w, int h, int dpi);
+url           cached_image_conversion (url image, string fm, int w, int h, int dpi= 0, bool wait= true);
+bool          background_image_conversion (url image);
+bool          poll_image_conversions ();
 void          call_imagemagick_convert(url image, url dest, int w_pt=0, int h_pt=0, int dpi=72);
 bool          imagemagick_image_size(url image, int& w, int& h, bool pt_units=true);
 bool          has_image_magick();
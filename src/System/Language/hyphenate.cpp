@@ -13,6 +13,8 @@
 #include "hyphenate.hpp"
 #include "analyze.hpp"
 #include "converter.hpp"
+#include "iterator.hpp"
+#include "merge_sort.hpp"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -20,6 +22,7 @@
 
 #define MAX_SEARCH 10
 #define MAX_BUFFER_SIZE 256
+#define HYPHEN_MEMO_SIZE 4096
 
 /*
 static bool
@@ -54,19 +57,10 @@ hyphen_normalize (string s) {
   return r;
 }
 
-void
-load_hyphen_tables (string file_name,
-                    hashmap<string,string>& patterns,
-                    hashmap<string,string>& hyphenations, bool toCork) {
-  string s;
-  file_name= string ("hyphen.") * file_name;
-  load_string (url ("$TEXMACS_PATH/langs/natural/hyphen", file_name), s, true);
-  if (DEBUG_VERBOSE)
-    debug_automatic << "TeXmacs] Loading " << file_name << "\n";
-
-  if (toCork) s= utf8_to_cork (s);
-
-  hashmap<string,string> H ("?");
+static void
+parse_hyphen_tables (string s,
+                     hashmap<string,string>& patterns,
+                     hashmap<string,string>& hyphenations) {
   bool pattern_flag=false;
   bool hyphenation_flag=false;
   int i=0, n= N(s);
@@ -96,13 +90,214 @@ load_hyphen_tables (string file_name,
   }
 }
 
-array<int>
-get_hyphens (string s,
-             hashmap<string,string> patterns,
-             hashmap<string,string> hyphenations) {
-  return get_hyphens (s, patterns, hyphenations, false);
+/******************************************************************************
+* Compilation of the patterns into a packed trie
+******************************************************************************/
+
+hyphen_table_rep::hyphen_table_rep ():
+  hyphenations ("?"), memo (array<int> (0)), memo_old (array<int> (0)) {}
+
+static string
+pattern_weights (string r, int len) {
+  // the weights before each of the len letters of the pattern r
+  string w (len+1);
+  int j, k, m;
+  for (j=0, k=0; j<=len; j++, k++) {
+    if ((k<N(r)) && (r[k]>='0') && (r[k]<='9')) {
+      m=((int) r[k])-((int) '0');
+      k++;
+    }
+    else m=0;
+    w[j]= (char) m;
+  }
+  return w;
 }
 
+static void
+compile_patterns (hyphen_table ht, hashmap<string,string> patterns) {
+  // the nodes at depth d are the sorted prefixes of length d,
+  // so that the children of consecutive nodes are consecutive
+  array<string> keys;
+  iterator<string> it= iterate (patterns);
+  while (it->busy ()) {
+    string key= it->next ();
+    if (N(key) != 0) keys << key;
+  }
+  merge_sort (keys);
+  array<string> level;
+  level << string ("");
+  int d, i, k, base= 0;
+  for (d=0; N(level) != 0; d++) {
+    array<string> sub;
+    for (i=0; i<N(keys); i++)
+      if (N(keys[i]) > d) {
+        string p= keys[i] (0, d+1);
+        if (N(sub) == 0 || sub[N(sub)-1] != p) sub << p;
+      }
+    int q= 0;
+    for (k=0; k<N(level); k++) {
+      if (d == 0 || !patterns->contains (level[k])) ht->pattern << -1;
+      else {
+        ht->pattern << N(ht->weights);
+        ht->weights << pattern_weights (patterns[level[k]], d);
+      }
+      ht->first << N(ht->next);
+      while (q < N(sub) && sub[q] (0, d) == level[k]) {
+        ht->labels << sub[q][d];
+        ht->next << (base + N(level) + q);
+        q++;
+      }
+    }
+    base += N(level);
+    level= sub;
+  }
+  ht->first << N(ht->next);
+}
+
+hyphen_table
+make_hyphen_table (string s, bool toCork) {
+  if (toCork) s= utf8_to_cork (s);
+  hashmap<string,string> patterns ("?");
+  hyphen_table ht;
+  parse_hyphen_tables (s, patterns, ht->hyphenations);
+  compile_patterns (ht, patterns);
+  return ht;
+}
+
+/******************************************************************************
+* Binary cache files for compiled tables
+******************************************************************************/
+
+#define HYPHEN_MAGIC "TMHYPH01"
+
+static void
+hyphen_put (string& s, int i) {
+  s << ((char) (i & 255)) << ((char) ((i >> 8) & 255))
+    << ((char) ((i >> 16) & 255)) << ((char) ((i >> 24) & 255));
+}
+
+static void
+hyphen_put (string& s, string x) {
+  hyphen_put (s, N(x));
+  s << x;
+}
+
+static void
+hyphen_put (string& s, array<int> a) {
+  hyphen_put (s, N(a));
+  for (int i=0; i<N(a); i++) hyphen_put (s, a[i]);
+}
+
+static bool
+hyphen_get (string s, int& pos, int& i) {
+  if (pos < 0 || pos + 4 > N(s)) return false;
+  const unsigned char* p= (const unsigned char*) (&s[0]) + pos;
+  i= ((int) p[0]) | (((int) p[1]) << 8) |
+     (((int) p[2]) << 16) | (((int) p[3]) << 24);
+  pos += 4;
+  return true;
+}
+
+static bool
+hyphen_get (string s, int& pos, string& x) {
+  int n;
+  if (!hyphen_get (s, pos, n) || n < 0 || n > N(s) - pos) return false;
+  x= s (pos, pos + n);
+  pos += n;
+  return true;
+}
+
+static bool
+hyphen_get (string s, int& pos, array<int>& a) {
+  int i, n;
+  if (!hyphen_get (s, pos, n) || n < 0 || n > (N(s) - pos) / 4) return false;
+  a= array<int> (n);
+  for (i=0; i<n; i++) (void) hyphen_get (s, pos, a[i]);
+  return true;
+}
+
+static string
+encode_hyphen_table (hyphen_table ht, string source) {
+  string s= HYPHEN_MAGIC;
+  hyphen_put (s, N(source));
+  hyphen_put (s, hash (source));
+  hyphen_put (s, ht->labels);
+  hyphen_put (s, ht->next);
+  hyphen_put (s, ht->first);
+  hyphen_put (s, ht->pattern);
+  hyphen_put (s, ht->weights);
+  hyphen_put (s, N(ht->hyphenations));
+  iterator<string> it= iterate (ht->hyphenations);
+  while (it->busy ()) {
+    string word= it->next ();
+    hyphen_put (s, word);
+    hyphen_put (s, ht->hyphenations[word]);
+  }
+  return s;
+}
+
+static bool
+decode_hyphen_table (hyphen_table ht, string s, string source) {
+  // returns false if s is not a valid compilation of source
+  string magic= HYPHEN_MAGIC;
+  int pos= N(magic), len, code, nr, i, e;
+  if (N(s) < pos || s (0, pos) != magic) return false;
+  if (!hyphen_get (s, pos, len) || len != N(source)) return false;
+  if (!hyphen_get (s, pos, code) || code != hash (source)) return false;
+  if (!hyphen_get (s, pos, ht->labels) ||
+      !hyphen_get (s, pos, ht->next) ||
+      !hyphen_get (s, pos, ht->first) ||
+      !hyphen_get (s, pos, ht->pattern) ||
+      !hyphen_get (s, pos, ht->weights)) return false;
+  int nodes= N(ht->pattern);
+  if (N(ht->next) != N(ht->labels) || N(ht->first) != nodes + 1 ||
+      nodes == 0 || ht->first[0] != 0 || ht->first[nodes] != N(ht->next))
+    return false;
+  array<int> depth (nodes);
+  depth[0]= 0;
+  for (i=0; i<nodes; i++) {
+    if (ht->first[i+1] < ht->first[i]) return false;
+    for (e= ht->first[i]; e < ht->first[i+1]; e++) {
+      int c= ht->next[e];
+      if (c <= i || c >= nodes) return false;
+      depth[c]= depth[i] + 1;
+    }
+    int w= ht->pattern[i];
+    if (w != -1 && (w < 0 || w + depth[i] >= N(ht->weights))) return false;
+  }
+  if (!hyphen_get (s, pos, nr) || nr < 0) return false;
+  for (i=0; i<nr; i++) {
+    string word, h;
+    if (!hyphen_get (s, pos, word) || !hyphen_get (s, pos, h)) return false;
+    ht->hyphenations (word)= h;
+  }
+  return pos == N(s);
+}
+
+hyphen_table
+load_hyphen_table (string file_name, bool toCork) {
+  string s;
+  file_name= string ("hyphen.") * file_name;
+  load_string (url ("$TEXMACS_PATH/langs/natural/hyphen", file_name), s, true);
+  if (DEBUG_VERBOSE)
+    debug_automatic << "TeXmacs] Loading " << file_name << "\n";
+
+  string suffix= (toCork? string (".cork.bin"): string (".bin"));
+  url cache= url ("$TEXMACS_HOME_PATH/system/cache", file_name * suffix);
+  string bin;
+  if (exists (cache) && !load_string (cache, bin, false)) {
+    hyphen_table ht;
+    if (decode_hyphen_table (ht, bin, s)) return ht;
+  }
+  hyphen_table ht= make_hyphen_table (s, toCork);
+  save_string (cache, encode_hyphen_table (ht, s), false);
+  return ht;
+}
+
+/******************************************************************************
+* Hyphenation of words
+******************************************************************************/
+
 void
 goto_next_char (string s, int &i, bool utf8) {
   if (utf8) decode_from_utf8 (s, i);
@@ -129,16 +324,20 @@ str_length (string s, bool utf8) {
   else return N(s);
 }
 
-array<int>
-get_hyphens (string s,
-             hashmap<string,string> patterns,
-             hashmap<string,string> hyphenations, bool utf8) {
-  ASSERT (N(s) != 0, "hyphenation of empty string");
+static inline int
+hyphen_child (hyphen_table& ht, int node, char c) {
+  int e, end= ht->first[node+1];
+  for (e= ht->first[node]; e < end; e++)
+    if (ht->labels[e] == c) return ht->next[e];
+  return -1;
+}
 
+static array<int>
+compute_hyphens (string s, hyphen_table ht, bool utf8) {
   if (utf8) s= cork_to_utf8 (s);
 
-  if (hyphenations->contains (s)) {
-    string h= hyphenations [s];
+  if (ht->hyphenations->contains (s)) {
+    string h= ht->hyphenations [s];
     array<int> penalty (str_length (s, utf8)-1);
     int i=0, j=0;
     while (h[j] == '-') j++;
@@ -158,24 +357,22 @@ get_hyphens (string s,
   else {
     s= "." * to_lower (s) * ".";
     // cout << s << "\n";
-    int i, j, k, l, m, len;
+    int i, j, l, len, n= N(s);
     array<int> T (str_length (s, utf8)+1);
     for (i=0; i<N(T); i++) T[i]=0;
-    for (len=1; len < MAX_SEARCH; len++)
-      for (i=0, l=0; i<N(s) - len; goto_next_char (s, i, utf8), l++) {
-        string r= patterns [s (i, i+len)];
-        if (!(r == "?")) {
-          // cout << "  " << s (i, i+len) << " => " << r << "\n";
-          for (j=0, k=0; j<=len; j++, k++) {
-            if ((k<N(r)) && (r[k]>='0') && (r[k]<='9')) {
-              m=((int) r[k])-((int) '0');
-              k++;
-            }
-            else m=0;
+    for (i=0, l=0; i < n-1; goto_next_char (s, i, utf8), l++) {
+      int node= 0;
+      for (len=1; len < MAX_SEARCH && i+len < n; len++) {
+        node= hyphen_child (ht, node, s[i+len-1]);
+        if (node < 0) break;
+        int w= ht->pattern[node];
+        if (w >= 0)
+          for (j=0; j<=len && l+j < N(T); j++) {
+            int m= (int) ht->weights[w+j];
             if (m>T[l+j]) T[l+j]=m;
           }
-        }
       }
+    }
 
     array<int> penalty (N(T)-4);
     for (i=2; i < N(T)-4; i++)
@@ -188,6 +385,21 @@ get_hyphens (string s,
   }
 }
 
+array<int>
+get_hyphens (string s, hyphen_table ht, bool utf8) {
+  ASSERT (N(s) != 0, "hyphenation of empty string");
+  if (ht->memo->contains (s)) return ht->memo[s];
+  array<int> penalty;
+  if (ht->memo_old->contains (s)) penalty= ht->memo_old[s];
+  else penalty= compute_hyphens (s, ht, utf8);
+  if (N(ht->memo) >= HYPHEN_MEMO_SIZE) {
+    ht->memo_old= ht->memo;
+    ht->memo= hashmap<string,array<int> > (array<int> (0));
+  }
+  ht->memo (s)= penalty;
+  return penalty;
+}
+
 void
 std_hyphenate (string s, int after, string& left, string& right, int penalty) {
   std_hyphenate (s, after, left, right, penalty, false);
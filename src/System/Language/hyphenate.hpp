@@ -13,15 +13,36 @@
 #define HYPHENATE_H
 #include "language.hpp"
 
-void load_hyphen_tables (string language_name,
-                         hashmap<string,string>& patterns,
-                         hashmap<string,string>& hyphenations, bool toCork);
-array<int> get_hyphens (string s,
-                        hashmap<string,string> patterns,
-                        hashmap<string,string> hyphenations);
-array<int> get_hyphens (string s,
-                        hashmap<string,string> patterns,
-                        hashmap<string,string> hyphenations, bool utf8);
+/******************************************************************************
+* The hyphenation patterns of a language are compiled into a packed trie,
+* whose nodes are numbered level by level, so that the edges leaving
+* a node are contiguous.  The compiled tables are cached in binary form.
+* The hyphenation points of recently hyphenated words are memorized.
+******************************************************************************/
+
+class hyphen_table_rep: public concrete_struct {
+public:
+  string     labels;                    // the letters on the edges
+  array<int> next;                      // the target nodes of the edges
+  array<int> first;                     // the first edge of each node
+  array<int> pattern;                   // the weights of each node or -1
+  string     weights;                   // the weights of all patterns
+  hashmap<string,string> hyphenations;  // explicit hyphenations of words
+  hashmap<string,array<int> > memo;     // recently hyphenated words
+  hashmap<string,array<int> > memo_old; // previous generation of the memo
+
+  hyphen_table_rep ();
+};
+
+class hyphen_table {
+  CONCRETE(hyphen_table);
+  inline hyphen_table (): rep (tm_new<hyphen_table_rep> ()) {}
+};
+CONCRETE_CODE(hyphen_table);
+
+hyphen_table make_hyphen_table (string source, bool toCork);
+hyphen_table load_hyphen_table (string language_name, bool toCork);
+array<int> get_hyphens (string s, hyphen_table ht, bool utf8= false);
 void std_hyphenate (string s, int after, string& left, string& right, int pen);
 void std_hyphenate (string s, int after, string& left, string& right, int pen,
                     bool utf8);
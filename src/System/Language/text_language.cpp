@@ -30,8 +30,7 @@
 ******************************************************************************/
 
 struct text_language_rep: language_rep {
-  hashmap<string,string> patterns;
-  hashmap<string,string> hyphenations;
+  hyphen_table hyph;
 
   text_language_rep (string lan_name, string hyph_name);
   text_property advance (tree t, int& pos);
@@ -40,8 +39,7 @@ struct text_language_rep: language_rep {
 };
 
 text_language_rep::text_language_rep (string lan_name, string hyph_name):
-  language_rep (lan_name), patterns ("?"), hyphenations ("?") {
-    load_hyphen_tables (hyph_name, patterns, hyphenations, true); }
+  language_rep (lan_name), hyph (load_hyphen_table (hyph_name, true)) {}
 
 text_property
 text_language_rep::advance (tree t, int& pos) {
@@ -97,7 +95,7 @@ text_language_rep::advance (tree t, int& pos) {
 
 array<int>
 text_language_rep::get_hyphens (string s) {
-  return ::get_hyphens (s, patterns, hyphenations);
+  return ::get_hyphens (s, hyph);
 }
 
 void
@@ -113,8 +111,7 @@ text_language_rep::hyphenate (
 ******************************************************************************/
 
 struct french_language_rep: language_rep {
-  hashmap<string,string> patterns;
-  hashmap<string,string> hyphenations;
+  hyphen_table hyph;
 
   french_language_rep (string lan_name, string hyph_name);
   text_property advance (tree t, int& pos);
@@ -123,8 +120,7 @@ struct french_language_rep: language_rep {
 };
 
 french_language_rep::french_language_rep (string lan_name, string hyph_name):
-  language_rep (lan_name), patterns ("?"), hyphenations ("?") {
-    load_hyphen_tables (hyph_name, patterns, hyphenations, true); }
+  language_rep (lan_name), hyph (load_hyphen_table (hyph_name, true)) {}
 
 inline bool
 is_french_punctuation (register char c) {
@@ -195,7 +191,7 @@ french_language_rep::advance (tree t, int& pos) {
 
 array<int>
 french_language_rep::get_hyphens (string s) {
-  return ::get_hyphens (s, patterns, hyphenations);
+  return ::get_hyphens (s, hyph);
 }
 
 void
@@ -211,8 +207,7 @@ french_language_rep::hyphenate (
 ******************************************************************************/
 
 struct ucs_text_language_rep: language_rep {
-  hashmap<string,string> patterns;
-  hashmap<string,string> hyphenations;
+  hyphen_table hyph;
 
   ucs_text_language_rep (string lan_name, string hyph_name);
   text_property advance (tree t, int& pos);
@@ -222,8 +217,7 @@ struct ucs_text_language_rep: language_rep {
 };
 
 ucs_text_language_rep::ucs_text_language_rep (string lan_name, string hyph_name):
-  language_rep (lan_name), patterns ("?"), hyphenations ("?")
-  { load_hyphen_tables (hyph_name, patterns, hyphenations, false); }
+  language_rep (lan_name), hyph (load_hyphen_table (hyph_name, false)) {}
 
 text_property
 ucs_text_language_rep::advance (tree t, int& pos) {
@@ -282,7 +276,7 @@ ucs_text_language_rep::advance (tree t, int& pos) {
 
 array<int>
 ucs_text_language_rep::get_hyphens (string s) {
-  return ::get_hyphens (s, patterns, hyphenations, true);
+  return ::get_hyphens (s, hyph, true);
 }
 
 void
@@ -17,6 +17,7 @@ bool   connection_declared (string name);
 tree   connection_info (string name, string session);
 tree   connection_handlers (string name);
 string connection_start (string name, string session, bool again= false);
+string connection_start (string name, string session, tm_link ln);
 void   connection_write (string name, string session, string s);
 void   connection_write (string name, string session, tree t);
 tree   connection_read (string name, string session, string channel= "output");
@@ -27,5 +28,11 @@ int    connection_status (string name, string session);
 tree   connection_eval (string name, string session, string s);
 tree   connection_eval (string name, string session, tree t);
 tree   connection_cmd (string name, string session, string s);
+int    connection_eval_async (string name, string session, string s, command cb);
+int    connection_eval_async (string name, string session, tree t, command cb);
+void   connection_async_cancel (int id);
+string connection_async_status (int id);
+tree   connection_async_result (int id);
+void   connection_async_poll ();
 
 #endif // defined CONNECT_H
@@ -24,6 +24,7 @@
 #include "resource.hpp"
 #include "Generic/input.hpp"
 #include "gui.hpp"
+#include "tm_timer.hpp"
 
 static tree connection_retrieve (string name, string session);
 
@@ -39,6 +40,10 @@ struct connection_rep: rep<connection> {
   int     status;        // status of the connection
   int     prev_status;   // last notified status
   bool    forced_eval;   // forced input evaluation without call backs
+  int     job;           // running asynchronous job (0 if none)
+  int     received;      // bytes of output received for this job
+  int     delivered;     // bytes received at the last delivery
+  array<string> deferred;// input written while a job was running
   texmacs_input tm_in;   // texmacs input handler for data from child
   texmacs_input tm_err;  // texmacs input handler for errors from child
 
@@ -70,8 +75,8 @@ connection_rep::connection_rep (string name2, string session2, tm_link ln2):
   rep<connection> (name2 * "-" * session2),
   name (name2), session (session2), ln (ln2),
   status (CONNECTION_DEAD), prev_status (CONNECTION_DEAD),
-  forced_eval (false),
-  tm_in ("output"), tm_err ("error") {}
+  forced_eval (false), job (0), received (0),
+  delivered (0), tm_in ("output"), tm_err ("error") {}
 
 string
 connection_rep::start (bool again) {
@@ -82,6 +87,7 @@ connection_rep::start (bool again) {
   }
   else {
     message= ln->start ();
+    deferred= array<string> ();
     tm_in  = texmacs_input ("output");
     tm_err = texmacs_input ("error");
     status = WAITING_FOR_OUTPUT;
@@ -109,6 +115,7 @@ connection_rep::read (int channel) {
   if (channel == LINK_OUT) {
     string s= ln->read (LINK_OUT);
     int i, n= N(s);
+    received += n;
     for (i=0; i<n; i++)
       if (tm_in->put (s[i])) {
 	status= WAITING_FOR_INPUT;
@@ -152,6 +159,9 @@ connection_rep::interrupt () {
 * Handle output from extern applications
 ******************************************************************************/
 
+static void async_receive (connection con);
+static void async_resume (connection con);
+
 void
 connection_notify (connection con, string ch, tree t) {
   if (t == "") return;
@@ -177,6 +187,15 @@ connection_notify_status (connection con) {
 void
 connection_rep::listen () {
   if (forced_eval) return;
+  if (job != 0) {
+    // output of an asynchronous job is not meant for the session
+    read (LINK_ERR);
+    connection_notify (this, "error", tm_err->get ("error"));
+    if (status != CONNECTION_DEAD) read (LINK_OUT);
+    async_receive (this);
+    if (job == 0) async_resume (this);
+    return;
+  }
   connection_notify_status (this);
   if (status != CONNECTION_DEAD) {
     read (LINK_ERR);
@@ -195,6 +214,7 @@ connection_rep::listen () {
     }
   }
   connection_notify_status (this);  
+  async_resume (this);
 }
 
 /******************************************************************************
@@ -254,11 +274,26 @@ connection_start (string name, string session, bool again) {
   return con->start (again);
 }
 
+string
+connection_start (string name, string session, tm_link ln) {
+  // start a connection over a given link, without consulting the
+  // declared connection types
+  connection con= connection (name * "-" * session);
+  if (is_nil (con)) con= tm_new<connection_rep> (name, session, ln);
+  return con->start (false);
+}
+
 void
 connection_write (string name, string session, string s) {
   // cout << "Write " << name << ", " << session << ", " << s << "\n";
   connection con= connection (name * "-" * session);
   if (is_nil (con)) return;
+  if (con->job != 0 || N(con->deferred) != 0) {
+    // the output of the running job should not be mixed with the output
+    // for s, so that s is only sent once the job has been completed
+    con->deferred << s;
+    return;
+  }
   con->write (s);
 }
 
@@ -317,6 +352,8 @@ connection_status (string name, string session) {
 * Evaluation interface (using a specific connection)
 ******************************************************************************/
 
+static bool async_busy (connection con);
+
 static connection
 connection_get (string name, string session) {
   connection con= connection (name * "-" * session);
@@ -355,6 +392,8 @@ connection_eval (string name, string session, tree t) {
   // cout << "Evaluating " << name << ", " << session << ", " << t << LF;
   connection con= connection_get (name, session);
   if (is_nil (con)) return "";
+  if (async_busy (con))
+    return document (compound ("errput", "Busy with an asynchronous job"));
   connection_write (name, session, t);
   return connection_retrieve (name, session);
 }
@@ -364,6 +403,8 @@ connection_eval (string name, string session, string s) {
   // cout << "Evaluating " << name << ", " << session << ", " << s << LF;
   connection con= connection_get (name, session);
   if (is_nil (con)) return "";
+  if (async_busy (con))
+    return document (compound ("errput", "Busy with an asynchronous job"));
   connection_write (name, session, s);
   return connection_retrieve (name, session);
 }
@@ -376,3 +417,244 @@ connection_cmd (string name, string session, string cmd) {
   if (is_func (r, DOCUMENT, 1)) r= r[0];
   return r;
 }
+
+/******************************************************************************
+* Asynchronous evaluation
+*******************************************************************************
+* An asynchronous evaluation returns a handle immediately.  Jobs for the
+* same connection are queued and sent to the plugin one at a time, as soon
+* as it waits for input.  The output of the running job is parsed as it
+* arrives and handed over to the call back in chunks, at most once per
+* ASYNC_FLUSH_DELAY milliseconds, as (call-back handle doc status).
+* The link is no longer read while more than ASYNC_MAX_PENDING bytes
+* await delivery, so that the plugin blocks until the next chunk is out.
+* Output beyond ASYNC_MAX_OUTPUT bytes is discarded and the plugin is
+* interrupted; if it continues to produce output, it is stopped.
+* Synchronous evaluations on a connection with a running job fail at once.
+* Jobs without call back keep their result until it is collected,
+* or at most ASYNC_EXPIRE_DELAY milliseconds after their completion.
+******************************************************************************/
+
+#define ASYNC_FLUSH_DELAY  100
+#define ASYNC_EXPIRE_DELAY 60000
+#define ASYNC_MAX_PENDING  (1 << 16)
+#define ASYNC_MAX_OUTPUT   (1 << 22)
+
+class async_job_rep: public concrete_struct {
+public:
+  int     id;
+  string  name;        // name of the connection
+  string  session;     // name of the session
+  string  input;       // serialized input to be evaluated
+  command call_back;   // receives the output in chunks
+  string  status;      // queued, running, done, cancelled or truncated
+  tree    result;      // delivered output, when there is no call back
+  tree    pending;     // output which has not yet been delivered
+  time_t  last;        // time of the last delivery
+
+  inline async_job_rep (int id2, string name2, string session2,
+                        string input2, command call_back2):
+    id (id2), name (name2), session (session2), input (input2),
+    call_back (call_back2), status ("queued"),
+    result (DOCUMENT), pending (DOCUMENT), last (0) {}
+};
+
+class async_job {
+  CONCRETE_NULL(async_job);
+  inline async_job (int id, string name, string session,
+                    string input, command call_back):
+    rep (tm_new<async_job_rep> (id, name, session, input, call_back)) {}
+};
+CONCRETE_NULL_CODE(async_job);
+
+static hashmap<int,async_job> async_jobs;
+static array<int> async_order;
+static array<int> async_expiring;
+static int async_last= 0;
+
+static bool
+async_active (async_job job) {
+  return job->status == "queued" || job->status == "running";
+}
+
+static void
+async_flush (async_job job) {
+  // deliver the pending output to the call back and read further output
+  connection con= connection (job->name * "-" * job->session);
+  if (!is_nil (con) && con->job == job->id) {
+    con->delivered= con->received;
+    con->ln->pause (false);
+  }
+  if (N(job->pending) == 0 && async_active (job)) return;
+  tree doc= job->pending;
+  job->pending= tree (DOCUMENT);
+  job->last= texmacs_time ();
+  if (!is_nil (job->call_back))
+    job->call_back (list_object (object (job->id), object (doc),
+                                 object (job->status)));
+  else if (N(doc) != 0 && job->status != "cancelled")
+    job->result << A (doc);
+}
+
+static void
+async_finish (connection con, async_job job) {
+  // the plugin is done with the job
+  if (!is_nil (con) && con->job == job->id) {
+    con->job= 0;
+    con->ln->pause (false);
+  }
+  if (job->status == "queued" || job->status == "running") job->status= "done";
+  async_flush (job);
+  if (!is_nil (job->call_back)) async_jobs->reset (job->id);
+  else async_expiring << job->id;
+  for (int i=0; i<N(async_order); i++)
+    if (async_order[i] == job->id) {
+      async_order= append (range (async_order, 0, i),
+                           range (async_order, i+1, N(async_order)));
+      break;
+    }
+}
+
+static void
+async_receive (connection con) {
+  // process the output which arrived for the running job
+  async_job job= async_jobs[con->job];
+  if (is_nil (job)) { con->job= 0; return; }
+  tree next= con->tm_in->get ("output");
+  (void) con->tm_in->get ("prompt");
+  (void) con->tm_in->get ("input");
+  if (job->status == "running") {
+    if (next == "");
+    else if (is_document (next)) job->pending << A (next);
+    else job->pending << next;
+    if (con->received > ASYNC_MAX_OUTPUT) {
+      job->status= "truncated";
+      con->ln->pause (false);
+      con->interrupt ();
+    }
+    else if (con->received - con->delivered > ASYNC_MAX_PENDING)
+      con->ln->pause (true);
+  }
+  else if (con->received > 2 * ASYNC_MAX_OUTPUT) {
+    // the plugin ignores the interrupt: stop the runaway computation
+    con->stop ();
+  }
+  if (con->status == WAITING_FOR_INPUT || con->status == CONNECTION_DEAD ||
+      !con->ln->alive)
+    async_finish (con, job);
+  else if (texmacs_time () - job->last >= ASYNC_FLUSH_DELAY)
+    async_flush (job);
+}
+
+static void
+async_resume (connection con) {
+  // once the plugin waits for input, first send the input which was
+  // deferred by connection_write, then the next queued job for con
+  if (con->job != 0 || con->forced_eval || !con->ln->alive ||
+      con->status != WAITING_FOR_INPUT) return;
+  if (N(con->deferred) != 0) {
+    string s= con->deferred[0];
+    con->deferred= range (con->deferred, 1, N(con->deferred));
+    con->write (s);
+    return;
+  }
+  for (int i=0; i<N(async_order); i++) {
+    async_job job= async_jobs[async_order[i]];
+    if (is_nil (job) || job->status != "queued" ||
+        job->name != con->name || job->session != con->session) continue;
+    job->status= "running";
+    job->last  = texmacs_time ();
+    con->job      = job->id;
+    con->received = 0;
+    con->delivered= 0;
+    con->write (job->input);
+    return;
+  }
+}
+
+static bool
+async_busy (connection con) {
+  // synchronous evaluations would block the editor until the running job
+  // and the input deferred behind it have been processed
+  if (con->job != 0 && is_nil (async_jobs[con->job])) con->job= 0;
+  return con->job != 0 || N(con->deferred) != 0;
+}
+
+int
+connection_eval_async (string name, string session, string s, command cb) {
+  // cout << "Evaluating " << name << ", " << session << ", " << s << LF;
+  connection con= connection_get (name, session);
+  if (is_nil (con)) return 0;
+  if (!con->ln->alive && connection_start (name, session, true) != "ok")
+    return 0;
+  int id= ++async_last;
+  async_jobs (id)= async_job (id, name, session, s, cb);
+  async_order << id;
+  async_resume (con);
+  return id;
+}
+
+int
+connection_eval_async (string name, string session, tree t, command cb) {
+  string s= as_string (call ("plugin-serialize", name, tree_to_stree (t)));
+  return connection_eval_async (name, session, s, cb);
+}
+
+void
+connection_async_cancel (int id) {
+  async_job job= async_jobs[id];
+  if (is_nil (job) || !async_active (job)) return;
+  connection con= connection (job->name * "-" * job->session);
+  bool running= job->status == "running";
+  job->status = "cancelled";
+  job->pending= tree (DOCUMENT);
+  if (running && !is_nil (con) && con->ln->alive) {
+    con->ln->pause (false);
+    con->interrupt ();
+  }
+  else async_finish (con, job);
+}
+
+string
+connection_async_status (int id) {
+  async_job job= async_jobs[id];
+  if (is_nil (job)) return "unknown";
+  return job->status;
+}
+
+tree
+connection_async_result (int id) {
+  // output so far; the handle is released once the job has completed
+  // and otherwise expires ASYNC_EXPIRE_DELAY milliseconds after completion
+  async_job job= async_jobs[id];
+  if (is_nil (job)) return "";
+  tree r= copy (job->result);
+  if (async_active (job)) r << A (job->pending);
+  else async_jobs->reset (id);
+  return r;
+}
+
+void
+connection_async_poll () {
+  // regularly called from the main loop: deliver the output of jobs
+  // whose plugin went quiet, start queued jobs on idle connections
+  // and release the uncollected results of jobs without call back
+  array<int> ids= copy (async_order);
+  for (int i=0; i<N(ids); i++) {
+    async_job job= async_jobs[ids[i]];
+    if (is_nil (job)) continue;
+    connection con= connection (job->name * "-" * job->session);
+    if (is_nil (con) || !con->ln->alive) async_finish (con, job);
+    else if (job->status == "queued") async_resume (con);
+    else if (con->job == job->id &&
+             texmacs_time () - job->last >= ASYNC_FLUSH_DELAY)
+      async_flush (job);
+  }
+  while (N(async_expiring) != 0) {
+    async_job job= async_jobs[async_expiring[0]];
+    if (!is_nil (job) && texmacs_time () - job->last < ASYNC_EXPIRE_DELAY)
+      break;
+    async_jobs->reset (async_expiring[0]);
+    async_expiring= range (async_expiring, 1, N(async_expiring));
+  }
+}
@@ -61,6 +61,7 @@ struct pipe_link_rep: tm_link_rep {
 
   string outbuf;        // pending output from plugin
   string errbuf;        // pending errors from plugin
+  bool   paused;        // stop reading data coming from the child
 
   socket_notifier snout, snerr;
   
@@ -75,6 +76,7 @@ public:
   void    listen (int msecs);
   void    interrupt ();
   void    stop ();
+  void    pause (bool flag);
 
   void    feed (int channel);
 };
@@ -87,6 +89,7 @@ pipe_link_rep::pipe_link_rep (string cmd2): cmd (cmd2) {
   outbuf = "";
   errbuf = "";
   alive  = false;
+  paused = false;
 }
 
 pipe_link_rep::~pipe_link_rep () {
@@ -176,7 +179,8 @@ pipe_link_rep::start () {
     err= pp_err [IN ];
     close (pp_err [OUT]);
 
-    alive= true;
+    alive = true;
+    paused= false;
     snout = socket_notifier (out, &pipe_callback, this, NULL);
     snerr = socket_notifier (err, &pipe_callback, this, NULL);
     add_notifier (snout);
@@ -293,7 +297,7 @@ pipe_link_rep::listen (int msecs) {
   while ((outbuf == "") && (errbuf == "")) {
     fd_set rfds;
     FD_ZERO (&rfds);
-    FD_SET (out, &rfds);
+    if (!paused) FD_SET (out, &rfds);
     FD_SET (err, &rfds);
     struct timeval tv;
     tv.tv_sec  = msecs / 1000;
@@ -328,6 +332,18 @@ pipe_link_rep::stop () {
 
   remove_notifier (snout);
   remove_notifier (snerr);
+  paused= false;
+#endif
+}
+
+void
+pipe_link_rep::pause (bool flag) {
+  // while paused, the child blocks as soon as the pipe is full
+#ifndef OS_MINGW
+  if (!alive || flag == paused) return;
+  paused= flag;
+  if (paused) remove_notifier (snout);
+  else add_notifier (snout);
 #endif
 }
 
@@ -345,7 +361,7 @@ void pipe_callback (void *obj, void *info) {
     fd_set rfds;
     FD_ZERO (&rfds);
     int max_fd= max (con->err, con->out) + 1;
-    FD_SET (con->out, &rfds);
+    if (!con->paused) FD_SET (con->out, &rfds);
     FD_SET (con->err, &rfds);
   
     struct timeval tv;
@@ -354,7 +370,7 @@ void pipe_callback (void *obj, void *info) {
     select (max_fd, &rfds, NULL, NULL, &tv);
 
     busy= false;
-    if (con->alive && FD_ISSET (con->out, &rfds)) {
+    if (con->alive && !con->paused && FD_ISSET (con->out, &rfds)) {
       //cout << "pipe_callback OUT" << LF;
       con->feed (LINK_OUT);
       busy= news= true;
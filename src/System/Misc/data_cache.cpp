@@ -228,6 +228,7 @@ cache_memorize () {
   cache_save ("dir_cache.scm");
   cache_save ("stat_cache.scm");
   cache_save ("font_cache.scm");
+  cache_save ("image_cache.scm");
   cache_save ("validate_cache.scm");
 }
 
@@ -16,16 +16,16 @@
 
 #include "fast_alloc.hpp"
 
-void*   alloc_table[MAX_FAST]; // Static declaration initializes with NULL's
-char*  alloc_mem=NULL;
+ALLOC_LOCAL void* alloc_table[MAX_FAST]; // Static declaration initializes with NULL's
+ALLOC_LOCAL char* alloc_mem=NULL;
 #ifdef DEBUG_ON
 char*  alloc_mem_top=NULL;
 char*  alloc_mem_bottom=(char*)((unsigned long long)-1);
 #endif
-size_t alloc_remains=0;
-int    allocated=0;
-int    fast_chunks=0;
-int    large_uses=0;
+ALLOC_LOCAL size_t alloc_remains=0;
+alloc_counter allocated (0);
+alloc_counter fast_chunks (0);
+alloc_counter large_uses (0);
 int    MEM_DEBUG=0;
 int    mem_used ();
 
@@ -288,7 +288,7 @@ operator new (register size_t s) {
 }
 
 void
-operator delete (register void* ptr) {
+operator delete (register void* ptr) noexcept {
   ptr= (void*) (((char*) ptr)- WORD_LENGTH);
   register size_t s= *((size_t *) ptr);
   if (s<MAX_FAST) {
@@ -319,7 +319,7 @@ operator new[] (register size_t s) {
 }
 
 void
-operator delete[] (register void* ptr) {
+operator delete[] (register void* ptr) noexcept {
   ptr= (void*) (((char*) ptr)- WORD_LENGTH);
   register size_t s= *((size_t *) ptr);
   if (s<MAX_FAST) {
@@ -24,16 +24,26 @@
 * Globals
 ******************************************************************************/
 
-extern void*   alloc_table[MAX_FAST]; // Static declaration initializes with NULL's
-extern char*  alloc_mem;
+// With thread-safe reference counting, each thread has its own free lists
+#ifdef USE_ATOMIC_REFCOUNT
+#include <atomic>
+#define ALLOC_LOCAL thread_local
+typedef std::atomic<int> alloc_counter;
+#else
+#define ALLOC_LOCAL
+typedef int alloc_counter;
+#endif
+
+extern ALLOC_LOCAL void* alloc_table[MAX_FAST];
+extern ALLOC_LOCAL char* alloc_mem;
 #ifdef DEBUG_ON
 extern char*  alloc_mem_top;
 extern char*  alloc_mem_bottom;
 #endif
 bool break_stub(void* ptr);
-extern size_t alloc_remains;
-extern int    allocated;
-extern int    large_uses;
+extern ALLOC_LOCAL size_t alloc_remains;
+extern alloc_counter allocated;
+extern alloc_counter large_uses;
 
 #define alloc_ptr(i) alloc_table[i]
 #define ind(ptr) (*((void **) ptr))
@@ -430,6 +440,8 @@ tm_delete_array (C* Ptr) {
 
 #if defined(NO_FAST_ALLOC) || defined(X11TEXMACS)
 
+#include <new>
+
 #ifndef NO_FAST_ALLOC
 #ifdef OS_IRIX
 void* operator new (register size_t s) throw(std::bad_alloc);
@@ -438,9 +450,9 @@ void* operator new[] (register size_t s) throw(std::bad_alloc);
 void  operator delete[] (register void* ptr) throw();
 #else
 void* operator new (register size_t s);
-void  operator delete (register void* ptr);
+void  operator delete (register void* ptr) noexcept;
 void* operator new[] (register size_t s);
-void  operator delete[] (register void* ptr);
+void  operator delete[] (register void* ptr) noexcept;
 #endif
 #endif // not defined NO_FAST_ALLOC
 
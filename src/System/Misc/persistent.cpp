@@ -7,60 +7,416 @@
 * This software falls under the GNU general public license version 3 or later.
 * It comes WITHOUT ANY WARRANTY WHATSOEVER. For details, see the file LICENSE
 * in the root directory or <http://www.gnu.org/licenses/gpl-3.0.html>.
+*******************************************************************************
+* Each persistent directory is a log-structured store made of two files:
+*   - 'log' is an append-only write-ahead log of the recent modifications;
+*     each record is made of an operation ('S' for set, 'R' for reset),
+*     the lengths of the key and the value, the key, the value and
+*     a checksum, so that a record which was torn by a crash is detected.
+*   - 'index' is a sorted table of all key-value pairs as of the last
+*     compaction, which is mapped into memory and searched by bisection.
+* Appended records are flushed at once, so that they survive a crash of
+* the process, but the log is only synced to the disk every few seconds,
+* at compaction and when TeXmacs quits (group commit).  A record which
+* was lost or torn by a crash of the system is simply forgotten.
+* The log is replayed into an in-memory table when the store is opened.
+* When the log becomes large, it is merged with the index into a new
+* index, which atomically replaces the old one before the log is emptied.
+* Replaying the log on top of a more recent index is harmless, so that
+* the store remains consistent whenever the process is interrupted.
 ******************************************************************************/
 
 #include "persistent.hpp"
 #include "file.hpp"
 #include "iterator.hpp"
 #include "analyze.hpp"
+#include "merge_sort.hpp"
+#include "tm_timer.hpp"
+#include <stdio.h>
+#include <string.h>
+#ifndef OS_MINGW
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 /******************************************************************************
 * Global data
 ******************************************************************************/
 
 #define MAX_BRANCH 26
-#define MAX_INNER 10
-#define MAX_SIZE 4096
 #define MAX_FILES 26
+#define LOG_COMPACT (1 << 20)
+#define LOG_SYNC_DELAY 5000
+#define INDEX_MAGIC "TMSTORE1"
+#define INDEX_HEADER 12
+
+struct persistent_store_rep {
+  url    log_name;
+  url    index_name;
+  FILE*  log;
+  int    log_size;
+  bool   log_dirty;
+  time_t log_synced;
+  const char* index;
+  int    index_size;
+  int    count;
+  bool   mapped;
+  string index_buf;
+  hashmap<string,string> vals;
+  hashmap<string,bool>   dead;
+  persistent_store_rep (): vals (""), dead (false) {}
+};
+typedef persistent_store_rep* persistent_store;
 
-static hashmap<string,string>       persistent_pre   ("");
-static hashmap<string,url>          persistent_file  (url_none ());
-static hashmap<string,unsigned int> persistent_hash  (0);
-static hashmap<string,bool>         persistent_has   (false);
-static hashmap<string,string>       persistent_cache ("");
+static hashmap<string,pointer> persistent_stores (NULL);
 
 static int number_persistent_file_names= -1;
 
 /******************************************************************************
-* Writing and reading hashmaps to and from disk
+* Binary encoding
 ******************************************************************************/
 
-void
-write_escaped (string& r, string s) {
-  int n= N(s);
+static void
+put_int (string& r, unsigned int x) {
+  r << ((char) (x & 255)) << ((char) ((x >> 8) & 255))
+    << ((char) ((x >> 16) & 255)) << ((char) ((x >> 24) & 255));
+}
+
+static unsigned int
+get_int (const char* s) {
+  const unsigned char* u= (const unsigned char*) s;
+  return ((unsigned int) u[0]) | (((unsigned int) u[1]) << 8) |
+         (((unsigned int) u[2]) << 16) | (((unsigned int) u[3]) << 24);
+}
+
+static unsigned int
+store_checksum (const char* s, int n) {
+  unsigned int h= 2166136261u;
   for (int i=0; i<n; i++) {
-    char c= s[i];
-    if (c == '\\') r << '\\' << '\\';
-    else if (c == '\n') r << '\\' << 'n';
-    else r << c;
+    h ^= (unsigned char) s[i];
+    h *= 16777619u;
   }
+  return h;
 }
 
-void
-persistent_write_map (url file, hashmap<string,string> map) {
-  string s;
-  iterator<string> it= iterate (map);
-  while (it->busy ()) {
-    string key= it->next ();
-    write_escaped (s, key);
-    s << '\n';
-    write_escaped (s, map[key]);
-    s << '\n';
+static int
+store_compare (const char* s1, int n1, const char* s2, int n2) {
+  int c= memcmp (s1, s2, min (n1, n2));
+  if (c != 0) return c;
+  return n1 - n2;
+}
+
+struct store_leq_operator {
+  static inline bool leq (string& a, string& b) {
+    return store_compare (&a[0], N(a), &b[0], N(b)) <= 0; }
+};
+
+/******************************************************************************
+* Low level file access
+******************************************************************************/
+
+static void
+store_sync (FILE* f) {
+  fflush (f);
+#ifndef OS_MINGW
+  (void) fsync (fileno (f));
+#endif
+}
+
+static void
+store_sync_dir (url dir) {
+#ifndef OS_MINGW
+  c_string _dir (concretize (dir));
+  int fd= open (_dir, O_RDONLY);
+  if (fd >= 0) {
+    (void) fsync (fd);
+    close (fd);
   }
-  save_string (file, s, false);
+#else
+  (void) dir;
+#endif
 }
 
-string
+static bool
+store_read (url u, string& s) {
+  c_string _u (concretize (u));
+  FILE* fin= fopen (_u, "rb");
+  s= "";
+  if (fin == NULL) return false;
+  fseek (fin, 0L, SEEK_END);
+  long n= ftell (fin);
+  fseek (fin, 0L, SEEK_SET);
+  if (n > 0) {
+    s= string ((int) n);
+    n= (long) fread (&s[0], 1, (size_t) n, fin);
+    s= s (0, (int) n);
+  }
+  fclose (fin);
+  return true;
+}
+
+static bool
+store_write (url u, string s) {
+  // write a file and make sure that it reached the disk
+  c_string _u (concretize (u));
+  FILE* fout= fopen (_u, "wb");
+  if (fout == NULL) return false;
+  bool ok= (N(s) == 0 || fwrite (&s[0], 1, N(s), fout) == (size_t) N(s));
+  store_sync (fout);
+  fclose (fout);
+  return ok;
+}
+
+static bool
+store_replace (url tmp, url u) {
+  // atomically replace u by tmp
+#ifdef OS_MINGW
+  if (is_regular (u)) remove (u);
+#endif
+  c_string _tmp (concretize (tmp));
+  c_string _u (concretize (u));
+  return rename (_tmp, _u) == 0;
+}
+
+/******************************************************************************
+* The sorted index
+******************************************************************************/
+
+static bool
+store_check_index (const char* s, int n, int& count) {
+  if (n < INDEX_HEADER || memcmp (s, INDEX_MAGIC, 8) != 0) return false;
+  count= (int) get_int (s + 8);
+  if (count < 0 || ((DI) count) * 4 + INDEX_HEADER > (DI) n) return false;
+  for (int i=0; i<count; i++) {
+    DI off= get_int (s + INDEX_HEADER + 4*i);
+    if (off + 8 > (DI) n) return false;
+    DI kn= get_int (s + off), vn= get_int (s + off + 4);
+    if (off + 8 + kn + vn > (DI) n) return false;
+  }
+  return true;
+}
+
+static void
+store_unmap_index (persistent_store st) {
+#ifndef OS_MINGW
+  if (st->mapped) munmap ((void*) st->index, st->index_size);
+#endif
+  st->index= NULL;
+  st->index_size= 0;
+  st->count= 0;
+  st->mapped= false;
+  st->index_buf= "";
+}
+
+static void
+store_map_index (persistent_store st) {
+  store_unmap_index (st);
+  if (!is_regular (st->index_name)) return;
+  const char* s= NULL;
+  int n= 0;
+#ifndef OS_MINGW
+  c_string _name (concretize (st->index_name));
+  int fd= open (_name, O_RDONLY);
+  if (fd < 0) return;
+  struct stat info;
+  if (fstat (fd, &info) == 0 && info.st_size > 0) {
+    void* p= mmap (NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p != MAP_FAILED) {
+      s= (const char*) p;
+      n= (int) info.st_size;
+      st->mapped= true;
+    }
+  }
+  close (fd);
+#endif
+  if (s == NULL) {
+    store_read (st->index_name, st->index_buf);
+    s= &st->index_buf[0];
+    n= N(st->index_buf);
+  }
+  st->index= s;
+  st->index_size= n;
+  if (!store_check_index (s, n, st->count)) {
+    std_warning << "Ignoring corrupted index of persistent store "
+                << st->index_name << LF;
+    store_unmap_index (st);
+  }
+}
+
+static const char*
+store_record (persistent_store st, int i) {
+  return st->index + get_int (st->index + INDEX_HEADER + 4*i);
+}
+
+static bool
+store_search (persistent_store st, string key, string& val) {
+  int lo= 0, hi= st->count;
+  while (lo < hi) {
+    int mid= (lo + hi) >> 1;
+    const char* r= store_record (st, mid);
+    int kn= get_int (r), vn= get_int (r + 4);
+    int c= store_compare (r + 8, kn, &key[0], N(key));
+    if (c == 0) {
+      val= string (r + 8 + kn, vn);
+      return true;
+    }
+    if (c < 0) lo= mid + 1;
+    else hi= mid;
+  }
+  return false;
+}
+
+/******************************************************************************
+* Compaction
+******************************************************************************/
+
+static void
+store_install (persistent_store st, string s) {
+  // replace the index, then empty the log
+  url tmp= glue (st->index_name, ".tmp");
+  if (!store_write (tmp, s)) {
+    std_warning << "Could not update persistent store "
+                << st->index_name << LF;
+    return;
+  }
+  store_unmap_index (st);
+  bool ok= store_replace (tmp, st->index_name);
+  store_sync_dir (head (st->index_name));
+  store_map_index (st);
+  if (!ok) return;
+  if (st->log != NULL) fclose (st->log);
+  c_string _log (concretize (st->log_name));
+  st->log= fopen (_log, "wb");
+  if (st->log != NULL) store_sync (st->log);
+  st->log_size= 0;
+  st->log_dirty= false;
+  st->vals= hashmap<string,string> ("");
+  st->dead= hashmap<string,bool> (false);
+}
+
+static void
+store_compact (persistent_store st) {
+  array<string> keys;
+  iterator<string> it= iterate (st->vals);
+  while (it->busy ()) keys << it->next ();
+  it= iterate (st->dead);
+  while (it->busy ()) keys << it->next ();
+  merge_sort_leq<string,store_leq_operator> (keys);
+
+  // merge the sorted index with the sorted modifications
+  string body;
+  array<int> offs;
+  int i= 0, j= 0, n= N(keys);
+  while (i < st->count || j < n) {
+    int c= -1;
+    const char* r= NULL;
+    if (i < st->count) {
+      r= store_record (st, i);
+      if (j < n) c= store_compare (r + 8, get_int (r), &keys[j][0], N(keys[j]));
+    }
+    else c= 1;
+    if (c < 0) {
+      offs << N(body);
+      body << string (r, 8 + get_int (r) + get_int (r + 4));
+      i++;
+      continue;
+    }
+    if (c == 0) i++;
+    if (st->vals->contains (keys[j])) {
+      string val= st->vals[keys[j]];
+      offs << N(body);
+      put_int (body, N(keys[j]));
+      put_int (body, N(val));
+      body << keys[j] << val;
+    }
+    j++;
+  }
+
+  string s= INDEX_MAGIC;
+  put_int (s, N(offs));
+  int base= INDEX_HEADER + 4 * N(offs);
+  for (int k=0; k<N(offs); k++) put_int (s, base + offs[k]);
+  s << body;
+  store_install (st, s);
+}
+
+/******************************************************************************
+* The write-ahead log
+******************************************************************************/
+
+static void
+store_apply (persistent_store st, char op, string key, string val) {
+  if (op == 'S') {
+    st->vals (key)= val;
+    st->dead->reset (key);
+  }
+  else {
+    st->vals->reset (key);
+    st->dead (key)= true;
+  }
+}
+
+static int
+store_replay (persistent_store st, string s) {
+  // apply the valid records of the log and return the length of this prefix
+  int i= 0, n= N(s);
+  while (i + 13 <= n) {
+    char op= s[i];
+    if (op != 'S' && op != 'R') break;
+    DI kn= get_int (&s[i+1]), vn= get_int (&s[i+5]);
+    if (i + 13 + kn + vn > (DI) n) break;
+    int len= 9 + (int) (kn + vn);
+    if (store_checksum (&s[i], len) != get_int (&s[i+len])) break;
+    string key= s (i + 9, i + 9 + (int) kn);
+    string val= s (i + 9 + (int) kn, i + len);
+    store_apply (st, op, key, val);
+    i += len + 4;
+  }
+  return i;
+}
+
+static void
+store_sync_log (persistent_store st) {
+  if (st->log_dirty && st->log != NULL) store_sync (st->log);
+  st->log_dirty= false;
+  st->log_synced= texmacs_time ();
+}
+
+static void
+store_flush_log (persistent_store st) {
+  if (st->log == NULL) return;
+  fflush (st->log);
+  if (texmacs_time () - st->log_synced >= LOG_SYNC_DELAY)
+    store_sync_log (st);
+}
+
+static void
+store_append (persistent_store st, char op, string key, string val,
+              bool flush= true) {
+  string r;
+  r << op;
+  put_int (r, N(key));
+  put_int (r, N(val));
+  r << key << val;
+  put_int (r, store_checksum (&r[0], N(r)));
+  if (st->log != NULL) {
+    fwrite (&r[0], 1, N(r), st->log);
+    st->log_dirty= true;
+    if (flush) store_flush_log (st);
+  }
+  st->log_size += N(r);
+  store_apply (st, op, key, val);
+  if (st->log_size > max (LOG_COMPACT, st->index_size))
+    store_compact (st);
+}
+
+/******************************************************************************
+* Importing stores in the former sharded format
+******************************************************************************/
+
+static string
 read_escaped (string& s, int& i) {
   string r;
   int n= N(s);
@@ -80,180 +436,156 @@ read_escaped (string& s, int& i) {
   return r;
 }
 
-hashmap<string,string>
-persistent_read_map (url file) {
-  string s;
-  load_string (file, s, false);
-  hashmap<string,string> map;
-  int i=0, n= N(s);
-  while (i<n) {
-    string key= read_escaped (s, i);
-    string val= read_escaped (s, i);
-    map (key)= val;
+static void
+store_import (persistent_store st, url dir, array<url>& files,
+              array<url>& dirs) {
+  // old stores distribute the keys over files and subdirectories
+  // whose names are lowercase letters
+  bool error_flag;
+  array<string> a= read_directory (dir, error_flag);
+  for (int k=0; k<N(a); k++) {
+    if (N(a[k]) != 1 || a[k][0] < 'a' || a[k][0] >= 'a' + MAX_BRANCH)
+      continue;
+    url u= dir * url (a[k]);
+    if (is_directory (u)) {
+      store_import (st, u, files, dirs);
+      dirs << u;
+    }
+    else if (is_regular (u)) {
+      string s;
+      store_read (u, s);
+      int i= 0, n= N(s);
+      while (i<n) {
+        string key= read_escaped (s, i);
+        string val= read_escaped (s, i);
+        store_apply (st, 'S', key, val);
+      }
+      files << u;
+    }
   }
-  return map;
+}
+
+static void
+store_migrate (persistent_store st, url dir) {
+  array<url> files, dirs;
+  store_import (st, dir, files, dirs);
+  if (N(files) == 0 && N(dirs) == 0) return;
+  store_compact (st);
+  if (N(st->vals) != 0) return;
+  for (int i=0; i<N(files); i++) remove (files[i]);
+  for (int i=0; i<N(dirs); i++) rmdir (dirs[i]);
 }
 
 /******************************************************************************
-* Cache management subroutines
+* Opening stores
 ******************************************************************************/
 
-string
-local_prefix (url dir) {
-  string name= as_string (dir);
-  if (!persistent_pre->contains (name)) {
-    string prefix= as_string (N (persistent_pre) + 1) * ":";
-    persistent_pre (name)= prefix;
-    if (!is_directory (dir)) mkdir (dir);
-    if (!is_directory (dir * url ("_"))) mkdir (dir * url ("_"));
-  }
-  return persistent_pre [name];
+static void
+persistent_make_dir (url dir) {
+  if (!is_directory (dir)) mkdir (dir);
+  if (!is_directory (dir * url ("_"))) mkdir (dir * url ("_"));
 }
 
-void
-persistent_init_key (url dir, string key) {
-  string v= local_prefix (dir) * key;
-  if (!persistent_file->contains (v)) {
-    persistent_file (v)= dir;
-    persistent_hash (v)= (unsigned int) hash (key);
-  }
-}
+static persistent_store
+persistent_open (url dir) {
+  string name= as_string (dir);
+  if (persistent_stores->contains (name))
+    return (persistent_store) persistent_stores [name];
+  persistent_make_dir (dir);
+  persistent_store st= tm_new<persistent_store_rep> ();
+  st->log_name  = dir * url ("log");
+  st->index_name= dir * url ("index");
+  st->log       = NULL;
+  st->log_size  = 0;
+  st->log_dirty = false;
+  st->log_synced= texmacs_time ();
+  st->index     = NULL;
+  st->index_size= 0;
+  st->count     = 0;
+  st->mapped    = false;
+  persistent_stores (name)= (pointer) st;
+  bool fresh= !is_regular (st->log_name) && !is_regular (st->index_name);
 
-void
-persistent_update_key (url dir, string key, url file, unsigned int code) {
-  unsigned int ncode= code / MAX_BRANCH;
-  unsigned int mcode= code % MAX_BRANCH;
-  url nfile= file * url (string ((char) (97 + mcode)));
-  string v= local_prefix (dir) * key;
-  persistent_file (v)= nfile;
-  persistent_hash (v)= ncode;
+  store_map_index (st);
+  string s;
+  store_read (st->log_name, s);
+  int valid= store_replay (st, s);
+  if (valid < N(s)) {
+    std_warning << "Truncating damaged log of persistent store "
+                << dir << LF;
+    url tmp= glue (st->log_name, ".tmp");
+    if (store_write (tmp, s (0, valid)))
+      store_replace (tmp, st->log_name);
+  }
+  c_string _log (concretize (st->log_name));
+  st->log= fopen (_log, "ab");
+  st->log_size= valid;
+  if (fresh) store_migrate (st, dir);
+  return st;
 }
 
 /******************************************************************************
-* Storing in cache
+* Public interface
 ******************************************************************************/
 
-int
-total_size (hashmap<string,string> map) {
-  int sum= 0;
-  iterator<string> it= iterate (map);
-  while (it->busy ()) {
-    string key= it->next ();
-    sum += N(key) + N(map[key]);
-  }
-  return sum;
-}
-
-void
-persistent_write (url dir, string key, string val,
-                  url file, unsigned int code)
-{
-  string v= local_prefix (dir) * key;
-  if (is_directory (file)) {
-    persistent_update_key (dir, key, file, code);
-    persistent_write (dir, key, val,
-                      persistent_file [v], persistent_hash [v]);
-  }
-  else {
-    hashmap<string,string> map ("");
-    if (is_regular (file))
-      map= persistent_read_map (file);
-    map (key)= val;
-    if (code == 0 || (N (map) <= MAX_INNER && total_size (map) <= MAX_SIZE))
-      persistent_write_map (file, map);
-    else {
-      remove (file);
-      mkdir (file);
-      iterator<string> it= iterate (map);
-      while (it->busy ()) {
-        string skey= it->next ();
-        string sval= map [skey];
-        string sv  = local_prefix (dir) * skey;
-        unsigned int scode= persistent_hash [sv];
-        persistent_write (dir, skey, sval, file, scode);
-      }
-    }
-  }
-}
-
 void
 persistent_set (url dir, string key, string val) {
-  string v= local_prefix (dir) * key;
-  persistent_init_key (dir, key);
-  persistent_write (dir, key, val, persistent_file [v], persistent_hash [v]);
-  persistent_has   (v)= true;
-  persistent_cache (v)= val;
+  persistent_store st= persistent_open (dir);
+  if (st->vals->contains (key) && st->vals [key] == val) return;
+  store_append (st, 'S', key, val);
 }
 
-/******************************************************************************
-* Removing from cache
-******************************************************************************/
-
 void
-persistent_remove (url dir, string key, url file, unsigned int code) {
-  string v= local_prefix (dir) * key;
-  if (is_directory (file)) {
-    persistent_update_key (dir, key, file, code);
-    persistent_remove (dir, key, persistent_file [v], persistent_hash [v]);
-  }
-  else if (is_regular (file)) {
-    hashmap<string,string> map= persistent_read_map (file);
-    if (map->contains (key)) {
-      map->reset (key);
-      persistent_write_map (file, map);
-    }
-  }
+persistent_set (url dir, array<string> keys, array<string> vals) {
+  // append all pairs to the log before flushing it
+  persistent_store st= persistent_open (dir);
+  for (int i=0; i<N(keys); i++)
+    if (!st->vals->contains (keys[i]) || st->vals [keys[i]] != vals[i])
+      store_append (st, 'S', keys[i], vals[i], false);
+  store_flush_log (st);
 }
 
 void
 persistent_reset (url dir, string key) {
-  string v= local_prefix (dir) * key;
-  persistent_init_key (dir, key);
-  persistent_remove (dir, key, persistent_file [v], persistent_hash [v]);
-  persistent_has (v)= false;
-  persistent_cache->reset (v);
+  persistent_store st= persistent_open (dir);
+  if (st->dead->contains (key)) return;
+  store_append (st, 'R', key, "");
 }
 
-/******************************************************************************
-* Retrieving from cache
-******************************************************************************/
+void
+persistent_clear (url dir) {
+  // remove all pairs at once, by installing an empty index
+  persistent_store st= persistent_open (dir);
+  string s= INDEX_MAGIC;
+  put_int (s, 0);
+  store_install (st, s);
+}
 
 void
-persistent_retrieve (url dir, string key, url file, unsigned int code) {
-  string v= local_prefix (dir) * key;
-  if (is_directory (file)) {
-    persistent_update_key (dir, key, file, code);
-    persistent_retrieve (dir, key, persistent_file [v], persistent_hash [v]);
-  }
-  else if (is_regular (file)) {
-    hashmap<string,string> map= persistent_read_map (file);
-    if (map->contains (key)) {
-      persistent_cache (v)= map [key];
-      persistent_has   (v)= true;
-    }
-    else persistent_has (v)= false;
-  }
-  else persistent_has (v)= false;
+persistent_sync () {
+  // make sure that all modifications reached the disk
+  iterator<string> it= iterate (persistent_stores);
+  while (it->busy ())
+    store_sync_log ((persistent_store) persistent_stores [it->next ()]);
 }
 
 bool
 persistent_contains (url dir, string key) {
-  string v= local_prefix (dir) * key;
-  if (!persistent_has->contains (v)) {
-    persistent_init_key (dir, key);
-    persistent_retrieve (dir, key, persistent_file [v], persistent_hash [v]);
-  }
-  return persistent_has [v];
+  persistent_store st= persistent_open (dir);
+  if (st->vals->contains (key)) return true;
+  if (st->dead->contains (key)) return false;
+  string val;
+  return store_search (st, key, val);
 }
 
 string
 persistent_get (url dir, string key) {
-  string v= local_prefix (dir) * key;
-  if (!persistent_has->contains (v)) {
-    persistent_init_key (dir, key);
-    persistent_retrieve (dir, key, persistent_file [v], persistent_hash [v]);
-  }
-  return persistent_cache [v];
+  persistent_store st= persistent_open (dir);
+  if (st->vals->contains (key)) return st->vals [key];
+  if (st->dead->contains (key)) return "";
+  string val;
+  if (store_search (st, key, val)) return val;
+  return "";
 }
 
 /******************************************************************************
@@ -275,7 +607,7 @@ persistent_make_file_name (url dir, int nr, string suffix) {
 
 url
 persistent_file_name (url dir, string suffix) {
-  (void) local_prefix (dir);
+  persistent_make_dir (dir);
   dir= dir * url ("_");
   url nr= dir * url ("_");
   if (number_persistent_file_names == -1) {
@@ -14,7 +14,10 @@
 #include "file.hpp"
 
 void persistent_set (url dir, string key, string val);
+void persistent_set (url dir, array<string> keys, array<string> vals);
 void persistent_reset (url dir, string key);
+void persistent_clear (url dir);
+void persistent_sync ();
 bool persistent_contains (url dir, string key);
 string persistent_get (url dir, string key);
 url persistent_file_name (url dir, string suffix);
@@ -0,0 +1,267 @@
+
+/******************************************************************************
+* MODULE     : subprocess.cpp
+* DESCRIPTION: Worker processes communicating through pipes
+* COPYRIGHT  : (C) 2026  the TeXmacs team
+*******************************************************************************
+* This software falls under the GNU general public license version 3 or later.
+* It comes WITHOUT ANY WARRANTY WHATSOEVER. For details, see the file LICENSE
+* in the root directory or <http://www.gnu.org/licenses/gpl-3.0.html>.
+*******************************************************************************
+* Workers are either forked, in which case they send their results to
+* the parent through a pipe, or spawned as separate executables, in which
+* case they are also given a pipe for their standard input.
+* All reads, writes, polls and waits are restarted when interrupted by
+* a signal, partial writes are continued, and a worker is only ever reaped
+* by an explicit subprocess_wait on its own pid, so that other children
+* of TeXmacs (plug-ins, converters) are left alone.
+******************************************************************************/
+
+#include "subprocess.hpp"
+#include "tm_ostream.hpp"
+#include <stdio.h>
+#ifndef OS_MINGW
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+extern char **environ;
+#endif
+
+#define SUBPROCESS_BUFFER 65536
+
+/******************************************************************************
+* Forking and spawning workers
+******************************************************************************/
+
+#ifndef OS_MINGW
+static void
+subprocess_flush () {
+  // pending output would otherwise be written both by parent and child
+  cout.flush ();
+  cerr.flush ();
+  fflush (stdout);
+  fflush (stderr);
+}
+
+static void
+subprocess_cloexec (int fd) {
+  (void) fcntl (fd, F_SETFD, fcntl (fd, F_GETFD) | FD_CLOEXEC);
+}
+#endif
+
+int
+subprocess_fork (int& fd) {
+  // returns 0 in the child, which writes to fd, and the pid of the child
+  // in the parent, which reads from fd; returns -1 on failure
+#ifdef OS_MINGW
+  (void) fd;
+  return -1;
+#else
+  int p[2];
+  if (pipe (p) != 0) return -1;
+  subprocess_flush ();
+  pid_t pid= fork ();
+  if (pid == 0) {
+    close (p[0]);
+    fd= p[1];
+    return 0;
+  }
+  close (p[1]);
+  if (pid < 0) {
+    close (p[0]);
+    return -1;
+  }
+  subprocess_cloexec (p[0]);
+  fd= p[0];
+  return (int) pid;
+#endif
+}
+
+int
+subprocess_spawn (array<string> args, int& in, int& out) {
+  // executes args[0] with standard input from in and standard output to out
+#ifdef OS_MINGW
+  (void) args; (void) in; (void) out;
+  return -1;
+#else
+  if (N(args) == 0) return -1;
+  int p_in[2], p_out[2];
+  if (pipe (p_in) != 0) return -1;
+  if (pipe (p_out) != 0) {
+    close (p_in[0]); close (p_in[1]);
+    return -1;
+  }
+  // other workers must not inherit our ends, or they would never see EOF
+  subprocess_cloexec (p_in[0]); subprocess_cloexec (p_in[1]);
+  subprocess_cloexec (p_out[0]); subprocess_cloexec (p_out[1]);
+  // a worker which dies should not kill us when we write to it
+  signal (SIGPIPE, SIG_IGN);
+
+  posix_spawn_file_actions_t actions;
+  posix_spawnattr_t attr;
+  sigset_t defaults;
+  posix_spawn_file_actions_init (&actions);
+  posix_spawn_file_actions_adddup2 (&actions, p_in[0], 0);
+  posix_spawn_file_actions_adddup2 (&actions, p_out[1], 1);
+  posix_spawnattr_init (&attr);
+  sigemptyset (&defaults);
+  sigaddset (&defaults, SIGPIPE);
+  posix_spawnattr_setsigdefault (&attr, &defaults);
+  posix_spawnattr_setflags (&attr, POSIX_SPAWN_SETSIGDEF);
+  array<char*> argv;
+  for (int i=0; i<N(args); i++) argv << as_charp (args[i]);
+  argv << (char*) NULL;
+  subprocess_flush ();
+  pid_t pid;
+  int r= posix_spawnp (&pid, argv[0], &actions, &attr, A(argv), environ);
+  for (int i=0; i<N(args); i++) tm_delete_array (argv[i]);
+  posix_spawnattr_destroy (&attr);
+  posix_spawn_file_actions_destroy (&actions);
+
+  close (p_in[0]);
+  close (p_out[1]);
+  if (r != 0) {
+    close (p_in[1]);
+    close (p_out[0]);
+    return -1;
+  }
+  in = p_in[1];
+  out= p_out[0];
+  return (int) pid;
+#endif
+}
+
+void
+subprocess_exit (int fd, bool ok) {
+  // terminate a forked worker without running the destructors of the parent
+#ifdef OS_MINGW
+  (void) fd; (void) ok;
+#else
+  if (fd >= 0) close (fd);
+  subprocess_flush ();
+  _exit (ok? 0: 1);
+#endif
+}
+
+/******************************************************************************
+* Communication
+******************************************************************************/
+
+bool
+subprocess_write (int fd, string s) {
+#ifdef OS_MINGW
+  (void) fd; (void) s;
+  return false;
+#else
+  int done= 0;
+  while (done < N(s)) {
+    ssize_t w= write (fd, &s[done], min (N(s) - done, SUBPROCESS_BUFFER));
+    if (w < 0 && errno == EINTR) continue;
+    if (w <= 0) return false;
+    done += (int) w;
+  }
+  return true;
+#endif
+}
+
+int
+subprocess_read (int fd, string& s) {
+  // appends the available data to s and returns its length,
+  // or 0 at the end of the stream and -1 on errors
+#ifdef OS_MINGW
+  (void) fd; (void) s;
+  return -1;
+#else
+  char buf[SUBPROCESS_BUFFER];
+  while (true) {
+    ssize_t r= read (fd, buf, SUBPROCESS_BUFFER);
+    if (r < 0 && errno == EINTR) continue;
+    if (r > 0) s << string (buf, (int) r);
+    return r < 0? -1: (int) r;
+  }
+#endif
+}
+
+int
+subprocess_poll (array<int> fds, array<bool>& ready, int msecs) {
+  // wait at most msecs (forever if negative) until one of the fds
+  // can be read; returns the number of such fds, or -1 on errors.
+  // Negative fds are ignored.
+  ready= array<bool> (N(fds));
+  for (int i=0; i<N(fds); i++) ready[i]= false;
+#ifdef OS_MINGW
+  (void) msecs;
+  return -1;
+#else
+  if (N(fds) == 0) return 0;
+  array<struct pollfd> pfds (N(fds));
+  for (int i=0; i<N(fds); i++) {
+    pfds[i].fd= fds[i];
+    pfds[i].events= POLLIN;
+    pfds[i].revents= 0;
+  }
+  int r;
+  do r= poll (&pfds[0], N(fds), msecs);
+  while (r < 0 && errno == EINTR);
+  if (r <= 0) return r;
+  for (int i=0; i<N(fds); i++)
+    ready[i]= (fds[i] >= 0 && pfds[i].revents != 0);
+  return r;
+#endif
+}
+
+/******************************************************************************
+* Terminating workers
+******************************************************************************/
+
+int
+subprocess_wait (int pid, bool block) {
+  // returns 1 if the worker exited successfully, 0 if it failed,
+  // and -1 if it is still running and we did not block
+#ifdef OS_MINGW
+  (void) pid; (void) block;
+  return 0;
+#else
+  int status= 0;
+  pid_t r;
+  do r= waitpid ((pid_t) pid, &status, block? 0: WNOHANG);
+  while (r < 0 && errno == EINTR);
+  if (r == 0) return -1;
+  if (r < 0) return 0;
+  return (WIFEXITED (status) && WEXITSTATUS (status) == 0)? 1: 0;
+#endif
+}
+
+void
+subprocess_collect (array<int> pids, array<int> fds,
+                    array<string>& outs, array<bool>& oks)
+{
+  // read the outputs of forked workers until they close their pipes,
+  // and then reap them; the fds are closed
+  int i, n= N(fds), open= n;
+  outs= array<string> (n);
+  oks = array<bool> (N(pids));
+  fds = copy (fds);
+  while (open > 0) {
+    array<bool> ready;
+    if (subprocess_poll (fds, ready, -1) < 0) {
+      // the workers are independent: we may also read them in turn
+      for (i=0; i<n; i++)
+        if (fds[i] >= 0) ready[i]= true;
+    }
+    for (i=0; i<n; i++)
+      if (ready[i] && subprocess_read (fds[i], outs[i]) <= 0) {
+#ifndef OS_MINGW
+        close (fds[i]);
+#endif
+        fds[i]= -1;
+        open--;
+      }
+  }
+  for (i=0; i<N(pids); i++)
+    oks[i]= (subprocess_wait (pids[i], true) == 1);
+}
@@ -0,0 +1,27 @@
+
+/******************************************************************************
+* MODULE     : subprocess.hpp
+* DESCRIPTION: Worker processes communicating through pipes
+* COPYRIGHT  : (C) 2026  the TeXmacs team
+*******************************************************************************
+* This software falls under the GNU general public license version 3 or later.
+* It comes WITHOUT ANY WARRANTY WHATSOEVER. For details, see the file LICENSE
+* in the root directory or <http://www.gnu.org/licenses/gpl-3.0.html>.
+******************************************************************************/
+
+#ifndef SUBPROCESS_H
+#define SUBPROCESS_H
+#include "string.hpp"
+#include "array.hpp"
+
+int  subprocess_fork (int& fd);
+int  subprocess_spawn (array<string> args, int& in, int& out);
+bool subprocess_write (int fd, string s);
+int  subprocess_read (int fd, string& s);
+int  subprocess_poll (array<int> fds, array<bool>& ready, int msecs);
+int  subprocess_wait (int pid, bool block= true);
+void subprocess_exit (int fd, bool ok);
+void subprocess_collect (array<int> pids, array<int> fds,
+                         array<string>& outs, array<bool>& oks);
+
+#endif // defined SUBPROCESS_H
@@ -139,6 +139,9 @@
 
 #cmakedefine TM_DYNAMIC_LINKING 1
 
+/* Thread-safe reference counting in the kernel */
+#cmakedefine USE_ATOMIC_REFCOUNT 1
+
 /* Use axel library */
 #cmakedefine USE_AXEL 1
 
@@ -0,0 +1,293 @@
+
+/******************************************************************************
+* MODULE     : tm_batch.cpp
+* DESCRIPTION: Batch conversions using a pool of pre-initialized workers
+* COPYRIGHT  : (C) 2026  the TeXmacs team
+*******************************************************************************
+* This software falls under the GNU general public license version 3 or later.
+* It comes WITHOUT ANY WARRANTY WHATSOEVER. For details, see the file LICENSE
+* in the root directory or <http://www.gnu.org/licenses/gpl-3.0.html>.
+*******************************************************************************
+* The conversion jobs are distributed over a pool of worker processes,
+* which are started as 'texmacs -batch-worker' and initialized only once,
+* after which they perform jobs until their standard input is closed.
+* Each job is sent to a worker as a line "convert<TAB>in<TAB>out" and
+* the worker answers with a line "ok" or "failed".  The same workers
+* also perform background image conversions for the editor, which are
+* sent as lines "image<TAB>src<TAB>dest<TAB>format<TAB>w<TAB>h<TAB>dpi".  The usual output of
+* a worker goes to its standard error, so that it cannot be mistaken
+* for an answer.  Workers are spawned as new executables instead of being
+* forked from the server, since the server may run several threads.
+* Jobs are read line by line from a file, or from the standard input
+* when the file is "-".  Each line contains an input and an output file,
+* separated by white space; empty lines and lines starting with '#'
+* are ignored.
+******************************************************************************/
+
+#include "file.hpp"
+#include "scheme.hpp"
+#include "analyze.hpp"
+#include "tm_timer.hpp"
+#include "subprocess.hpp"
+#include "image_files.hpp"
+#include "sys_utils.hpp"
+#include <stdio.h>
+#ifndef OS_MINGW
+#include <unistd.h>
+#endif
+
+static string batch_executable= "texmacs.bin";
+static int    batch_reply= -1;
+
+/******************************************************************************
+* Reading jobs
+******************************************************************************/
+
+static bool
+batch_read_line (FILE* fin, string& line) {
+  char buf[4096];
+  line= "";
+  bool got= false;
+  while (fgets (buf, 4096, fin) != NULL) {
+    got= true;
+    line << string (buf);
+    if (N(line) > 0 && line[N(line)-1] == '\n') break;
+  }
+  while (N(line) > 0 &&
+         (line[N(line)-1] == '\n' || line[N(line)-1] == '\r'))
+    line= line (0, N(line)-1);
+  return got;
+}
+
+static bool
+batch_read_job (FILE* fin, url& in, url& out) {
+  string line;
+  while (batch_read_line (fin, line)) {
+    line= trim_spaces (line);
+    if (N(line) == 0 || line[0] == '#') continue;
+    int i= 0, n= N(line);
+    while (i<n && line[i] != ' ' && line[i] != '\t') i++;
+    string a= line (0, i);
+    string b= trim_spaces (line (i, n));
+    if (N(b) == 0) {
+      cout << "TeXmacs] malformed conversion job: " << line << "\n";
+      continue;
+    }
+    in = url ("$PWD", a);
+    out= url ("$PWD", b);
+    return true;
+  }
+  return false;
+}
+
+/******************************************************************************
+* Performing jobs
+******************************************************************************/
+
+static bool
+batch_convert_one (url in, url out) {
+  string cmd=
+    "(begin (load-buffer " * scm_quote (as_string (in)) * " :strict) " *
+    "(export-buffer " * scm_quote (as_string (out)) * "))";
+  if (exists (out)) remove (out);
+  (void) eval (cmd);
+  return exists (out);
+}
+
+static void
+batch_report (url in, url out, bool ok, time_t ms) {
+  cout << "TeXmacs] " << (ok? "converted ": "failed to convert ")
+       << as_string (in) << " -> " << as_string (out)
+       << " (" << ((int) ms) << " ms)\n";
+  cout.flush ();
+}
+
+/******************************************************************************
+* Worker processes
+******************************************************************************/
+
+void
+batch_init (char* exe, bool worker) {
+  // remember how to start workers; a worker keeps its standard output
+  // for the answers and sends everything else to its standard error
+  batch_executable= exe;
+  if (occurs ("/", batch_executable) && !starts (batch_executable, "/"))
+    batch_executable= as_string (url_pwd ()) * "/" * batch_executable;
+#ifndef OS_MINGW
+  if (worker) {
+#ifdef QTTEXMACS
+    // workers never show their windows
+    if (get_env ("QT_QPA_PLATFORM") == "")
+      set_env ("QT_QPA_PLATFORM", "offscreen");
+#endif
+    fflush (stdout);
+    batch_reply= dup (1);
+    dup2 (2, 1);
+  }
+#else
+  (void) worker;
+#endif
+}
+
+int
+batch_spawn (int& in, int& out) {
+  array<string> args;
+  args << batch_executable << string ("-s") << string ("-batch-worker");
+  return subprocess_spawn (args, in, out);
+}
+
+void
+batch_serve () {
+  string line;
+  while (batch_read_line (stdin, line)) {
+    array<string> a= tokenize (line, "\t");
+    bool ok= false;
+    if (N(a) == 3 && a[0] == "convert")
+      ok= batch_convert_one (url_system (a[1]), url_system (a[2]));
+    else if (N(a) == 7 && a[0] == "image") {
+      url dest= url_system (a[2]);
+      convert_image (url_system (a[1]), dest, a[3],
+                     as_int (a[4]), as_int (a[5]), as_int (a[6]));
+      ok= exists (dest);
+    }
+    cout.flush ();
+    if (!subprocess_write (batch_reply, ok? string ("ok\n"): "failed\n"))
+      break;
+  }
+}
+
+/******************************************************************************
+* Distributing the jobs
+******************************************************************************/
+
+#ifndef OS_MINGW
+struct batch_worker {
+  int pid, in, out, job;
+  string buf;
+};
+
+static void
+batch_stop (batch_worker& w) {
+  close (w.in);
+  close (w.out);
+  (void) subprocess_wait (w.pid);
+  w.pid= -1;
+}
+#endif
+
+void
+batch_convert (string jobs, int workers) {
+  FILE* fin= stdin;
+  if (jobs != "-") {
+    c_string name (concretize (url ("$PWD", jobs)));
+    fin= fopen (name, "r");
+    if (fin == NULL) {
+      cout << "TeXmacs] could not open conversion jobs " << jobs << "\n";
+      return;
+    }
+  }
+  if (workers <= 0) {
+#ifdef OS_MINGW
+    workers= 1;
+#else
+    workers= max (1, (int) sysconf (_SC_NPROCESSORS_ONLN));
+#endif
+  }
+  time_t start= texmacs_time ();
+  int nr_jobs= 0, nr_ok= 0;
+  url in, out;
+#ifdef OS_MINGW
+  while (batch_read_job (fin, in, out)) {
+    time_t t= texmacs_time ();
+    bool ok= batch_convert_one (in, out);
+    batch_report (in, out, ok, texmacs_time () - t);
+    nr_jobs++;
+    if (ok) nr_ok++;
+  }
+#else
+  array<batch_worker> pool;
+  array<url>    ins, outs;
+  array<time_t> starts;
+  bool more= true;
+  int busy= 0;
+  while (more || busy > 0) {
+    // hand out jobs to idle workers, starting new workers when needed
+    int idle= -1, alive= 0;
+    for (int w=0; w<N(pool); w++)
+      if (pool[w].pid > 0) {
+        alive++;
+        if (idle < 0 && pool[w].job < 0) idle= w;
+      }
+    if (more && idle < 0 && alive < workers) {
+      batch_worker w;
+      w.pid= batch_spawn (w.in, w.out);
+      w.job= -1;
+      if (w.pid > 0) {
+        pool << w;
+        idle= N(pool) - 1;
+      }
+      else if (busy == 0) {
+        // no workers at all: perform the jobs ourselves
+        while (batch_read_job (fin, in, out)) {
+          time_t t= texmacs_time ();
+          bool ok= batch_convert_one (in, out);
+          batch_report (in, out, ok, texmacs_time () - t);
+          nr_jobs++;
+          if (ok) nr_ok++;
+        }
+        more= false;
+        continue;
+      }
+      else workers= alive;
+    }
+    if (more && idle >= 0) {
+      more= batch_read_job (fin, in, out);
+      if (!more) continue;
+      int job= N(ins);
+      ins << in; outs << out; starts << texmacs_time ();
+      nr_jobs++;
+      string cmd= "convert\t" * as_string (in) * "\t" * as_string (out);
+      pool[idle].job= job;
+      busy++;
+      if (!subprocess_write (pool[idle].in, cmd * "\n")) {
+        batch_stop (pool[idle]);
+        pool[idle].job= -1;
+        busy--;
+        batch_report (in, out, false, texmacs_time () - starts[job]);
+      }
+      continue;
+    }
+
+    // wait for answers
+    array<int> fds;
+    array<bool> ready;
+    for (int w=0; w<N(pool); w++)
+      fds << ((pool[w].job >= 0)? pool[w].out: -1);
+    if (subprocess_poll (fds, ready, -1) < 0) break;
+    for (int w=0; w<N(pool); w++) {
+      if (!ready[w]) continue;
+      batch_worker& bw= pool[w];
+      int job= bw.job;
+      bool alive= subprocess_read (bw.out, bw.buf) > 0;
+      int pos= search_forwards ("\n", bw.buf);
+      if (pos < 0 && alive) continue;
+      bool ok= (pos >= 0 && bw.buf (0, pos) == "ok");
+      bw.buf= (pos >= 0)? bw.buf (pos + 1, N(bw.buf)): string ();
+      bw.job= -1;
+      busy--;
+      if (!alive) batch_stop (bw);
+      batch_report (ins[job], outs[job], ok, texmacs_time () - starts[job]);
+      if (ok) nr_ok++;
+    }
+  }
+  for (int w=0; w<N(pool); w++)
+    if (pool[w].pid > 0) batch_stop (pool[w]);
+#endif
+  if (fin != stdin) fclose (fin);
+  int total= max (1, (int) (texmacs_time () - start));
+  cout << "TeXmacs] converted " << nr_ok << " of " << nr_jobs
+       << " documents in " << total << " ms using "
+       << workers << " workers ("
+       << as_string ((1000.0 * nr_jobs) / total) << " documents/s)\n";
+  cout.flush ();
+}
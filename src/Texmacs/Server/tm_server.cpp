@@ -16,11 +16,14 @@
 #include "connect.hpp"
 #include "sys_utils.hpp"
 #include "file.hpp"
+#include "image_files.hpp"
 #include "analyze.hpp"
 #include "dictionary.hpp"
 #include "tm_link.hpp"
 #include "socket_notifier.hpp"
 #include "new_style.hpp"
+#include "thread_pool.hpp"
+#include "persistent.hpp"
 #include "Database/database.hpp"
 
 server* the_server= NULL;
@@ -154,6 +157,8 @@ tm_server_rep::interpose_handler () {
   perform_select ();
   exec_pending_commands ();
 #endif
+  main_thread_dispatch ();
+  connection_async_poll ();
 
   int i, j;
   for (i=0; i<N(bufs); i++) {
@@ -170,6 +175,16 @@ tm_server_rep::interpose_handler () {
     }
   }
 
+  if (poll_image_conversions ())
+    // some images which were converted in the background are now ready
+    for (i=0; i<N(bufs); i++) {
+      tm_buffer buf= (tm_buffer) bufs[i];
+      for (j=0; j<N(buf->vws); j++) {
+        tm_view vw= (tm_view) buf->vws[j];
+        if (vw->win != NULL) vw->ed->invalidate_all ();
+      }
+    }
+
   windows_refresh ();
   sync_databases ();
 }
@@ -253,6 +268,7 @@ tm_server_rep::quit () {
   close_all_pipes ();
   call ("quit-TeXmacs-scheme");
   clear_pending_commands ();
+  persistent_sync ();
 #ifdef QTTEXMACS
   del_obj_qt_renderer ();
 #endif
@@ -60,7 +60,14 @@ extern bool texmacs_started;
 bool disable_error_recovery= false;
 bool start_server_flag= false;
 string extra_init_cmd;
+string batch_jobs;
+int    batch_workers= 0;
+bool   batch_worker= false;
 void server_start ();
+void batch_init (char* exe, bool worker);
+void batch_convert (string jobs, int workers);
+void batch_serve ();
+extern int line_break_workers;
 
 /******************************************************************************
 * For testing
@@ -300,6 +307,19 @@ TeXmacs_main (int argc, char** argv) {
         i++;
         if (i<argc) my_init_cmds= (my_init_cmds * " ") * argv[i];
       }
+      else if (s == "-batch") {
+        i++;
+        if (i<argc) batch_jobs= argv[i];
+      }
+      else if (s == "-batch-jobs") {
+        i++;
+        if (i<argc) batch_workers= as_int (string (argv[i]));
+      }
+      else if (s == "-batch-worker");
+      else if (s == "-line-break-jobs") {
+        i++;
+        if (i<argc) line_break_workers= as_int (string (argv[i]));
+      }
       else if (s == "-server") start_server_flag= true;
       else if (s == "-log-file") i++;
       else if ((s == "-Oc") || (s == "-no-char-clipping")) char_clip= false;
@@ -330,6 +350,11 @@ TeXmacs_main (int argc, char** argv) {
         cout << "Options for TeXmacs:\n\n";
         cout << "  -b [file]  Specify scheme buffers initialization file\n";
         cout << "  -c [i] [o] Convert file 'i' into file 'o'\n";
+        cout << "  -batch [f] Perform the conversions 'i o' listed in file 'f'\n";
+        cout << "             (or on the standard input for '-')\n";
+        cout << "  -batch-jobs [n] Number of simultaneous batch conversions\n";
+        cout << "  -line-break-jobs [n] Number of processes for line breaking\n";
+        cout << "             (0 for one per processor)\n";
         cout << "  -d         For debugging purposes\n";
         cout << "  -fn [font] Set the default TeX font\n";
         cout << "  -g [geom]  Set geometry of window in pixels\n";
@@ -421,6 +446,8 @@ TeXmacs_main (int argc, char** argv) {
              (s == "-i") || (s == "-initialize") ||
              (s == "-g") || (s == "-geometry") ||
              (s == "-x") || (s == "-execute") ||
+             (s == "-batch") || (s == "-batch-jobs") ||
+             (s == "-line-break-jobs") ||
              (s == "-log-file") ||
              (s == "-build-manual") ||
              (s == "-reference-suite") || (s == "-test-suite")) i++;
@@ -454,9 +481,13 @@ TeXmacs_main (int argc, char** argv) {
   if (DEBUG_STD) debug_boot << "Starting event loop...\n";
   texmacs_started= true;
   if (!disable_error_recovery) signal (SIGSEGV, clean_exit_on_segfault);
-  if (start_server_flag) server_start ();
-  if (N(extra_init_cmd) > 0) exec_delayed (scheme_cmd (extra_init_cmd));
-  gui_start_loop ();
+  if (batch_worker) batch_serve ();
+  else if (N(batch_jobs) > 0) batch_convert (batch_jobs, batch_workers);
+  else {
+    if (start_server_flag) server_start ();
+    if (N(extra_init_cmd) > 0) exec_delayed (scheme_cmd (extra_init_cmd));
+    gui_start_loop ();
+  }
 
   if (DEBUG_STD) debug_boot << "Stopping server...\n";
   } // ending scope for server sv
@@ -538,6 +569,7 @@ immediate_options (int argc, char** argv) {
       remove (url ("$TEXMACS_HOME_PATH/fonts/font-characteristics.scm"));
       remove (url ("$TEXMACS_HOME_PATH/fonts/error") * url_wildcard ("*"));
     }
+    else if (s == "-batch-worker") batch_worker= true;
     else if (s == "-delete-cache")
       remove (url ("$TEXMACS_HOME_PATH/system/cache") * url_wildcard ("*"));
     else if (s == "-delete-style-cache")
@@ -602,6 +634,7 @@ main (int argc, char** argv) {
   boot_hacks ();
   windows_delayed_refresh (1000000000);
   immediate_options (argc, argv);
+  batch_init (argv[0], batch_worker);
 #ifndef OS_MINGW
   set_env ("LC_NUMERIC", "POSIX");
 #endif
@@ -16,16 +16,19 @@
 * Setting up composite boxes
 ******************************************************************************/
 
-composite_box_rep::composite_box_rep (path ip): box_rep (ip) { }
+composite_box_rep::composite_box_rep (path ip):
+  box_rep (ip), index (NULL) { }
 
-composite_box_rep::composite_box_rep (path ip, array<box> B): box_rep (ip) {
+composite_box_rep::composite_box_rep (path ip, array<box> B):
+  box_rep (ip), index (NULL)
+{
   bs= B;
   position ();
 }
 
 composite_box_rep::composite_box_rep (
   path ip, array<box> B, bool init_sx_sy):
-    box_rep (ip)
+    box_rep (ip), index (NULL)
 {
   bs= B;
   if (init_sx_sy) {
@@ -40,7 +43,7 @@ composite_box_rep::composite_box_rep (
 
 composite_box_rep::composite_box_rep (
   path ip, array<box> B, array<SI> x, array<SI> y):
-    box_rep (ip)
+    box_rep (ip), index (NULL)
 {
   bs= B;
   int i, n= subnr();
@@ -51,10 +54,13 @@ composite_box_rep::composite_box_rep (
   position ();
 }
 
-composite_box_rep::~composite_box_rep () {}
+composite_box_rep::~composite_box_rep () {
+  reset_index ();
+}
 
 void
 composite_box_rep::insert (box b, SI x, SI y) {
+  reset_index ();
   int n= N(bs);
   bs << b;
   sx(n)= x;
@@ -64,6 +70,7 @@ composite_box_rep::insert (box b, SI x, SI y) {
 void
 composite_box_rep::position () {
   int i, n= subnr();
+  reset_index ();
   if (n == 0) {
     x1= y1= x3= y3= 0;
     x2= y2= x4= y4= 0;
@@ -88,6 +95,7 @@ composite_box_rep::position () {
 void
 composite_box_rep::left_justify () {
   int i, n= subnr();
+  reset_index ();
   SI d= x1;
   x1-=d; x2-=d; x3-=d; x4-=d;
   for (i=0; i<n; i++) sx(i) -= d;
@@ -167,6 +175,99 @@ composite_box_rep::transform (frame fr) {
   return N (bs)==0?box ():composite_box (ip, bs);
 }
 
+/******************************************************************************
+* Spatial indices
+******************************************************************************/
+
+box_index_rep::box_index_rep (box_rep* b) {
+  (void) build (b, 0, b->subnr ());
+}
+
+int
+box_index_rep::build (box_rep* b, int start, int end) {
+  int k= N(lo);
+  lo << start; hi << end; left << -1; right << -1;
+  x1 << MAX_SI; y1 << MAX_SI; x2 << -MAX_SI; y2 << -MAX_SI;
+  if (end - start <= BOX_INDEX_LEAF)
+    for (int i=start; i<end; i++) {
+      x1[k]= min (x1[k], b->sx1 (i));
+      y1[k]= min (y1[k], b->sy1 (i));
+      x2[k]= max (x2[k], b->sx2 (i));
+      y2[k]= max (y2[k], b->sy2 (i));
+    }
+  else {
+    int mid= (start + end) >> 1;
+    int l= build (b, start, mid);
+    int r= build (b, mid, end);
+    left[k]= l;
+    right[k]= r;
+    x1[k]= min (x1[l], x1[r]);
+    y1[k]= min (y1[l], y1[r]);
+    x2[k]= max (x2[l], x2[r]);
+    y2[k]= max (y2[l], y2[r]);
+  }
+  return k;
+}
+
+static inline SI
+index_lower_bound (box_index_rep* idx, int k, SI x, SI y) {
+  // lower bound for box_rep::distance on all children of node k
+  return max (idx->x1[k] - x, 0) + max (x - idx->x2[k], 0) +
+         max (idx->y1[k] - y, 0) + max (y - idx->y2[k], 0) - 1;
+}
+
+void
+box_index_rep::nearest (box_rep* b, int k, SI x, SI y, SI delta, bool force,
+                        SI& d, int& m) {
+  if (index_lower_bound (this, k, x, y) > d) return;
+  if (left[k] < 0) {
+    for (int i=lo[k]; i<hi[k]; i++) {
+      SI di= b->distance (i, x, y, delta);
+      if (di < d || (di == d && m >= 0 && i < m))
+        if (b->subbox (i)->accessible () || force) {
+          d= di;
+          m= i;
+        }
+    }
+    return;
+  }
+  int l= left[k], r= right[k];
+  SI dl= index_lower_bound (this, l, x, y);
+  SI dr= index_lower_bound (this, r, x, y);
+  if (dr < dl) {
+    nearest (b, r, x, y, delta, force, d, m);
+    nearest (b, l, x, y, delta, force, d, m);
+  }
+  else {
+    nearest (b, l, x, y, delta, force, d, m);
+    nearest (b, r, x, y, delta, force, d, m);
+  }
+}
+
+void
+composite_box_rep::reset_index () {
+  if (index != NULL) tm_delete (index);
+  index= NULL;
+}
+
+int
+composite_box_rep::find_nearest_child (SI x, SI y, SI delta, bool force) {
+  // the accessible child (or any child if force) which is nearest to (x, y)
+  int i, n= subnr(), d= MAX_SI, m= -1;
+  if (n >= BOX_INDEX_THRESHOLD) {
+    if (index == NULL) index= tm_new<box_index_rep> (this);
+    index->nearest (this, 0, x, y, delta, force, d, m);
+    return m;
+  }
+  for (i=0; i<n; i++)
+    if (distance (i, x, y, delta)< d)
+      if (bs[i]->accessible () || force) {
+	d= distance (i, x, y, delta);
+	m= i;
+      }
+  return m;
+}
+
 /******************************************************************************
 * Cursor routines
 ******************************************************************************/
@@ -201,14 +302,7 @@ composite_box_rep::finalize () {
 int
 composite_box_rep::find_child (SI x, SI y, SI delta, bool force) {
   if (outside (x, delta, x1, x2) && (is_accessible (ip) || force)) return -1;
-  int i, n= subnr(), d= MAX_SI, m= -1;
-  for (i=0; i<n; i++)
-    if (distance (i, x, y, delta)< d)
-      if (bs[i]->accessible () || force) {
-	d= distance (i, x, y, delta);
-	m= i;
-      }
-  return m;
+  return find_nearest_child (x, y, delta, force);
 }
 
 path
@@ -376,14 +470,7 @@ concrete_composite_box_rep::find_child (SI x, SI y, SI delta, bool force) {
   if (border_flag &&
       outside (x, delta, x1, x2) &&
       (is_accessible (ip) || force)) return -1;
-  int i, n= subnr(), d= MAX_SI, m= -1;
-  for (i=0; i<n; i++)
-    if (distance (i, x, y, delta)< d)
-      if (bs[i]->accessible () || force) {
-	d= distance (i, x, y, delta);
-	m= i;
-      }
-  return m;
+  return find_nearest_child (x, y, delta, force);
 }
 
 /******************************************************************************
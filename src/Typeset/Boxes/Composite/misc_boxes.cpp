@@ -175,14 +175,7 @@ page_box_rep::operator tree () {
 
 int
 page_box_rep::find_child (SI x, SI y, SI delta, bool force) {
-  int i, n= subnr(), d= MAX_SI, m= -1;
-  for (i=0; i<n; i++)
-    if (distance (i, x, y, delta)< d)
-      if (bs[i]->accessible () || force) {
-	d= distance (i, x, y, delta);
-	m= i;
-      }
-  return m;
+  return find_nearest_child (x, y, delta, force);
 }
 
 void
@@ -14,6 +14,29 @@
 #include "boxes.hpp"
 #include "array.hpp"
 
+/******************************************************************************
+* Spatial indices for composite boxes with many children
+*******************************************************************************
+* The children are grouped into consecutive ranges, which are organized
+* in a balanced binary tree.  Each node stores the bounding rectangle of
+* the logical extents of the children in its range.  Since the children of
+* a composite box are usually laid out in a coherent order, this yields a
+* bounding volume hierarchy for locating the child under a point.
+******************************************************************************/
+
+#define BOX_INDEX_THRESHOLD 64
+#define BOX_INDEX_LEAF      8
+
+struct box_index_rep {
+  array<int> lo, hi;            // range of children of each node
+  array<int> left, right;       // subnodes of each node, -1 for leaves
+  array<SI>  x1, y1, x2, y2;    // bounding rectangle of each node
+  box_index_rep (box_rep* b);
+  int  build (box_rep* b, int start, int end);
+  void nearest (box_rep* b, int k, SI x, SI y, SI delta, bool force,
+                SI& d, int& m);
+};
+
 /******************************************************************************
 * Composite boxes
 ******************************************************************************/
@@ -21,6 +44,7 @@
 struct composite_box_rep: public box_rep {
   array<box> bs;  // the children
   path lip, rip;  // left-most and right-most inverse paths
+  box_index_rep* index;  // lazily built spatial index of the children
 
   composite_box_rep (path ip);
   composite_box_rep (path ip, array<box> bs);
@@ -32,6 +56,8 @@ struct composite_box_rep: public box_rep {
   void    position ();
   void    left_justify ();
   void    finalize ();
+  void    reset_index ();
+  int     find_nearest_child (SI x, SI y, SI delta, bool force);
 
   int     subnr ();
   box     subbox (int i);
@@ -38,7 +38,7 @@ edit_env_rep::edit_env_rep (drd_info& drd2,
   local_ref (local_ref2), global_ref (global_ref2),
   local_aux (local_aux2), global_aux (global_aux2),
   local_att (local_att2), global_att (global_att2),
-  missing (UNINIT), redefined (), touched (false)
+  missing (UNINIT), redefined (), touched (false), nr_assigned (0)
 {
   initialize_default_env ();
   initialize_default_var_type ();
@@ -157,22 +157,18 @@ void
 edit_env_rep::monitored_patch_env (hashmap<string,tree> patch) {
   if (patch->size == 0) return;
   int i=0, n=patch->n;
-  for (; i<n; i++) {
-    list<hashentry<string,tree> > l=patch->a[i];
-    for (; !is_nil(l); l=l->next)
-      monitored_write_update (l->item.key, l->item.im);
-  }
+  for (; i<n; i++)
+    if (patch->used[i])
+      monitored_write_update (patch->a[i].key, patch->a[i].im);
 }
 
 void
 edit_env_rep::patch_env (hashmap<string,tree> patch) {
   if (patch->size == 0) return;
   int i=0, n=patch->n;
-  for (; i<n; i++) {
-    list<hashentry<string,tree> > l=patch->a[i];
-    for (; !is_nil(l); l=l->next)
-      write_update (l->item.key, l->item.im);
-  }
+  for (; i<n; i++)
+    if (patch->used[i])
+      write_update (patch->a[i].key, patch->a[i].im);
 }
 
 void
@@ -180,6 +176,19 @@ edit_env_rep::read_env (hashmap<string,tree>& ret) {
   ret= copy (env);
 }
 
+bool
+edit_env_rep::same_env (hashmap<string,tree> h) {
+  // faster than h == env, since most values are physically shared
+  if (h->size != env->size) return false;
+  int i=0, n=h->n;
+  for (; i<n; i++)
+    if (h->used[i]) {
+      tree t= env[h->a[i].key];
+      if (!strong_equal (t, h->a[i].im) && t != h->a[i].im) return false;
+    }
+  return true;
+}
+
 void
 edit_env_rep::local_start (hashmap<string,tree>& prev_back) {
   prev_back= back;
@@ -198,11 +207,9 @@ edit_env_rep::local_update (hashmap<string,tree>& old_patch,
 void
 edit_env_rep::local_end (hashmap<string,tree>& prev_back) {
   int i=0, n=back->n;
-  for (; i<n; i++) {
-    list<hashentry<string,tree> > l=back->a[i];
-    for (; !is_nil(l); l=l->next)
-      prev_back->write_back (l->item.key, back);
-  }
+  for (; i<n; i++)
+    if (back->used[i])
+      prev_back->write_back (back->a[i].key, back);
   back= prev_back;
 }
 
@@ -19,10 +19,6 @@
 
 array<line_item> typeset_concat (edit_env env, tree t, path ip);
 void hyphenate (line_item item, int pos, line_item& item1, line_item& item2);
-array<path>
-line_breaks (array<line_item> a, int start, int end,
-	     SI line_width, SI large_width,
-             SI first_spc, SI last_spc, bool ragged);
 
 /******************************************************************************
 * Constructor
@@ -30,7 +26,8 @@ line_breaks (array<line_item> a, int start, int end,
 
 lazy_paragraph_rep::lazy_paragraph_rep (edit_env env2, path ip):
   lazy_rep (LAZY_PARAGRAPH, ip),
-  env (env2), style (""), sss (tm_new<stacker_rep> ())
+  env (env2), style (""), sss (tm_new<stacker_rep> ()),
+  prepared (false), hidden (false)
 {
   sss->ip= ip; // is this necessary?
   style (PAR_FIRST)   = env->read (PAR_FIRST);
@@ -654,6 +651,27 @@ lazy_paragraph_rep::line_end (space spc, int penalty) {
   sss->flush ();
 }
 
+line_break_job
+lazy_paragraph_rep::line_job (int start, int end, string hyphen,
+                              SI the_left, SI the_right,
+                              SI the_first, SI the_last)
+{
+  line_break_job job;
+  job.a          = a;
+  job.start      = start;
+  job.end        = end;
+  job.ragged     = (hyphen == "normal");
+  job.line_width = the_right - the_left;
+  job.large_width= (SI) (job.line_width /
+                         (1.0 - 0.5 * (kreduce + contraction)));
+  // FIXME: the factor 0.5 is somewhat arbitrary and should be taken small
+  // enough so as to compensate for content that cannot be contracted
+  // on the line such as whitespace, images, and other miscellaneous objects.
+  job.first_spc  = the_first;
+  job.last_spc   = the_last;
+  return job;
+}
+
 void
 lazy_paragraph_rep::line_units (
   int start, int end,
@@ -669,14 +687,8 @@ lazy_paragraph_rep::line_units (
   // cout << "    the_right: " << (the_right/PIXEL) << "\n";
 
   int i;
-  bool ragged= (hyphen == "normal");
-  SI line_width= the_right - the_left;
-  SI large_width= (SI) (line_width / (1.0 - 0.5 * (kreduce + contraction)));
-  // FIXME: the factor 0.5 is somewhat arbitrary and should be taken small
-  // enough so as to compensate for content that cannot be contracted
-  // on the line such as whitespace, images, and other miscellaneous objects.
-  array<path> hyphs= line_breaks (a, start, end, line_width, large_width,
-				  the_first, the_last, ragged);
+  array<path> hyphs= line_breaks (line_job (start, end, hyphen, the_left,
+                                            the_right, the_first, the_last));
   for (i=0; i<N(hyphs)-1; i++) {
     if (i>0) line_start ();
     line_unit (hyphs[i], hyphs[i+1], i==N(hyphs)-2, mode,
@@ -712,11 +724,62 @@ lazy_paragraph_rep::format_paragraph_unit (int the_start, int the_end) {
   // cout << "Unit done\n";
 }
 
+SI
+lazy_paragraph_rep::unit_first (hashmap<string,tree> st, int start, int end,
+                                bool& no_first)
+{
+  // update the style parameters st for the unit between start and end
+  // and return the indentation of its first line
+  int j, k;
+  no_first= (st [PAR_NO_FIRST] == "true");
+  st (PAR_NO_FIRST)= "false";
+  if (no_first) st (PAR_FIRST)= "0cm";
+  for (j=start; j<end; j++)
+    if (a[j]->type == CONTROL_ITEM)
+      if (is_tuple (a[j]->t, "env_par")) {
+	if (a[j]->t[1]->label == PAR_FIRST) {
+	  for (k=j-1; k>=start; k--)
+	    if (a[k]->b->w () != 0) break;
+	  if (k >= start) continue;
+	}
+	st (a[j]->t[1]->label)= a[j]->t[2];
+      }
+  no_first= (st [PAR_NO_FIRST] == "true");
+  if (mode == "center") return 0;
+  return env->as_length (st [PAR_FIRST]);
+}
+
+void
+lazy_paragraph_rep::line_break_jobs (format fm, array<line_break_job>& jobs) {
+  // the line breaking jobs which will be performed by produce (fm),
+  // without modifying the paragraph beyond the preparation of the format
+  prepare (fm);
+  hashmap<string,tree> st= copy (style);
+  SI the_width= width - right;
+  int start= 0, i, j;
+  for (i=0; i<=N(a); i++) {
+    if (i<N(a) && (a[i]->type != CONTROL_ITEM || a[i]->t != NEW_LINE))
+      continue;
+    bool no_first;
+    SI the_first= unit_first (st, start, i, no_first);
+    int sub_start= start, sub_end= start;
+    for (j=start; j<=i; j++)
+      if (j == i || (a[j]->type == CONTROL_ITEM && a[j]->t == NEXT_LINE)) {
+	sub_start= sub_end;
+	sub_end  = j;
+	if (sub_start != sub_end)
+	  jobs << line_job (sub_start, sub_end, hyphen,
+			    left, the_width, the_first, 0);
+      }
+    start= i;
+  }
+}
+
 void
 lazy_paragraph_rep::format_paragraph () {
   width -= right;
 
-  int start= 0, i, j, k;
+  int start= 0, i;
   // cout << "Typeset " << a << "\n";
   for (i=0; i<=N(a); i++) {
     // determine the next unit
@@ -727,23 +790,9 @@ lazy_paragraph_rep::format_paragraph () {
     }
 
     // determine the style parameters
-    bool no_first= (style [PAR_NO_FIRST] == "true");
-    style (PAR_NO_FIRST)= "false";
-    if (no_first) style (PAR_FIRST)= "0cm";
-    for (j=start; j<i; j++)
-      if (a[j]->type == CONTROL_ITEM)
-	if (is_tuple (a[j]->t, "env_par")) {
-	  if (a[j]->t[1]->label == PAR_FIRST) {
-	    for (k=j-1; k>=start; k--)
-	      if (a[k]->b->w () != 0) break;
-	    if (k >= start) continue;
-	  }
-	  style (a[j]->t[1]->label)= a[j]->t[2];
-	}
-    no_first= (style [PAR_NO_FIRST] == "true");
+    bool no_first;
+    first= unit_first (style, start, i, no_first);
     if (no_first) env->monitored_write_update (PAR_NO_FIRST, "true");
-    if (mode == "center") first= 0;
-    else first= env->as_length (style [PAR_FIRST]);
     sss->set_env_vars (height, sep, hor_sep, ver_sep, bot, top, swell);
 
     // typeset paragraph unit
@@ -871,17 +920,25 @@ lazy_paragraph_rep::query (lazy_type request, format fm) {
   return lazy_rep::query (request, fm);
 }
 
+void
+lazy_paragraph_rep::prepare (format fm) {
+  if (prepared) return;
+  hidden= (N(a) == 0);
+  if (fm->type == FORMAT_VSTREAM) {
+    format_vstream fs= (format_vstream) fm;
+    width= fs->width;
+    if (N (fs->before) != 0) a= join (fs->before, a);
+    if (N (fs->after ) != 0) a= join (a, fs->after );
+  }
+  prepared= true;
+}
+
 lazy
 lazy_paragraph_rep::produce (lazy_type request, format fm) {
   if (request == type) return this;
   if (request == LAZY_VSTREAM) {
-    bool hidden= (N(a) == 0);
-    if (fm->type == FORMAT_VSTREAM) {
-      format_vstream fs= (format_vstream) fm;
-      width= fs->width;
-      if (N (fs->before) != 0) a= join (fs->before, a);
-      if (N (fs->after ) != 0) a= join (a, fs->after );
-    }
+    prepare (fm);
+    prepared= false;
     format_paragraph ();
     /* Hide line items of height 0 */
     int i, n= N(sss->l);
@@ -14,6 +14,7 @@
 #include "formatter.hpp"
 #include "Format/line_item.hpp"
 #include "Format/format.hpp"
+#include "Line/line_breaker.hpp"
 #include "Stack/stacker.hpp"
 #include "tab.hpp"
 
@@ -39,6 +40,8 @@ protected:
   SI            cur_r;       // the current right offset of the last line unit
   space         cur_w;       // the current width of the line unit
   int           cur_start;   // index of the start of the line unit
+  bool          prepared;    // format for produce already taken into account
+  bool          hidden;      // paragraph without line items of its own
 
   string        mode;        // justified, left, center or right
   double        flexibility; // threshold for switching to ragged mode
@@ -86,17 +89,22 @@ protected:
   void line_unit (path start, path end, bool break_flag,
 		  string mode, SI the_left, SI the_right);
   void line_end (space spc, int penalty);
+  line_break_job line_job (int start, int end, string hyphen,
+                           SI the_left, SI the_right, SI the_first, SI the_last);
   void line_units (int start, int end, bool is_start, bool is_end,
 		   string mode, string hyphen,
 		   SI the_left, SI the_right, SI the_first, SI the_last);
 
   void format_paragraph_unit (int start, int end);
+  SI   unit_first (hashmap<string,tree> st, int start, int end, bool& no_first);
+  void prepare (format fm);
 
 public:
   lazy_paragraph_rep (edit_env env, path ip);
   ~lazy_paragraph_rep ();
   operator tree ();
   void format_paragraph ();
+  void line_break_jobs (format fm, array<line_break_job>& jobs);
   lazy produce (lazy_type request, format fm);
   format query (lazy_type request, format fm);
 };
@@ -11,6 +11,7 @@
 
 #include "Line/lazy_typeset.hpp"
 #include "Line/lazy_vstream.hpp"
+#include "Line/lazy_paragraph.hpp"
 #include "Format/format.hpp"
 #include "Stack/stacker.hpp"
 #include "Boxes/construct.hpp"
@@ -29,6 +30,8 @@ lazy make_lazy_ornament (edit_env env, tree t, path ip);
 * Documents
 ******************************************************************************/
 
+static int document_depth= 0;
+
 lazy_document_rep::lazy_document_rep (edit_env env, tree t, path ip):
   lazy_rep (LAZY_DOCUMENT, ip), par (N(t))
 {
@@ -73,13 +76,26 @@ lazy_document_rep::produce (lazy_type request, format fm) {
       before= fs->before;
       after = fs->after ;
     }
+    array<format> fms (n);
+    for (i=0; i<n; i++)
+      fms[i]= make_format_vstream (width,
+        i==0  ? before: array<line_item> (),
+	i==n-1? after : array<line_item> ());
+    bool prefetch= (line_break_workers != 1 && document_depth == 0);
+    if (prefetch) {
+      array<line_break_job> jobs;
+      for (i=0; i<n; i++)
+	if (par[i]->type == LAZY_PARAGRAPH) {
+	  lazy_paragraph lp= (lazy_paragraph) par[i];
+	  lp->line_break_jobs (fms[i], jobs);
+	}
+      line_breaks_prefetch (jobs);
+    }
+    document_depth++;
     array<page_item> l;
     stack_border     sb;
     for (i=0; i<n; i++) {
-      format tmp_fm= make_format_vstream (width,
-        i==0  ? before: array<line_item> (),
-	i==n-1? after : array<line_item> ());
-      lazy tmp= par[i]->produce (request, tmp_fm);
+      lazy tmp= par[i]->produce (request, fms[i]);
       lazy_vstream tmp_vs= (lazy_vstream) tmp;
       if (i == 0) {
 	l = tmp_vs->l ;
@@ -87,6 +103,8 @@ lazy_document_rep::produce (lazy_type request, format fm) {
       }
       else merge_stack (l, sb, tmp_vs->l, tmp_vs->sb);
     }
+    document_depth--;
+    if (prefetch) line_breaks_flush ();
     return lazy_vstream (ip, "", l, sb);
   }
   return lazy_rep::produce (request, fm);
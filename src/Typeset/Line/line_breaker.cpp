@@ -10,7 +10,14 @@
 ******************************************************************************/
 
 #include "Boxes/construct.hpp"
-#include "Format/line_item.hpp"
+#include "Line/line_breaker.hpp"
+#include "subprocess.hpp"
+#include "tm_timer.hpp"
+#include <string.h>
+#ifndef OS_MINGW
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
 #define PEN DI
 
 /******************************************************************************
@@ -444,6 +451,115 @@ line_breaker_rep::compute_breaks () {
   return ap;
 }
 
+/******************************************************************************
+* Cache of line breaks
+*******************************************************************************
+* The line breaks of a range of line items only depend on the widths,
+* spaces and penalties of the items, on the strings, fonts and languages
+* of the hyphenable items and on the line widths.  They are cached under
+* a signature made of these data, so that paragraphs which are typeset
+* again after a reload or after a change of an unrelated style parameter
+* do not have to be broken again.  The cache has two generations of at
+* most LINE_BREAK_CACHE_SIZE bytes of signatures; when the current one
+* is full, the previous one is dropped and entries which are hit in it
+* are moved to the new one.
+* Building the signature takes time linear in the number of items, like
+* the ragged line breaker itself and like the optimal one on paragraphs
+* of a few lines.  Only justified paragraphs with at least
+* LINE_BREAK_CACHE_MIN_ITEMS items are therefore cached.  The time spent
+* on signatures and on breaking lines is reported by bench_print under
+* "line break signature" and "line break".
+* The boxes of the paragraph, as produced by typeset_concat, are not
+* cached: their typesetting has side effects on the environment.
+******************************************************************************/
+
+#define LINE_BREAK_CACHE_SIZE (1 << 22)
+#define LINE_BREAK_CACHE_MIN_ITEMS 100
+
+static hashmap<string,array<path> > line_break_cur  (array<path> (0));
+static hashmap<string,array<path> > line_break_prev (array<path> (0));
+static int line_break_cur_size= 0;
+
+static void
+put_int (string& r, int x) {
+  r << string ((char*) ((void*) &x), sizeof (int));
+}
+
+static int
+get_int (string& s, int& pos) {
+  int x= 0;
+  if (pos + ((int) sizeof (int)) <= N(s))
+    memcpy (&x, &s[pos], sizeof (int));
+  pos += sizeof (int);
+  return x;
+}
+
+static string
+line_break_signature (array<line_item> a, int start, int end,
+                      SI line_width, SI large_width,
+                      SI first_spc, SI last_spc, bool ragged)
+{
+  string r;
+  put_int (r, start);
+  put_int (r, end);
+  put_int (r, line_width);
+  put_int (r, large_width);
+  put_int (r, first_spc);
+  put_int (r, last_spc);
+  put_int (r, ragged? 1: 0);
+  for (int i=start; i<end; i++) {
+    line_item item= a[i];
+    put_int (r, item->type);
+    put_int (r, item->penalty);
+    put_int (r, item->b->w ());
+    put_int (r, item->spc->min);
+    put_int (r, item->spc->def);
+    put_int (r, item->spc->max);
+    if (item->type == STRING_ITEM) {
+      string s= item->b->get_leaf_string ();
+      string f= item->b->get_leaf_font ()->res_name;
+      string l= item->lan->res_name;
+      put_int (r, N(s)); r << s;
+      put_int (r, N(f)); r << f;
+      put_int (r, N(l)); r << l;
+    }
+    else if (item->type == CONTROL_ITEM)
+      put_int (r, item->t == LINE_BREAK? 1: 0);
+  }
+  return r;
+}
+
+static bool
+line_break_cacheable (int start, int end, bool ragged) {
+  return !ragged && end - start >= LINE_BREAK_CACHE_MIN_ITEMS;
+}
+
+static bool
+line_break_cached (string sig, array<path>& ap) {
+  if (line_break_cur->contains (sig)) {
+    ap= line_break_cur [sig];
+    return true;
+  }
+  if (line_break_prev->contains (sig)) {
+    ap= line_break_prev [sig];
+    line_break_cur (sig)= ap;
+    line_break_cur_size += N(sig);
+    return true;
+  }
+  return false;
+}
+
+static void
+line_break_cache (string sig, array<path> ap) {
+  if (line_break_cur_size + N(sig) > LINE_BREAK_CACHE_SIZE) {
+    line_break_prev= line_break_cur;
+    line_break_cur= hashmap<string,array<path> > (array<path> (0));
+    line_break_cur_size= 0;
+  }
+  line_break_cur (sig)= ap;
+  line_break_cur_size += N(sig);
+}
+
 /******************************************************************************
 * The exported line breaking routine
 *******************************************************************************
@@ -460,12 +576,183 @@ line_breaks (array<line_item> a, int start, int end,
 	     SI line_width, SI large_width,
              SI first_spc, SI last_spc, bool ragged)
 {
+  bool cache= line_break_cacheable (start, end, ragged);
+  string sig;
+  array<path> ap;
+  if (cache) {
+    bench_start ("line break signature");
+    sig= line_break_signature (a, start, end, line_width, large_width,
+                               first_spc, last_spc, ragged);
+    bench_cumul ("line break signature");
+    if (line_break_cached (sig, ap)) return ap;
+  }
+  bench_start ("line break");
   int tol= 5;         // extra tolerance of 5tmpt avoid rounding errors when
   line_width += tol;  // the widths of the boxes sum up to precisely 1par
   line_breaker_rep* H=
     tm_new<line_breaker_rep> (a, start, end, line_width, large_width,
                               first_spc, last_spc);
-  array<path> ap= ragged? H->compute_ragged_breaks (): H->compute_breaks ();
+  ap= ragged? H->compute_ragged_breaks (): H->compute_breaks ();
   tm_delete (H);
+  bench_cumul ("line break");
+  if (cache) line_break_cache (sig, ap);
   return ap;
 }
+
+/******************************************************************************
+* Parallel line breaking
+*******************************************************************************
+* Once the line items of the paragraphs of a document have been computed,
+* the line breaks of the different paragraphs can be computed independently.
+* line_breaks_prefetch distributes a batch of such jobs over a pool of
+* forked workers, which take the next job from a shared counter whenever
+* they become idle.  The results are sent back through pipes and looked up
+* by line_breaks until line_breaks_flush is called; they are also added
+* to the cache, and jobs which are already cached are not dispatched.
+* Since the breaks only depend on the jobs, the result does not depend
+* on the scheduling.
+******************************************************************************/
+
+int line_break_workers= 1;
+
+#define LINE_BREAK_MIN_ITEMS 2000
+
+static hashmap<string,int> prefetched_nr (-1);
+static array<array<path> > prefetched;
+
+static string
+line_break_key (line_break_job job) {
+  string r;
+  DI id= (DI) (pointer) job.a.operator -> ();
+  r << string ((char*) ((void*) &id), sizeof (DI));
+  put_int (r, job.start);
+  put_int (r, job.end);
+  put_int (r, job.line_width);
+  put_int (r, job.large_width);
+  put_int (r, job.first_spc);
+  put_int (r, job.last_spc);
+  put_int (r, job.ragged? 1: 0);
+  return r;
+}
+
+array<path>
+line_breaks (line_break_job job) {
+  if (N(prefetched_nr) != 0) {
+    int nr= prefetched_nr [line_break_key (job)];
+    if (nr >= 0) return prefetched[nr];
+  }
+  return line_breaks (job.a, job.start, job.end,
+                      job.line_width, job.large_width,
+                      job.first_spc, job.last_spc, job.ragged);
+}
+
+void
+line_breaks_flush () {
+  prefetched_nr= hashmap<string,int> (-1);
+  prefetched= array<array<path> > ();
+}
+
+#ifndef OS_MINGW
+static void
+line_breaks_worker (array<line_break_job> jobs, int* next, int fd) {
+  while (true) {
+    int k= __sync_fetch_and_add (next, 1);
+    if (k >= N(jobs)) break;
+    array<path> ap= line_breaks (jobs[k].a, jobs[k].start, jobs[k].end,
+                                 jobs[k].line_width, jobs[k].large_width,
+                                 jobs[k].first_spc, jobs[k].last_spc,
+                                 jobs[k].ragged);
+    string r;
+    put_int (r, k);
+    put_int (r, N(ap));
+    for (int i=0; i<N(ap); i++) {
+      put_int (r, N(ap[i]));
+      for (path p= ap[i]; !is_nil (p); p= p->next)
+        put_int (r, p->item);
+    }
+    if (!subprocess_write (fd, r)) subprocess_exit (fd, false);
+  }
+  subprocess_exit (fd, true);
+}
+
+static void
+line_breaks_receive (array<line_break_job> jobs, array<string> sigs,
+                     string s)
+{
+  int pos= 0;
+  while (pos < N(s)) {
+    int k= get_int (s, pos);
+    int n= get_int (s, pos);
+    if (k < 0 || k >= N(jobs) || n < 0 || pos > N(s)) return;
+    array<path> ap (n);
+    for (int i=0; i<n; i++) {
+      int l= get_int (s, pos);
+      array<int> items (max (l, 0));
+      for (int j=0; j<l; j++) items[j]= get_int (s, pos);
+      path p;
+      for (int j=l-1; j>=0; j--) p= path (items[j], p);
+      ap[i]= p;
+    }
+    if (pos > N(s)) return;
+    prefetched_nr (line_break_key (jobs[k]))= N(prefetched);
+    prefetched << ap;
+    if (N(sigs[k]) != 0) line_break_cache (sigs[k], ap);
+  }
+}
+#endif
+
+void
+line_breaks_prefetch (array<line_break_job> jobs) {
+#ifdef OS_MINGW
+  (void) jobs;
+#else
+  // only dispatch the jobs whose breaks are not yet in the cache
+  int i, total= 0;
+  array<line_break_job> todo;
+  array<string> sigs;
+  for (i=0; i<N(jobs); i++) {
+    line_break_job job= jobs[i];
+    array<path> ap;
+    string sig;
+    if (line_break_cacheable (job.start, job.end, job.ragged)) {
+      sig= line_break_signature (job.a, job.start, job.end,
+                                 job.line_width, job.large_width,
+                                 job.first_spc, job.last_spc, job.ragged);
+      if (line_break_cached (sig, ap)) continue;
+    }
+    todo << job;
+    sigs << sig;
+    total += job.end - job.start;
+  }
+  jobs= todo;
+  int workers= line_break_workers;
+  if (workers <= 0) workers= max (1, (int) sysconf (_SC_NPROCESSORS_ONLN));
+  workers= min (workers, N(jobs));
+  if (workers <= 1 || total < LINE_BREAK_MIN_ITEMS) return;
+
+  int* next= (int*) mmap (NULL, sizeof (int), PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (((void*) next) == MAP_FAILED) return;
+  *next= 0;
+  array<int>    fds;
+  array<int>    pids;
+  array<string> received;
+  array<bool>   oks;
+  for (i=0; i<workers; i++) {
+    int fd;
+    int pid= subprocess_fork (fd);
+    if (pid == 0) line_breaks_worker (jobs, next, fd);
+    if (pid < 0) break;
+    fds << fd;
+    pids << pid;
+  }
+
+  // collect the results while the workers are running
+  subprocess_collect (pids, fds, received, oks);
+  munmap ((void*) next, sizeof (int));
+
+  // jobs of workers which failed are recomputed sequentially by line_breaks
+  for (i=0; i<N(received); i++)
+    line_breaks_receive (jobs, sigs, received[i]);
+#endif
+}
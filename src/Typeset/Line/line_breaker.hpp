@@ -0,0 +1,33 @@
+
+/******************************************************************************
+* MODULE     : line_breaker.hpp
+* DESCRIPTION: Line breaking facility for paragraphs
+* COPYRIGHT  : (C) 2026  the TeXmacs team
+*******************************************************************************
+* This software falls under the GNU general public license version 3 or later.
+* It comes WITHOUT ANY WARRANTY WHATSOEVER. For details, see the file LICENSE
+* in the root directory or <http://www.gnu.org/licenses/gpl-3.0.html>.
+******************************************************************************/
+
+#ifndef LINE_BREAKER_H
+#define LINE_BREAKER_H
+#include "Format/line_item.hpp"
+
+struct line_break_job {
+  array<line_item> a;           // the line items of the paragraph
+  int  start, end;              // the range of items to be broken
+  SI   line_width, large_width; // the normal and maximal widths of lines
+  SI   first_spc, last_spc;     // indentation of the first and last lines
+  bool ragged;                  // ragged or optimal line breaking
+};
+
+extern int line_break_workers;
+
+array<path> line_breaks (array<line_item> a, int start, int end,
+                         SI line_width, SI large_width,
+                         SI first_spc, SI last_spc, bool ragged);
+array<path> line_breaks (line_break_job job);
+void line_breaks_prefetch (array<line_break_job> jobs);
+void line_breaks_flush ();
+
+#endif // defined LINE_BREAKER_H
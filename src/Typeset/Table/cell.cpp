@@ -37,7 +37,9 @@ cell_rep::typeset (tree fm, tree t, path iq) {
   }
   else {
     if (hyphen == "n") {
-      b= typeset_as_concat (env, t, iq);
+      if (!is_nil (prev)) b= prev;
+      else b= typeset_as_concat (env, t, iq);
+      content= b;
       if (vcorrect != "n") {
 	SI y1= b->y1;
 	SI y2= b->y2;
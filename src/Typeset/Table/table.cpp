@@ -13,9 +13,107 @@
 #include "Boxes/construct.hpp"
 #include "Format/format.hpp"
 #include "analyze.hpp"
+#include "iterator.hpp"
 
 lazy make_lazy_paragraph (edit_env env, array<box> bs, path ip);
 
+/******************************************************************************
+* Memorizing the typesetting of large tables
+*******************************************************************************
+* When a large table is typeset again at the same location and in the same
+* environment, then the boxes of its plain cells (whose contents are only
+* made up of text) can be reused whenever the contents and the formats
+* of these cells did not change.  Plain cells have no side effects on the
+* environment (labels, links, counters), so that only the edited cells
+* need to be typeset again.  Other cells may modify the environment for
+* the cells which follow them (using assign), so no cells are reused
+* after such a modification during the typesetting of the table.
+******************************************************************************/
+
+#define TABLE_MEMO_CELLS 64
+#define TABLE_MEMO_MAX   32
+
+struct table_memo_rep {
+  hashmap<string,tree> env;   // the environment at the start of the table
+  tree                 fm;    // the format of the table
+  hashmap<path,tree>   cells; // formats and contents of the plain cells
+  hashmap<path,box>    boxes; // the corresponding typeset contents
+  hashmap<path,tree>   next_cells;
+  hashmap<path,box>    next_boxes;
+  int                  nr_assigned; // lasting writes to the environment
+  inline table_memo_rep (hashmap<string,tree> env2, tree fm2):
+    env (env2), fm (fm2), cells (tree ()), boxes (box ()),
+    next_cells (tree ()), next_boxes (box ()), nr_assigned (0) {}
+};
+
+static hashmap<path,pointer> table_memos (NULL);
+static int table_depth= 0;
+
+static bool
+is_plain_cell (tree t) {
+  if (is_atomic (t)) return true;
+  if (!is_func (t, CELL) && !is_func (t, CONCAT) && !is_func (t, DOCUMENT))
+    return false;
+  for (int i=0; i<N(t); i++)
+    if (!is_plain_cell (t[i])) return false;
+  return true;
+}
+
+static int
+table_size (tree t) {
+  int i, n= 0;
+  for (i=0; i<N(t); i++)
+    if (!is_atomic (t[i])) n += N(t[i]);
+  return n;
+}
+
+static table_memo_rep*
+table_memo_get (edit_env env, path ip, tree fm, tree t) {
+  // only memorize outermost tables, whose memos may not be evicted
+  // during the typesetting of nested tables
+  if (table_depth > 0 || table_size (t) < TABLE_MEMO_CELLS) return NULL;
+  table_memo_rep* memo= (table_memo_rep*) table_memos[ip];
+  if (memo != NULL) {
+    if (memo->fm == fm && env->same_env (memo->env))
+      return memo;
+    tm_delete (memo);
+    table_memos->reset (ip);
+  }
+  if (N(table_memos) >= TABLE_MEMO_MAX) {
+    iterator<path> it= iterate (table_memos);
+    while (it->busy ()) tm_delete ((table_memo_rep*) table_memos[it->next ()]);
+    table_memos= hashmap<path,pointer> (NULL);
+  }
+  hashmap<string,tree> h;
+  env->read_env (h);
+  memo= tm_new<table_memo_rep> (h, copy (fm));
+  table_memos (ip)= (pointer) memo;
+  return memo;
+}
+
+static box
+table_memo_lookup (table_memo_rep* memo, path ip, tree fm, tree t) {
+  if (!memo->cells->contains (ip)) return box ();
+  tree old= memo->cells[ip];
+  if (old[0] != fm || old[1] != t) return box ();
+  return memo->boxes[ip];
+}
+
+static void
+table_memo_store (table_memo_rep* memo, path ip, tree fm, tree t, box b) {
+  if (is_nil (b) || !is_plain_cell (t)) return;
+  memo->next_cells (ip)= tree (TUPLE, copy (fm), copy (t));
+  memo->next_boxes (ip)= b;
+}
+
+static void
+table_memo_done (table_memo_rep* memo) {
+  memo->cells= memo->next_cells;
+  memo->boxes= memo->next_boxes;
+  memo->next_cells= hashmap<path,tree> (tree ());
+  memo->next_boxes= hashmap<path,box> (box ());
+}
+
 /******************************************************************************
 * Tables
 ******************************************************************************/
@@ -23,7 +121,7 @@ lazy make_lazy_paragraph (edit_env env, array<box> bs, path ip);
 table_rep::table_rep (edit_env env2, int status2, int i0b, int j0b):
   var (""), env (env2), status (status2), i0 (i0b), j0 (j0b),
   T (NULL), nr_rows (0), mw (NULL), lw (NULL), rw (NULL),
-  width (0), height (0) {}
+  width (0), height (0), memo (NULL) {}
 
 table_rep::~table_rep () {
   if (T != NULL) {
@@ -70,17 +168,22 @@ table_rep::display (bool flag) {
 void
 table_rep::typeset (tree t, path iq) {
   ip= iq;
-  tree old_format= env->local_begin (CELL_FORMAT, tree (TFORMAT));
-  tree new_format= old_format;
+  tree new_format= env->read (CELL_FORMAT);
   if (!is_func (new_format, TFORMAT)) new_format= tree (TFORMAT);
   while (is_func (t, TFORMAT)) {
     new_format= new_format * t (0, N(t)-1);
     iq        = descend (iq, N(t)-1);
     t         = t[N(t)-1];
   }
+  if (status == 0) memo= table_memo_get (env, ip, new_format, t);
+  if (memo != NULL) memo->nr_assigned= env->nr_assigned;
+  tree old_format= env->local_begin (CELL_FORMAT, tree (TFORMAT));
   format_table (new_format);
+  table_depth++;
   typeset_table (new_format, t, iq);
+  table_depth--;
   env->local_end (CELL_FORMAT, old_format);
+  if (memo != NULL) table_memo_done (memo);
 }
 
 void
@@ -117,7 +220,11 @@ table_rep::typeset_row (int i, tree fm, tree t, path ip) {
     if (i == 0) C->border_flags += 1;
     if (i == nr_rows-1) C->border_flags += 2;
     tree old= env->local_begin (CELL_COL_NR, as_string (j));
+    if (memo != NULL && env->nr_assigned == memo->nr_assigned)
+      C->prev= table_memo_lookup (memo, descend (ip, j), subformat[j], t[j]);
     C->typeset (subformat[j], t[j], descend (ip, j));
+    if (memo != NULL)
+      table_memo_store (memo, descend (ip, j), subformat[j], t[j], C->content);
     env->local_end (CELL_COL_NR, old);
     C->row_span= min (C->row_span, nr_rows- i);
     C->col_span= min (C->col_span, nr_cols- j);
@@ -19,6 +19,7 @@
 
 class cell;
 class table;
+struct table_memo_rep;
 
 class table_rep: public concrete_struct {
 protected:
@@ -60,6 +61,7 @@ public:
   string   hyphen;            // vertical hypenation
   int      row_origin;        // row span (not yet implemented)
   int      col_origin;        // column span (not yet implemented)
+  table_memo_rep* memo;       // previous typesetting of the same table
 
   table_rep (edit_env env, int status, int i0, int j0);
   ~table_rep ();
@@ -104,6 +106,8 @@ public:
   path     ip;                // source location of cell
   lazy     lz;                // lazily typesetted cell
   box      b;                 // the resulting box
+  box      prev;              // reusable contents from a previous typesetting
+  box      content;           // the typeset contents before corrections
   SI       xoff;              // xoffset after positioning of the columns
   SI       yoff;              // yoffset after positioning of the rows
   SI       x1;                // lower left coordinate of cell
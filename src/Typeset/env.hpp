@@ -151,6 +151,7 @@ public:
   hashmap<string,tree>         missing;     // missing refs
   array<tree>                  redefined;   // redefined labels
   hashmap<string,bool>         touched;     // touched refs
+  int                          nr_assigned; // number of lasting writes
   link_repository              link_env;    // current links
   array<array<int> >           size_cache;  // math font size cache
 
@@ -424,9 +425,9 @@ public:
   tree   expand_morph (tree t);
 
   inline void monitored_write (string s, tree t) {
-    back->write_back (s, env); env (s)= t; }
+    back->write_back (s, env); env (s)= t; nr_assigned++; }
   inline void monitored_write_update (string s, tree t) {
-    back->write_back (s, env); env (s)= t; update (s); }
+    back->write_back (s, env); env (s)= t; nr_assigned++; update (s); }
   inline void write (string s, tree t) { env (s)= t; }
   inline void write_update (string s, tree t) { env (s)= t; update (s); }
   inline tree local_begin (string s, tree t) {
@@ -439,8 +440,8 @@ public:
   inline void local_end_script (tree t) {
     local_end (MATH_LEVEL, t); }
   inline void assign (string s, tree t) {
-    tree& val= env (s); t= exec(t); if (val != t) {
-      back->write_back (s, env); val= t; update (s); } }
+    t= exec(t); tree& val= env (s); if (val != t) {
+      back->write_back (s, env); val= t; nr_assigned++; update (s); } }
   inline bool provides (string s) { return env->contains (s); }
   inline tree read (string s) { return env [s]; }
   tree local_begin_extents (box b);
@@ -451,6 +452,7 @@ public:
   void monitored_patch_env (hashmap<string,tree> patch);
   void patch_env (hashmap<string,tree> patch);
   void read_env (hashmap<string,tree>& ret);
+  bool same_env (hashmap<string,tree> h);
   void local_start (hashmap<string,tree>& prev_back);
   void local_update (hashmap<string,tree>& oldpat, hashmap<string,tree>& chg);
   void local_end (hashmap<string,tree>& prev_back);
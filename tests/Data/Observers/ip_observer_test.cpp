@@ -0,0 +1,42 @@
+
+/******************************************************************************
+* MODULE     : ip_observer_test.cpp
+* DESCRIPTION: Comparing positions of trees in the meta-tree
+* COPYRIGHT  : (C) 2026  the TeXmacs team
+*******************************************************************************
+* This software falls under the GNU general public license version 3 or later.
+* It comes WITHOUT ANY WARRANTY WHATSOEVER. For details, see the file LICENSE
+* in the root directory or <http://www.gnu.org/licenses/gpl-3.0.html>.
+******************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include "modification.hpp"
+
+extern tree the_et;
+
+TEST (ip_observer, order) {
+  tree old= the_et;
+  the_et= tree (DOCUMENT, tree (CONCAT, "a", "b"), tree (CONCAT, "c"), "d");
+  attach_ip (the_et, path ());
+  EXPECT_TRUE  (tree_precedes (the_et[0][1], the_et[1][0]));
+  EXPECT_FALSE (tree_precedes (the_et[1][0], the_et[0][1]));
+  EXPECT_FALSE (tree_precedes (the_et[0], the_et[0][1]));
+  EXPECT_TRUE  (tree_inside (the_et[0][1], the_et[0]));
+  EXPECT_FALSE (tree_inside (the_et[1][0], the_et[0]));
+
+  tree removed= the_et[0], child= removed[1];
+  remove (path (0), 1);
+  EXPECT_FALSE (tree_attached (removed));
+  EXPECT_FALSE (tree_attached (child));
+  EXPECT_FALSE (tree_inside (child, removed));
+
+  insert (path (1), tree (DOCUMENT, "e"));
+  EXPECT_TRUE (tree_precedes (the_et[0][0], the_et[1]));
+  EXPECT_TRUE (tree_precedes (the_et[1], the_et[2]));
+
+  tree last= the_et[2];
+  detach_ip (the_et[2]);
+  EXPECT_FALSE (tree_attached (last));
+  the_et= old;
+}
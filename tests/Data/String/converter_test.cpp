@@ -0,0 +1,146 @@
+
+/******************************************************************************
+* MODULE     : converter_test.cpp
+* DESCRIPTION: Dictionaries compiled into double-array tries
+* COPYRIGHT  : (C) 2026  the TeXmacs team
+*******************************************************************************
+* This software falls under the GNU general public license version 3 or later.
+* It comes WITHOUT ANY WARRANTY WHATSOEVER. For details, see the file LICENSE
+* in the root directory or <http://www.gnu.org/licenses/gpl-3.0.html>.
+******************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include "converter.hpp"
+
+static converter
+test_converter (string name, array<string> keys, array<string> vals) {
+  // converters without dictionaries, whose trie is compiled from the keys
+  converter c= load_converter ("Test", name);
+  for (int i=0; i<N(keys); i++)
+    put_prefix_code (keys[i], vals[i], c->ht);
+  c->compile ();
+  return c;
+}
+
+static string
+naive_apply (array<string> keys, array<string> vals, string s) {
+  // longest match by trying all keys; later keys override earlier ones
+  string r;
+  int i= 0;
+  while (i < N(s)) {
+    int best= -1;
+    for (int k=0; k<N(keys); k++)
+      if (i + N(keys[k]) <= N(s) && s (i, i + N(keys[k])) == keys[k])
+        if (best < 0 || N(keys[k]) >= N(keys[best])) best= k;
+    if (best < 0) r << s[i++];
+    else {
+      r << vals[best];
+      i += N(keys[best]);
+    }
+  }
+  return r;
+}
+
+static string
+random_string (int n, string alphabet, unsigned int& seed) {
+  string s (n);
+  for (int i=0; i<n; i++) {
+    seed= seed * 1103515245 + 12345;
+    s[i]= alphabet[(int) ((seed >> 16) % N(alphabet))];
+  }
+  return s;
+}
+
+static array<string>
+strings (const char* s1, const char* s2, const char* s3, const char* s4) {
+  array<string> a;
+  a << string (s1) << string (s2) << string (s3) << string (s4);
+  return a;
+}
+
+TEST (converter, longest_match) {
+  converter c= test_converter ("longest", strings ("a", "ab", "abc", "b"),
+                               strings ("1", "2", "3", "4"));
+  EXPECT_EQ (apply (c, "abcabx"), string ("32x"));
+  EXPECT_EQ (apply (c, "aab"), string ("12"));
+  EXPECT_EQ (apply (c, "ba"), string ("41"));
+  EXPECT_EQ (apply (c, ""), string (""));
+}
+
+TEST (converter, pass) {
+  converter c= test_converter ("pass", strings ("\\alpha", "\\beta", "{", "}"),
+                               strings ("A", "B", "", "'"));
+  EXPECT_TRUE  (c->passes ('x'));
+  EXPECT_TRUE  (c->passes ('a'));
+  EXPECT_FALSE (c->passes ('\\'));
+  EXPECT_FALSE (c->passes ('}'));
+  // keys without a value are not matched
+  EXPECT_EQ (apply (c, "x\\alpha{y}\\gamma"), string ("xA{y'\\gamma"));
+}
+
+TEST (converter, drop_unmatched) {
+  converter c= load_converter ("Test", "drop");
+  c->copy_unmatched= false;
+  put_prefix_code ("ab", "X", c->ht);
+  c->compile ();
+  EXPECT_FALSE (c->passes ('c'));
+  EXPECT_EQ (apply (c, "cabdab"), string ("XX"));
+}
+
+TEST (converter, binary) {
+  converter c= test_converter ("binary",
+                               strings ("\xc3\xa9", "\xc3", "\xff\xfe", "x"),
+                               strings ("e'", "?", "BOM", "y"));
+  put_prefix_code (string ("\0", 1), "NUL", c->ht);
+  c->compile ();
+  EXPECT_EQ (apply (c, string ("\xc3\xa9\xc3\0\xff\xfe\xff", 7)),
+             string ("e'?NULBOM\xff"));
+}
+
+TEST (converter, serialize) {
+  array<string> keys= strings ("a", "ab", "abc", "\xc3\xa9");
+  array<string> vals= strings ("1", "2", "3", "e'");
+  converter c= test_converter ("serialize", keys, vals);
+  string s= c->serialize ();
+  converter d= load_converter ("Test", "unserialize");
+  ASSERT_TRUE (d->unserialize (s));
+  EXPECT_FALSE (d->passes ('a'));
+  EXPECT_TRUE  (d->passes ('b'));
+  unsigned int seed= 1;
+  for (int k=0; k<20; k++) {
+    string t= random_string (k * 3, "abc\xc3\xa9", seed);
+    EXPECT_EQ (apply (d, t), apply (c, t));
+  }
+}
+
+TEST (converter, unserialize_corrupt) {
+  converter c= test_converter ("corrupt", strings ("a", "ab", "abc", "b"),
+                               strings ("1", "2", "3", "4"));
+  string s= c->serialize ();
+  converter d= load_converter ("Test", "corrupt-copy");
+  EXPECT_FALSE (d->unserialize (""));
+  EXPECT_FALSE (d->unserialize (s (0, N(s) - 1)));
+  EXPECT_FALSE (d->unserialize (s * "x"));
+  // a state whose value is beyond the table of values
+  string t= copy (s);
+  t[12]= (char) 100; t[13]= t[14]= t[15]= '\0';
+  EXPECT_FALSE (d->unserialize (t));
+  EXPECT_TRUE  (d->unserialize (s));
+}
+
+TEST (converter, against_naive) {
+  unsigned int seed= 7;
+  for (int round=0; round<20; round++) {
+    array<string> keys, vals;
+    for (int k=0; k<5 + round; k++) {
+      keys << random_string (1 + k % 4, string ("ab\xc3\0", 4), seed);
+      vals << ("<" * as_string (k) * ">");
+    }
+    converter c= test_converter ("random-" * as_string (round), keys, vals);
+    for (int k=0; k<10; k++) {
+      string s= random_string (k * 7, string ("abc\xc3\0", 5), seed);
+      EXPECT_EQ (apply (c, s), naive_apply (keys, vals, s));
+    }
+  }
+}
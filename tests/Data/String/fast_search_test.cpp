@@ -0,0 +1,137 @@
+
+/******************************************************************************
+* MODULE     : fast_search_test.cpp
+* DESCRIPTION: Fast multiple searches in same string
+* COPYRIGHT  : (C) 2026  the TeXmacs team
+*******************************************************************************
+* This software falls under the GNU general public license version 3 or later.
+* It comes WITHOUT ANY WARRANTY WHATSOEVER. For details, see the file LICENSE
+* in the root directory or <http://www.gnu.org/licenses/gpl-3.0.html>.
+******************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include "fast_search.hpp"
+
+TEST (string_searcher, search_all) {
+  string_searcher ss ("abracadabra");
+  array<int> a= ss->search_all ("abra");
+  ASSERT_EQ (N(a), 2);
+  EXPECT_EQ (a[0], 0);
+  EXPECT_EQ (a[1], 7);
+  EXPECT_EQ (N(ss->search_all ("a")), 5);
+  EXPECT_EQ (N(ss->search_all ("abrax")), 0);
+  EXPECT_EQ (N(ss->search_all ("")), 12);
+}
+
+TEST (string_searcher, search_next) {
+  string_searcher ss ("abracadabra");
+  EXPECT_EQ (ss->search_next ("a", 0), 0);
+  EXPECT_EQ (ss->search_next ("a", 1), 3);
+  EXPECT_EQ (ss->search_next ("abra", 1), 7);
+  EXPECT_EQ (ss->search_next ("abra", 8), -1);
+  EXPECT_EQ (ss->search_next ("cad", 0), 4);
+}
+
+TEST (string_searcher, get_longest_common) {
+  int b1, e1, b2, e2;
+  get_longest_common ("xabcdy", "zzabcdzz", b1, e1, b2, e2);
+  EXPECT_EQ (b1, 1);
+  EXPECT_EQ (e1, 5);
+  EXPECT_EQ (b2, 2);
+  EXPECT_EQ (e2, 6);
+  get_longest_common ("abab", "ab", b1, e1, b2, e2);
+  EXPECT_EQ (b1, 0);
+  EXPECT_EQ (e1, 2);
+  get_longest_common ("abc", "xyz", b1, e1, b2, e2);
+  EXPECT_EQ (e1 - b1, 0);
+}
+
+static array<int>
+naive_search_all (string s, string what) {
+  array<int> r;
+  for (int i=0; i+N(what) <= N(s); i++)
+    if (s (i, i+N(what)) == what) r << i;
+  return r;
+}
+
+static string
+random_string (int n, int k, unsigned int& seed) {
+  // pseudo-random string over the first k characters of the alphabet,
+  // which includes a null byte and a byte with the high bit set
+  string alphabet ("a\0\xff" "b", 4);
+  string s (n);
+  for (int i=0; i<n; i++) {
+    seed= seed * 1103515245 + 12345;
+    s[i]= alphabet[(int) ((seed >> 16) % k)];
+  }
+  return s;
+}
+
+TEST (string_searcher, periodic) {
+  // suffixes of periodic strings share long common prefixes
+  string_searcher ss ("aaaaaaaa");
+  EXPECT_EQ (N(ss->search_all ("a")), 8);
+  EXPECT_EQ (N(ss->search_all ("aaa")), 6);
+  EXPECT_EQ (N(ss->search_all ("aaaaaaaa")), 1);
+  EXPECT_EQ (N(ss->search_all ("aaaaaaaaa")), 0);
+  EXPECT_EQ (ss->search_next ("aaa", 5), 5);
+  EXPECT_EQ (ss->search_next ("aaa", 6), -1);
+  string_searcher ab ("abababab");
+  array<int> a= ab->search_all ("bab");
+  ASSERT_EQ (N(a), 3);
+  EXPECT_EQ (a[0], 1);
+  EXPECT_EQ (a[2], 5);
+}
+
+TEST (string_searcher, boundaries) {
+  string_searcher ss ("abc");
+  EXPECT_EQ (ss->search_next ("c", 2), 2);
+  EXPECT_EQ (ss->search_next ("c", 3), -1);
+  EXPECT_EQ (ss->search_next ("", 3), 3);
+  EXPECT_EQ (ss->search_next ("abcd", 0), -1);
+  EXPECT_EQ (ss->search_next ("b", -5), 1);
+  string_searcher empty ("");
+  EXPECT_EQ (N(empty->search_all ("a")), 0);
+  EXPECT_EQ (empty->search_next ("", 0), 0);
+}
+
+TEST (string_searcher, binary) {
+  string s ("a\0b\xff" "a\0\xff", 7);
+  string_searcher ss (s);
+  array<int> a= ss->search_all (string ("a\0", 2));
+  ASSERT_EQ (N(a), 2);
+  EXPECT_EQ (a[0], 0);
+  EXPECT_EQ (a[1], 4);
+  EXPECT_EQ (ss->search_next (string ("\xff"), 4), 6);
+  EXPECT_EQ (ss->search_next (string ("\0\xff", 2), 0), 5);
+}
+
+TEST (string_searcher, repeated_queries) {
+  // the hits of the last query are remembered
+  string_searcher ss ("abracadabra");
+  EXPECT_EQ (ss->search_next ("abra", 0), 0);
+  EXPECT_EQ (ss->search_next ("abra", 1), 7);
+  EXPECT_EQ (ss->search_next ("cad", 0), 4);
+  EXPECT_EQ (ss->search_next ("abra", 1), 7);
+  EXPECT_EQ (ss->get_string (), string ("abracadabra"));
+}
+
+TEST (string_searcher, against_naive) {
+  unsigned int seed= 1;
+  for (int k=1; k<=4; k++)
+    for (int n=0; n<200; n += 17) {
+      string s= random_string (n, k, seed);
+      string_searcher ss (s);
+      for (int t=0; t<20; t++) {
+        string what= random_string (1 + t % 5, k, seed);
+        array<int> a= naive_search_all (s, what);
+        EXPECT_EQ (ss->search_all (what), a);
+        int pos= (n == 0? 0: (int) (seed % (unsigned int) n));
+        int next= -1;
+        for (int i=0; i<N(a) && next < 0; i++)
+          if (a[i] >= pos) next= a[i];
+        EXPECT_EQ (ss->search_next (what, pos), next);
+      }
+    }
+}
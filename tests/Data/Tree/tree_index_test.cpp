@@ -0,0 +1,139 @@
+
+/******************************************************************************
+* MODULE     : tree_index_test.cpp
+* DESCRIPTION: Incrementally maintained n-gram indices of documents
+* COPYRIGHT  : (C) 2026  the TeXmacs team
+*******************************************************************************
+* This software falls under the GNU general public license version 3 or later.
+* It comes WITHOUT ANY WARRANTY WHATSOEVER. For details, see the file LICENSE
+* in the root directory or <http://www.gnu.org/licenses/gpl-3.0.html>.
+******************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include "tree_index.hpp"
+#include "analyze.hpp"
+
+extern tree the_et;
+
+static tree
+numbered_document (int n) {
+  // paragraphs "paragraph i", where every fifth one also mentions a zebra
+  tree doc (DOCUMENT);
+  for (int i=0; i<n; i++) {
+    string s= "paragraph " * as_string (i);
+    if (i % 5 == 0) s << " with a Zebra";
+    doc << tree (s);
+  }
+  return doc;
+}
+
+static array<int>
+candidates (string what) {
+  // the paragraphs of the indexed document which may contain what
+  array<bool> cand;
+  array<int> r;
+  if (!search_index_candidates (the_et[0], what, cand)) r << -1;
+  else
+    for (int i=0; i<N(cand); i++)
+      if (cand[i]) r << i;
+  return r;
+}
+
+static array<int>
+occurrences (string what) {
+  // the paragraphs of the indexed document which do contain what
+  array<int> r;
+  tree doc= the_et[0];
+  string w= locase_all (what);
+  for (int i=0; i<N(doc); i++)
+    if (is_atomic (doc[i]) && occurs (w, locase_all (doc[i]->label)))
+      r << i;
+  return r;
+}
+
+TEST (tree_index, candidates) {
+  tree old= the_et;
+  the_et= tree (DOCUMENT, numbered_document (20));
+  attach_ip (the_et, path ());
+  array<int> a= candidates ("zebra");
+  ASSERT_EQ (N(a), 4);
+  EXPECT_EQ (a[0], 0);
+  EXPECT_EQ (a[3], 15);
+  EXPECT_EQ (candidates ("ZEBRA"), a);
+  EXPECT_EQ (candidates ("zeb"), a);
+  EXPECT_EQ (candidates ("graph 1"), occurrences ("graph 1"));
+  EXPECT_EQ (N(candidates ("giraffe")), 0);
+  the_et= old;
+}
+
+TEST (tree_index, not_indexed) {
+  tree old= the_et;
+  the_et= tree (DOCUMENT, numbered_document (20));
+  attach_ip (the_et, path ());
+  array<bool> cand;
+  EXPECT_FALSE (search_index_candidates (the_et[0], "ze", cand));
+  EXPECT_FALSE (search_index_candidates (the_et[0][5], "zebra", cand));
+  tree detached= numbered_document (20);
+  EXPECT_FALSE (search_index_candidates (detached, "zebra", cand));
+  the_et= old;
+}
+
+TEST (tree_index, assign) {
+  tree old= the_et;
+  the_et= tree (DOCUMENT, numbered_document (20));
+  attach_ip (the_et, path ());
+  EXPECT_EQ (N(candidates ("zebra")), 4);
+  assign (path (0, 3), tree ("a zebra crossing"));
+  assign (path (0, 5), tree ("no stripes"));
+  EXPECT_EQ (candidates ("zebra"), occurrences ("zebra"));
+  EXPECT_EQ (candidates ("stripes"), occurrences ("stripes"));
+  the_et= old;
+}
+
+TEST (tree_index, insert_remove) {
+  tree old= the_et;
+  the_et= tree (DOCUMENT, numbered_document (20));
+  attach_ip (the_et, path ());
+  EXPECT_EQ (N(candidates ("zebra")), 4);
+  insert (path (0, 2), tree (DOCUMENT, "zebra one", "zebra two"));
+  EXPECT_EQ (candidates ("zebra"), occurrences ("zebra"));
+  remove (path (0, 0), 3);
+  EXPECT_EQ (candidates ("zebra"), occurrences ("zebra"));
+  EXPECT_EQ (candidates ("graph 1"), occurrences ("graph 1"));
+  the_et= old;
+}
+
+TEST (tree_index, split_join) {
+  tree old= the_et;
+  the_et= tree (DOCUMENT, numbered_document (20));
+  attach_ip (the_et, path ());
+  EXPECT_EQ (N(candidates ("zebra")), 4);
+  // "paragraph 10 with a Zebra" becomes "paragraph 10 w" and "ith a Zebra"
+  split (path (0, 10, 14));
+  EXPECT_EQ (candidates ("zebra"), occurrences ("zebra"));
+  EXPECT_EQ (candidates ("ith a"), occurrences ("ith a"));
+  join (path (0, 10));
+  EXPECT_EQ (candidates ("zebra"), occurrences ("zebra"));
+  EXPECT_EQ (candidates ("with a"), occurrences ("with a"));
+  the_et= old;
+}
+
+TEST (tree_index, many_edits) {
+  // retired paragraphs are eventually dropped from the postings
+  tree old= the_et;
+  the_et= tree (DOCUMENT, numbered_document (20));
+  attach_ip (the_et, path ());
+  for (int k=0; k<500; k++) {
+    int i= k % 20;
+    string s= "edit " * as_string (k);
+    if (k % 7 == 0) s << " zebra";
+    assign (path (0, i), tree (s));
+    if (k % 50 == 0)
+      EXPECT_EQ (candidates ("zebra"), occurrences ("zebra"));
+  }
+  EXPECT_EQ (candidates ("zebra"), occurrences ("zebra"));
+  EXPECT_EQ (candidates ("edit 49"), occurrences ("edit 49"));
+  EXPECT_EQ (candidates (" 49"), occurrences (" 49"));
+  the_et= old;
+}
@@ -0,0 +1,122 @@
+
+/******************************************************************************
+* MODULE     : thread_pool_test.cpp
+* DESCRIPTION: Work-stealing pool of worker threads with futures
+* COPYRIGHT  : (C) 2026  the TeXmacs team
+*******************************************************************************
+* This software falls under the GNU general public license version 3 or later.
+* It comes WITHOUT ANY WARRANTY WHATSOEVER. For details, see the file LICENSE
+* in the root directory or <http://www.gnu.org/licenses/gpl-3.0.html>.
+******************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include "thread_pool.hpp"
+#include "array.hpp"
+
+static int
+fib (int n) {
+  // nested futures: workers wait for the subtasks they spawned
+  if (n < 10) return n < 2? n: fib (n-1) + fib (n-2);
+  promise<int> a= spawn<int> ([n] () { return fib (n-1); });
+  int b= fib (n-2);
+  return a () + b;
+}
+
+static int
+tree_weight (tree t) {
+  if (is_atomic (t)) return N(t->label);
+  int w= 1;
+  for (int i=0; i<N(t); i++) w += tree_weight (t[i]);
+  return w;
+}
+
+static int posted= 0;
+static void post_routine () { posted++; }
+
+static int destroyed= 0;
+struct probe_command_rep: public command_rep {
+  ~probe_command_rep () { destroyed++; }
+  void apply () {}
+};
+
+class thread_pool_test: public ::testing::Test {
+protected:
+  void SetUp () { thread_pool_start (4); }
+  void TearDown () { thread_pool_stop (); }
+};
+
+TEST_F (thread_pool_test, futures) {
+  array<promise<int> > a;
+  for (int i=0; i<2000; i++)
+    a << spawn<int> ([i] () { return i * i; });
+  long sum= 0;
+  for (int i=0; i<N(a); i++) sum += a[i] ();
+  EXPECT_EQ (sum, 1999L * 2000L * 3999L / 6L);
+}
+
+TEST_F (thread_pool_test, nested) {
+  EXPECT_EQ (fib (22), 17711);
+}
+
+TEST_F (thread_pool_test, shared_trees) {
+  // trees are shared and copied concurrently by many tasks
+  tree t (DOCUMENT);
+  for (int i=0; i<50; i++)
+    t << tree (CONCAT, as_string (i), tree (WITH, "color", "red", "x"));
+  int expected= tree_weight (t);
+  array<promise<int> > a;
+  for (int i=0; i<500; i++)
+    a << spawn<int> ([t] () {
+        tree u= t;
+        array<tree> copies;
+        for (int j=0; j<N(u); j++) copies << u[j];
+        return tree_weight (u); });
+  for (int i=0; i<N(a); i++) EXPECT_EQ (a[i] (), expected);
+  EXPECT_EQ (tree_weight (t), expected);
+}
+
+TEST_F (thread_pool_test, shared_commands) {
+  // reference counts remain exact under concurrent copies
+  destroyed= 0;
+  {
+    command cmd= tm_new<probe_command_rep> ();
+    array<promise<int> > a;
+    for (int i=0; i<500; i++)
+      a << spawn<int> ([cmd] () {
+          array<command> copies;
+          for (int j=0; j<200; j++) copies << cmd;
+          return N(copies); });
+    for (int i=0; i<N(a); i++) EXPECT_EQ (a[i] (), 200);
+    thread_pool_stop ();
+    EXPECT_EQ (destroyed, 0);
+  }
+  EXPECT_EQ (destroyed, 1);
+}
+
+TEST_F (thread_pool_test, post) {
+  // commands posted by the tasks are executed by the main thread
+  posted= 0;
+  array<promise<int> > a;
+  for (int i=0; i<1000; i++)
+    a << spawn<int> ([i] () {
+        main_thread_post (command (post_routine));
+        return i; });
+  for (int i=0; i<N(a); i++) (void) a[i] ();
+  EXPECT_EQ (main_thread_dispatch (), 1000);
+  EXPECT_EQ (posted, 1000);
+  EXPECT_EQ (main_thread_dispatch (), 0);
+}
+
+TEST_F (thread_pool_test, stop) {
+  // pending tasks are completed when the pool is stopped
+  array<promise<int> > a;
+  for (int i=0; i<1000; i++)
+    a << spawn<int> ([i] () { return i; });
+  thread_pool_stop ();
+  EXPECT_EQ (thread_pool_size (), 0);
+  for (int i=0; i<N(a); i++) {
+    EXPECT_TRUE (is_ready (a[i]));
+    EXPECT_EQ (a[i] (), i);
+  }
+}
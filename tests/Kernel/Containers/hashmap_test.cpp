@@ -9,6 +9,7 @@
 ******************************************************************************/
 #include "gtest/gtest.h"
 #include "hashmap.hpp"
+#include "iterator.hpp"
 
 /******************************************************************************
 * tests on resize
@@ -232,3 +233,57 @@ TEST (hashmap, N) {
   non_empty_hm(1) = nullptr;
   EXPECT_EQ (N(non_empty_hm) == 1, true);
 }
+
+/******************************************************************************
+* tests on many entries
+******************************************************************************/
+TEST (hashmap, many) {
+  auto hm = hashmap<int, int>(-1);
+  for (int i=0; i<10000; i++) hm(i * 16) = i;
+  for (int i=0; i<10000; i+=2) hm->reset(i * 16);
+  EXPECT_EQ (N(hm), 5000);
+  for (int i=0; i<10000; i++)
+    EXPECT_EQ (hm[i * 16], i % 2 == 0? -1: i);
+  for (int i=1; i<10000; i+=2) hm->reset(i * 16);
+  EXPECT_EQ (hm->empty(), true);
+}
+
+TEST (hashmap, iterate) {
+  auto hm = hashmap<int, int>(0);
+  for (int i=0; i<100; i++) hm(i) = i;
+  int sum= 0;
+  iterator<int> it= iterate (hm);
+  while (it->busy()) {
+    int i= it->next();
+    sum += hm[i];
+    hm->reset(i);
+  }
+  EXPECT_EQ (sum, 4950);
+  EXPECT_EQ (N(hm), 0);
+}
+
+TEST (hashmap, iterate_grow) {
+  // a resize while iterating neither repeats nor loses the initial keys
+  auto hm = hashmap<int, int>(0);
+  for (int i=0; i<8; i++) hm(i) = 1;
+  int count= 0;
+  iterator<int> it= iterate (hm);
+  while (it->busy()) {
+    int i= it->next();
+    if (i < 8) count += hm[i];
+    if (i == 3) for (int j=100; j<200; j++) hm(j) = 0;
+  }
+  EXPECT_EQ (count, 8);
+}
+
+TEST (hashmap, iterate_early_stop) {
+  auto hm = hashmap<int, int>(0);
+  for (int i=0; i<1000; i++) hm(i) = i;
+  {
+    iterator<int> it= iterate (hm);
+    EXPECT_TRUE (it->busy());
+    (void) it->next();
+  }
+  hm->reset(5);
+  EXPECT_EQ (N(hm), 999);
+}
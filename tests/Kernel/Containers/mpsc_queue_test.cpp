@@ -0,0 +1,97 @@
+
+/******************************************************************************
+* MODULE     : mpsc_queue_test.cpp
+* DESCRIPTION: Lock-free queues with several producers and a single consumer
+* COPYRIGHT  : (C) 2026  the TeXmacs team
+*******************************************************************************
+* This software falls under the GNU general public license version 3 or later.
+* It comes WITHOUT ANY WARRANTY WHATSOEVER. For details, see the file LICENSE
+* in the root directory or <http://www.gnu.org/licenses/gpl-3.0.html>.
+******************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include "mpsc_queue.hpp"
+#include "command.hpp"
+#include <thread>
+#include <vector>
+
+TEST (mpsc_queue, fifo) {
+  mpsc_queue<int> q;
+  int x= -1;
+  EXPECT_TRUE (q.is_empty ());
+  EXPECT_FALSE (q.pop (x));
+  for (int i=0; i<100; i++) q.push (i);
+  EXPECT_FALSE (q.is_empty ());
+  for (int i=0; i<100; i++) {
+    ASSERT_TRUE (q.pop (x));
+    EXPECT_EQ (x, i);
+  }
+  EXPECT_FALSE (q.pop (x));
+}
+
+static int destroyed= 0;
+struct probe_command_rep: public command_rep {
+  ~probe_command_rep () { destroyed++; }
+  void apply () {}
+};
+
+TEST (mpsc_queue, release) {
+  destroyed= 0;
+  {
+    command cmd= tm_new<probe_command_rep> ();
+    mpsc_queue<command> q;
+    for (int i=0; i<10; i++) q.push (cmd);
+    command c;
+    EXPECT_TRUE (q.pop (c));
+    EXPECT_TRUE (c == cmd);
+  }
+  EXPECT_EQ (destroyed, 1);
+}
+
+#ifdef USE_ATOMIC_REFCOUNT
+TEST (mpsc_queue, producers) {
+  // items of each producer must arrive exactly once and in order
+  const int P= 4, M= 50000;
+  mpsc_queue<int> q;
+  std::vector<std::thread> producers;
+  for (int p=0; p<P; p++)
+    producers.push_back (std::thread ([&q, p] () {
+          for (int i=0; i<M; i++) q.push (p * M + i); }));
+  std::vector<int> last (P, -1);
+  int received= 0, x;
+  while (received < P * M) {
+    if (!q.pop (x)) { std::this_thread::yield (); continue; }
+    int p= x / M, i= x % M;
+    ASSERT_EQ (i, last[p] + 1);
+    last[p]= i;
+    received++;
+  }
+  for (int p=0; p<P; p++) producers[p].join ();
+  EXPECT_FALSE (q.pop (x));
+}
+
+TEST (mpsc_queue, shared) {
+  // a command pushed from several threads is released exactly once
+  const int P= 4, M= 20000;
+  destroyed= 0;
+  {
+    command cmd= tm_new<probe_command_rep> ();
+    mpsc_queue<command> q;
+    std::vector<std::thread> producers;
+    for (int p=0; p<P; p++)
+      producers.push_back (std::thread ([&q, cmd] () {
+            for (int i=0; i<M; i++) q.push (cmd); }));
+    int received= 0;
+    command c;
+    while (received < P * M)
+      if (q.pop (c)) {
+        ASSERT_TRUE (c == cmd);
+        received++;
+      }
+    for (int p=0; p<P; p++) producers[p].join ();
+    EXPECT_EQ (destroyed, 0);
+  }
+  EXPECT_EQ (destroyed, 1);
+}
+#endif
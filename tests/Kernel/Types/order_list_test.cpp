@@ -0,0 +1,49 @@
+
+/******************************************************************************
+* MODULE     : order_list_test.cpp
+* DESCRIPTION: Order maintenance
+* COPYRIGHT  : (C) 2026  the TeXmacs team
+*******************************************************************************
+* This software falls under the GNU general public license version 3 or later.
+* It comes WITHOUT ANY WARRANTY WHATSOEVER. For details, see the file LICENSE
+* in the root directory or <http://www.gnu.org/licenses/gpl-3.0.html>.
+******************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include "order_list.hpp"
+#include "array.hpp"
+
+static bool
+increasing (order_item it) {
+  for (; it->next != NULL; it= it->next)
+    if (!order_less (it, it->next)) return false;
+  return true;
+}
+
+TEST (order_list, append) {
+  order_item it= order_first ();
+  array<order_item> a;
+  for (int i=0; i<10000; i++) a << (it= order_new (it));
+  EXPECT_TRUE (increasing (order_first ()));
+  EXPECT_TRUE (order_less (a[17], a[9000]));
+  for (int i=0; i<N(a); i++) order_delete (a[i]);
+}
+
+TEST (order_list, same_place) {
+  // always inserting at the same place forces relabelings
+  order_item first= order_new (NULL);
+  order_item last = order_new (first);
+  array<order_item> a;
+  for (int i=0; i<10000; i++) a << order_new (first);
+  EXPECT_TRUE (increasing (order_first ()));
+  EXPECT_TRUE (order_less (first, a[9999]));
+  EXPECT_TRUE (order_less (a[9999], a[0]));
+  EXPECT_TRUE (order_less (a[0], last));
+  for (int i=0; i<N(a); i+=2) order_delete (a[i]);
+  EXPECT_TRUE (increasing (order_first ()));
+  for (int i=1; i<N(a); i+=2) order_delete (a[i]);
+  order_delete (first);
+  order_delete (last);
+  EXPECT_TRUE (order_first ()->next == NULL);
+}
@@ -0,0 +1,73 @@
+
+/******************************************************************************
+* MODULE     : tree_test.cpp
+* DESCRIPTION: Hash-consing of immutable trees
+* COPYRIGHT  : (C) 2026  the TeXmacs team
+*******************************************************************************
+* This software falls under the GNU general public license version 3 or later.
+* It comes WITHOUT ANY WARRANTY WHATSOEVER. For details, see the file LICENSE
+* in the root directory or <http://www.gnu.org/licenses/gpl-3.0.html>.
+******************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include "tree.hpp"
+
+static tree
+sample_tree () {
+  return tree (DOCUMENT,
+               tree (CONCAT, "hello", tree (WITH, "color", "red", "world")),
+               tree (CONCAT, "hello", tree (WITH, "color", "red", "world")));
+}
+
+TEST (intern, sharing) {
+  tree t1= intern (sample_tree ());
+  tree t2= intern (sample_tree ());
+  EXPECT_TRUE (strong_equal (t1, t2));
+  EXPECT_TRUE (strong_equal (t1[0], t1[1]));
+  EXPECT_TRUE (t1 == sample_tree ());
+  EXPECT_TRUE (is_interned (t1));
+  EXPECT_TRUE (is_interned (t1[0][1][2]));
+  EXPECT_FALSE (is_interned (sample_tree ()));
+  EXPECT_EQ (interned_hash (t1), interned_hash (t2));
+}
+
+TEST (intern, distinct) {
+  tree t1= intern (tree (CONCAT, "a", "b"));
+  tree t2= intern (tree (CONCAT, "a", "c"));
+  tree t3= intern (tree (DOCUMENT, "a", "b"));
+  EXPECT_FALSE (strong_equal (t1, t2));
+  EXPECT_FALSE (strong_equal (t1, t3));
+  EXPECT_TRUE (strong_equal (t1[0], t2[0]));
+}
+
+TEST (intern, idempotent) {
+  tree t= intern (sample_tree ());
+  EXPECT_TRUE (strong_equal (intern (t), t));
+}
+
+TEST (intern, collect) {
+  for (int i=0; i<5000; i++)
+    (void) intern (tree (CONCAT, as_string (i), "x"));
+  tree t= intern (tree (CONCAT, "kept", "x"));
+  intern_collect ();
+  EXPECT_TRUE (is_interned (t));
+  EXPECT_TRUE (strong_equal (intern (tree (CONCAT, "kept", "x")), t));
+}
+
+TEST (intern, hash) {
+  tree t= intern (sample_tree ());
+  EXPECT_EQ (hash (t), hash (sample_tree ()));
+  EXPECT_EQ (hash (tree (TUPLE, t, "x")), hash (tree (TUPLE, sample_tree (), "x")));
+}
+
+TEST (intern, hash_modified) {
+  // trees which are not interned may change through their subtrees
+  tree t= sample_tree ();
+  int h= hash (t);
+  tree c= t[1][1];
+  c[2]= "moon";
+  EXPECT_NE (hash (t), h);
+  EXPECT_EQ (hash (t), hash (copy (t)));
+  EXPECT_EQ (hash (intern (t)), hash (t));
+}
@@ -0,0 +1,63 @@
+
+/******************************************************************************
+* MODULE     : ispell_test.cpp
+* DESCRIPTION: Spell checking using a local dictionary
+* COPYRIGHT  : (C) 2026  the TeXmacs team
+*******************************************************************************
+* This software falls under the GNU general public license version 3 or later.
+* It comes WITHOUT ANY WARRANTY WHATSOEVER. For details, see the file LICENSE
+* in the root directory or <http://www.gnu.org/licenses/gpl-3.0.html>.
+******************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include "Ispell/ispell.hpp"
+
+static void
+sample_dictionary (string lan) {
+  array<string> a;
+  a << string ("hello") << string ("world") << string ("help")
+    << string ("word") << string ("spell");
+  ispell_dictionary (lan, a);
+}
+
+TEST (ispell, check) {
+  sample_dictionary ("test-check");
+  EXPECT_EQ (ispell_start ("test-check"), string ("ok"));
+  EXPECT_TRUE (ispell_check ("test-check", "hello") == "ok");
+  EXPECT_TRUE (ispell_check ("test-check", "Hello") == "ok");
+  tree t= ispell_check ("test-check", "helo");
+  ASSERT_TRUE (is_tuple (t));
+  EXPECT_TRUE (t[0] == "2");
+  bool hello= false, help= false;
+  for (int i=1; i<N(t); i++) {
+    if (t[i] == "hello") hello= true;
+    if (t[i] == "help") help= true;
+  }
+  EXPECT_TRUE (hello && help);
+  t= ispell_check ("test-check", "xyzzy");
+  ASSERT_TRUE (is_tuple (t));
+  EXPECT_TRUE (t[0] == "0");
+}
+
+TEST (ispell, batch) {
+  sample_dictionary ("test-batch");
+  array<string> a;
+  for (int i=0; i<1000; i++)
+    a << string (i%2 == 0? "world": "wrold");
+  array<tree> r= ispell_check ("test-batch", a);
+  ASSERT_EQ (N(r), 1000);
+  for (int i=0; i<N(r); i++)
+    if (i%2 == 0) EXPECT_TRUE (r[i] == "ok");
+    else EXPECT_TRUE (is_tuple (r[i]) && r[i][0] == "1" && r[i][1] == "world");
+}
+
+TEST (ispell, accept_insert) {
+  sample_dictionary ("test-accept");
+  EXPECT_TRUE (ispell_check ("test-accept", "texmacs") != "ok");
+  ispell_accept ("test-accept", "texmacs");
+  EXPECT_TRUE (ispell_check ("test-accept", "texmacs") == "ok");
+  ispell_insert ("test-accept", "gnu");
+  EXPECT_TRUE (ispell_check ("test-accept", "gnu") == "ok");
+  ispell_done ("test-accept");
+}
@@ -0,0 +1,162 @@
+
+/******************************************************************************
+* MODULE     : image_files_test.cpp
+* DESCRIPTION: Image sizes from file headers and their persistent cache
+* COPYRIGHT  : (C) 2026  the TeXmacs team
+*******************************************************************************
+* This software falls under the GNU general public license version 3 or later.
+* It comes WITHOUT ANY WARRANTY WHATSOEVER. For details, see the file LICENSE
+* in the root directory or <http://www.gnu.org/licenses/gpl-3.0.html>.
+******************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include "image_files.hpp"
+#include "data_cache.hpp"
+#include "file.hpp"
+
+static string
+be32 (unsigned int x) {
+  string s (4);
+  for (int k=0; k<4; k++) s[k]= (char) ((x >> (24 - 8*k)) & 0xff);
+  return s;
+}
+
+static string
+png_chunk (string type, string data) {
+  // the checksums are not verified when reading the headers
+  return be32 (N(data)) * type * data * be32 (0);
+}
+
+static string
+png_file (int w, int h, int dpm, string extra= "") {
+  string ihdr= be32 (w) * be32 (h) * string ("\x08\x02\0\0\0", 5);
+  string phys= be32 (dpm) * be32 (dpm) * string ("\1", 1);
+  return string ("\x89PNG\r\n\x1a\n") *
+    png_chunk ("IHDR", ihdr) * extra *
+    png_chunk ("pHYs", phys) *
+    png_chunk ("IEND", "");
+}
+
+static url
+image_file (string name, string contents) {
+  url u= url_temp_dir () * url (name);
+  save_string (u, contents, false);
+  clear_imgbox_cache (u->t);
+  return u;
+}
+
+TEST (image_files, png_header) {
+  url u= image_file ("header.png", png_file (200, 100, 5670));
+  int w= 0, h= 0;
+  EXPECT_TRUE (native_image_size (u, w, h));
+  EXPECT_EQ (w, 100);
+  EXPECT_EQ (h, 50);
+  remove (u);
+}
+
+TEST (image_files, png_corrupt_length) {
+  // a chunk length beyond the end of the file must not be followed
+  string huge= be32 (0x7ffffff0) * string ("tEXt");
+  url u= image_file ("corrupt.png", png_file (200, 100, 5670, huge));
+  int w= 0, h= 0;
+  EXPECT_FALSE (native_image_size (u, w, h));
+  remove (u);
+}
+
+TEST (image_files, probe_cache) {
+  url u= image_file ("probe.png", png_file (200, 100, 5670));
+  string key= concretize (u);
+  int w= 0, h= 0;
+  image_size (u, w, h);
+  EXPECT_EQ (w, 100);
+  EXPECT_EQ (h, 50);
+  EXPECT_TRUE (is_cached ("image_cache.scm", key));
+  // a fresh session only has the persistent cache
+  clear_imgbox_cache (u->t);
+  w= h= 0;
+  image_size (u, w, h);
+  EXPECT_EQ (w, 100);
+  EXPECT_EQ (h, 50);
+  remove (u);
+}
+
+TEST (image_files, probe_cache_stale) {
+  url u= image_file ("stale.png", png_file (200, 100, 5670));
+  int w= 0, h= 0;
+  image_size (u, w, h);
+  EXPECT_EQ (w, 100);
+  // a file of another size invalidates the cached entry
+  string text= png_chunk ("tEXt", string ("Comment\0x", 9));
+  u= image_file ("stale.png", png_file (400, 100, 5670, text));
+  image_size (u, w, h);
+  EXPECT_EQ (w, 200);
+  EXPECT_EQ (h, 50);
+  remove (u);
+}
+
+TEST (image_files, default_bbox_not_cached) {
+  url u= image_file ("nobbox.eps", "%!PS-Adobe-3.0 EPSF-3.0\nshowpage\n");
+  int x1, y1, x2, y2;
+  EXPECT_TRUE (ps_bounding_box (u, x1, y1, x2, y2, true));
+  EXPECT_EQ (x2 - x1, 596);
+  EXPECT_EQ (y2 - y1, 842);
+  EXPECT_FALSE (is_cached ("image_cache.scm", concretize (u)));
+  remove (u);
+}
+
+TEST (image_files, bbox_cached) {
+  url u= image_file ("bbox.eps",
+                     "%!PS-Adobe-3.0 EPSF-3.0\n"
+                     "%%BoundingBox: 10 20 110 70\nshowpage\n");
+  int x1, y1, x2, y2;
+  EXPECT_TRUE (ps_bounding_box (u, x1, y1, x2, y2, false));
+  EXPECT_EQ (x1, 10);
+  EXPECT_EQ (y2, 70);
+  EXPECT_TRUE (is_cached ("image_cache.scm", concretize (u)));
+  clear_imgbox_cache (u->t);
+  x1= y1= x2= y2= 0;
+  EXPECT_TRUE (ps_bounding_box (u, x1, y1, x2, y2, false));
+  EXPECT_EQ (x1, 10);
+  EXPECT_EQ (y1, 20);
+  EXPECT_EQ (x2, 110);
+  EXPECT_EQ (y2, 70);
+  remove (u);
+}
+
+static string
+cache_name (url u, string params) {
+  return as_string (conversion_cache_file (u, params, ".png"));
+}
+
+TEST (image_files, conversion_cache_file) {
+  url u= image_file ("convert.png", png_file (200, 100, 5670));
+  string key= cache_name (u, "convert png 10x10 0");
+  ASSERT_NE (key, as_string (url_none ()));
+  EXPECT_EQ (cache_name (u, "convert png 10x10 0"), key);
+  EXPECT_NE (cache_name (u, "convert png 20x20 0"), key);
+  EXPECT_EQ (as_string (image_conversion_file (u, "png", 10, 10, 0)), key);
+  // another version of the source gives another entry
+  string text= png_chunk ("tEXt", string ("Comment\0x", 9));
+  u= image_file ("convert.png", png_file (200, 100, 5670, text));
+  EXPECT_NE (cache_name (u, "convert png 10x10 0"), key);
+  remove (u);
+  EXPECT_TRUE (is_none (conversion_cache_file (u, "convert", ".png")));
+}
+
+TEST (image_files, conversion_cache_hit) {
+  url u= image_file ("hit.png", png_file (200, 100, 5670));
+  url c= conversion_cache_file (u, "hit", ".raw");
+  remove (c);
+  EXPECT_FALSE (conversion_cache_hit (c));
+  url temp= url_temp (".raw");
+  save_string (temp, "converted", false);
+  conversion_cache_store (c, temp);
+  EXPECT_TRUE (conversion_cache_hit (c));
+  string s;
+  EXPECT_FALSE (load_string (c, s, false));
+  EXPECT_EQ (s, string ("converted"));
+  remove (temp);
+  remove (c);
+  remove (u);
+}
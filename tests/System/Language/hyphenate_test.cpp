@@ -0,0 +1,51 @@
+
+/******************************************************************************
+* MODULE     : hyphenate_test.cpp
+* DESCRIPTION: Hyphenation using compiled pattern tries
+* COPYRIGHT  : (C) 2026  the TeXmacs team
+*******************************************************************************
+* This software falls under the GNU general public license version 3 or later.
+* It comes WITHOUT ANY WARRANTY WHATSOEVER. For details, see the file LICENSE
+* in the root directory or <http://www.gnu.org/licenses/gpl-3.0.html>.
+******************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include "hyphenate.hpp"
+
+static string
+sample_source () {
+  return "% sample patterns\n"
+         "\\patterns{\n1b\nc2b\n}\n"
+         "\\hyphenation{\nta-ble\n}\n";
+}
+
+TEST (hyphenate, patterns) {
+  hyphen_table ht= make_hyphen_table (sample_source (), false);
+  array<int> p= get_hyphens ("aaabaaa", ht);
+  ASSERT_EQ (N(p), 6);
+  for (int i=0; i<N(p); i++)
+    EXPECT_EQ (p[i], i == 2? HYPH_STD: HYPH_INVALID);
+  p= get_hyphens ("aacbaaa", ht);
+  ASSERT_EQ (N(p), 6);
+  for (int i=0; i<N(p); i++)
+    EXPECT_EQ (p[i], HYPH_INVALID);
+}
+
+TEST (hyphenate, exceptions) {
+  hyphen_table ht= make_hyphen_table (sample_source (), false);
+  array<int> p= get_hyphens ("table", ht);
+  ASSERT_EQ (N(p), 4);
+  EXPECT_EQ (p[0], HYPH_INVALID);
+  EXPECT_EQ (p[1], HYPH_STD);
+  EXPECT_EQ (p[2], HYPH_INVALID);
+  EXPECT_EQ (p[3], HYPH_INVALID);
+}
+
+TEST (hyphenate, memo) {
+  hyphen_table ht= make_hyphen_table (sample_source (), false);
+  array<int> p= get_hyphens ("aaabaaa", ht);
+  for (int i=0; i<10000; i++)
+    (void) get_hyphens ("word" * as_string (i), ht);
+  EXPECT_TRUE (get_hyphens ("aaabaaa", ht) == p);
+}
@@ -0,0 +1,142 @@
+
+/******************************************************************************
+* MODULE     : connection_test.cpp
+* DESCRIPTION: Asynchronous evaluations over a scripted plugin link
+* COPYRIGHT  : (C) 2026  the TeXmacs team
+*******************************************************************************
+* This software falls under the GNU general public license version 3 or later.
+* It comes WITHOUT ANY WARRANTY WHATSOEVER. For details, see the file LICENSE
+* in the root directory or <http://www.gnu.org/licenses/gpl-3.0.html>.
+******************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include "connect.hpp"
+
+/******************************************************************************
+* A fake plugin: the input "n" produces n lines of output, three lines
+* for each read, followed by DATA_END.  The jobs are only run while
+* the plugin has output, so that the session call backs are not needed.
+******************************************************************************/
+
+class fake_plugin_rep: public tm_link_rep {
+public:
+  int  left;
+  int  counter;
+  bool busy;
+  array<string> inputs;
+
+  fake_plugin_rep (): left (0), counter (0), busy (false) {}
+  string start () { alive= true; busy= true; return "ok"; }
+  void write (string s, int channel) {
+    (void) channel; inputs << s; left= as_int (s); busy= true; }
+  string& watch (int channel) {
+    (void) channel; static string empty; return empty; }
+  string read (int channel) {
+    string r;
+    if (channel != LINK_OUT || !busy) return r;
+    for (int k=0; k<3 && left > 0; k++, left--)
+      r << "line " << as_string (counter++) << "\n";
+    if (left == 0) { r << DATA_END; busy= false; }
+    return r; }
+  void listen (int msecs) { (void) msecs; }
+  void interrupt () { left= 0; }
+  void stop () { alive= false; busy= false; }
+};
+
+static fake_plugin_rep*
+fake_start (string session) {
+  fake_plugin_rep* p= tm_new<fake_plugin_rep> ();
+  tm_link ln (p);
+  EXPECT_EQ (connection_start ("fake", session, ln), string ("ok"));
+  (void) connection_read ("fake", session);
+  EXPECT_EQ (connection_status ("fake", session), WAITING_FOR_INPUT);
+  return p;
+}
+
+static bool
+async_active (int id) {
+  string st= connection_async_status (id);
+  return st == "queued" || st == "running";
+}
+
+static void
+pump (fake_plugin_rep* p, int id, int max_steps= 100000) {
+  // deliver the output of the plugin until job id has been completed
+  for (int i=0; i<max_steps && async_active (id); i++) {
+    p->apply_command ();
+    connection_async_poll ();
+  }
+}
+
+static int
+count_lines (tree doc) {
+  int n= 0;
+  for (int i=0; i<N(doc); i++)
+    if (doc[i] != "") n++;
+  return n;
+}
+
+/******************************************************************************
+* Tests
+******************************************************************************/
+
+TEST (connection, async_result) {
+  fake_plugin_rep* p= fake_start ("result");
+  int id= connection_eval_async ("fake", "result", string ("10"), command ());
+  EXPECT_EQ (connection_async_status (id), string ("running"));
+  pump (p, id);
+  EXPECT_EQ (connection_async_status (id), string ("done"));
+  tree r= connection_async_result (id);
+  EXPECT_EQ (count_lines (r), 10);
+  EXPECT_EQ (r[0], tree ("line 0"));
+  EXPECT_EQ (connection_async_status (id), string ("unknown"));
+}
+
+TEST (connection, async_queue) {
+  fake_plugin_rep* p= fake_start ("queue");
+  int id1= connection_eval_async ("fake", "queue", string ("4"), command ());
+  int id2= connection_eval_async ("fake", "queue", string ("5"), command ());
+  EXPECT_EQ (connection_async_status (id2), string ("queued"));
+  pump (p, id2);
+  EXPECT_EQ (N(p->inputs), 2);
+  EXPECT_EQ (count_lines (connection_async_result (id1)), 4);
+  EXPECT_EQ (count_lines (connection_async_result (id2)), 5);
+}
+
+TEST (connection, deferred_write) {
+  fake_plugin_rep* p= fake_start ("deferred");
+  int id= connection_eval_async ("fake", "deferred", string ("30"), command ());
+  p->apply_command ();
+  // the input is kept until the job has been completed
+  connection_write ("fake", "deferred", string ("2"));
+  EXPECT_EQ (N(p->inputs), 1);
+  pump (p, id);
+  EXPECT_EQ (count_lines (connection_async_result (id)), 30);
+  ASSERT_EQ (N(p->inputs), 2);
+  EXPECT_EQ (p->inputs[1], string ("2"));
+}
+
+TEST (connection, async_cancel) {
+  fake_plugin_rep* p= fake_start ("cancel");
+  int id= connection_eval_async ("fake", "cancel", string ("100000"),
+                                 command ());
+  p->apply_command ();
+  connection_async_cancel (id);
+  EXPECT_EQ (connection_async_status (id), string ("cancelled"));
+  pump (p, id);
+  EXPECT_EQ (count_lines (connection_async_result (id)), 0);
+  EXPECT_LT (p->counter, 100);
+}
+
+TEST (connection, sync_eval_after_job) {
+  fake_plugin_rep* p= fake_start ("sync");
+  int id= connection_eval_async ("fake", "sync", string ("20"), command ());
+  p->apply_command ();
+  tree r= connection_eval ("fake", "sync", string ("3"));
+  EXPECT_EQ (connection_async_status (id), string ("done"));
+  EXPECT_EQ (count_lines (connection_async_result (id)), 20);
+  EXPECT_EQ (count_lines (r), 3);
+  ASSERT_EQ (N(p->inputs), 2);
+  EXPECT_EQ (p->inputs[1], string ("3"));
+}
@@ -0,0 +1,81 @@
+
+/******************************************************************************
+* MODULE     : persistent_test.cpp
+* DESCRIPTION: Log-structured persistent storage of key-value pairs
+* COPYRIGHT  : (C) 2026  the TeXmacs team
+*******************************************************************************
+* This software falls under the GNU general public license version 3 or later.
+* It comes WITHOUT ANY WARRANTY WHATSOEVER. For details, see the file LICENSE
+* in the root directory or <http://www.gnu.org/licenses/gpl-3.0.html>.
+******************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include "persistent.hpp"
+
+static url
+store_dir (string name) {
+  return url_temp_dir () * url (name);
+}
+
+static void
+store_remove (url dir) {
+  remove (dir * url ("log"));
+  remove (dir * url ("index"));
+  rmdir (dir * url ("_"));
+  rmdir (dir);
+}
+
+TEST (persistent, set_reset) {
+  url dir= store_dir ("persistent-basic");
+  persistent_set (dir, "a", "first\nline\\");
+  persistent_set (dir, "b", "");
+  EXPECT_TRUE (persistent_contains (dir, "a"));
+  EXPECT_TRUE (persistent_contains (dir, "b"));
+  EXPECT_FALSE (persistent_contains (dir, "c"));
+  EXPECT_EQ (persistent_get (dir, "a"), string ("first\nline\\"));
+  persistent_reset (dir, "a");
+  EXPECT_FALSE (persistent_contains (dir, "a"));
+  EXPECT_EQ (persistent_get (dir, "a"), string (""));
+  persistent_sync ();
+  store_remove (dir);
+}
+
+TEST (persistent, compaction) {
+  url dir= store_dir ("persistent-compaction");
+  // a few large values suffice to exceed the size of a compacted log
+  string pad ('x', 20000);
+  for (int i=0; i<60; i++)
+    persistent_set (dir, "key" * as_string (i), as_string (i) * pad);
+  for (int i=0; i<60; i+=3)
+    persistent_reset (dir, "key" * as_string (i));
+  EXPECT_TRUE (is_regular (dir * url ("index")));
+  for (int i=0; i<60; i++) {
+    string key= "key" * as_string (i);
+    EXPECT_EQ (persistent_contains (dir, key), i % 3 != 0);
+    if (i % 3 != 0) EXPECT_EQ (persistent_get (dir, key), as_string (i) * pad);
+  }
+  store_remove (dir);
+}
+
+TEST (persistent, batch_clear) {
+  url dir= store_dir ("persistent-batch");
+  array<string> keys, vals;
+  for (int i=0; i<10; i++) {
+    keys << ("key" * as_string (i));
+    vals << as_string (i * i);
+  }
+  persistent_set (dir, keys, vals);
+  EXPECT_EQ (persistent_get (dir, "key7"), string ("49"));
+  // compact, so that the cleared pairs are both in the index and the log
+  persistent_set (dir, "large", string ('x', 1 << 20));
+  persistent_set (dir, "last", "1");
+  persistent_clear (dir);
+  for (int i=0; i<10; i++)
+    EXPECT_FALSE (persistent_contains (dir, keys[i]));
+  EXPECT_FALSE (persistent_contains (dir, "large"));
+  EXPECT_FALSE (persistent_contains (dir, "last"));
+  persistent_set (dir, "after", "clear");
+  EXPECT_EQ (persistent_get (dir, "after"), string ("clear"));
+  store_remove (dir);
+}
@@ -0,0 +1,142 @@
+
+/******************************************************************************
+* MODULE     : subprocess_test.cpp
+* DESCRIPTION: Worker processes communicating through pipes
+* COPYRIGHT  : (C) 2026  the TeXmacs team
+*******************************************************************************
+* This software falls under the GNU general public license version 3 or later.
+* It comes WITHOUT ANY WARRANTY WHATSOEVER. For details, see the file LICENSE
+* in the root directory or <http://www.gnu.org/licenses/gpl-3.0.html>.
+******************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include "subprocess.hpp"
+#include <signal.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+static string
+worker_output (int w) {
+  // more than fits into a pipe, so that the workers block on writing
+  string s;
+  for (int i=0; i<20000; i++) s << "worker " << as_string (w) << "\n";
+  return s;
+}
+
+static void
+interrupt (int sig) {
+  (void) sig;
+}
+
+TEST (subprocess, collect) {
+  array<int> pids, fds;
+  for (int w=0; w<3; w++) {
+    int fd;
+    int pid= subprocess_fork (fd);
+    if (pid == 0) {
+      bool ok= subprocess_write (fd, worker_output (w));
+      subprocess_exit (fd, ok && w != 1);
+    }
+    ASSERT_GT (pid, 0);
+    pids << pid; fds << fd;
+  }
+  array<string> outs;
+  array<bool> oks;
+  subprocess_collect (pids, fds, outs, oks);
+  ASSERT_EQ (N(outs), 3);
+  for (int w=0; w<3; w++)
+    EXPECT_TRUE (outs[w] == worker_output (w));
+  EXPECT_TRUE  (oks[0]);
+  EXPECT_FALSE (oks[1]);
+  EXPECT_TRUE  (oks[2]);
+}
+
+TEST (subprocess, interrupted) {
+  // signals which do not restart system calls arrive during the collection
+  struct sigaction sa, old;
+  sa.sa_handler= interrupt;
+  sigemptyset (&sa.sa_mask);
+  sa.sa_flags= 0;
+  sigaction (SIGALRM, &sa, &old);
+  struct itimerval tv, none;
+  tv.it_interval.tv_sec= 0;
+  tv.it_interval.tv_usec= 1000;
+  tv.it_value= tv.it_interval;
+  none.it_interval.tv_sec= none.it_interval.tv_usec= 0;
+  none.it_value= none.it_interval;
+  array<int> pids, fds;
+  for (int w=0; w<2; w++) {
+    int fd;
+    int pid= subprocess_fork (fd);
+    if (pid == 0) {
+      setitimer (ITIMER_REAL, &none, NULL);
+      string s= worker_output (w);
+      bool ok= true;
+      for (int k=0; k<N(s); k += 20000) {
+        usleep (5000);
+        ok= ok && subprocess_write (fd, s (k, min (k + 20000, N(s))));
+      }
+      subprocess_exit (fd, ok);
+    }
+    ASSERT_GT (pid, 0);
+    pids << pid; fds << fd;
+  }
+  setitimer (ITIMER_REAL, &tv, NULL);
+  array<string> outs;
+  array<bool> oks;
+  subprocess_collect (pids, fds, outs, oks);
+  setitimer (ITIMER_REAL, &none, NULL);
+  sigaction (SIGALRM, &old, NULL);
+  for (int w=0; w<2; w++) {
+    EXPECT_TRUE (outs[w] == worker_output (w));
+    EXPECT_TRUE (oks[w]);
+  }
+}
+
+TEST (subprocess, spawn) {
+  array<string> args;
+  args << string ("cat");
+  int in, out;
+  int pid= subprocess_spawn (args, in, out);
+  ASSERT_GT (pid, 0);
+  string s= worker_output (7);
+  EXPECT_TRUE (subprocess_write (in, s (0, 100)));
+  string r;
+  while (N(r) < 100 && subprocess_read (out, r) > 0) {}
+  EXPECT_TRUE (r == s (0, 100));
+  array<int> fds;
+  array<bool> ready;
+  fds << out;
+  EXPECT_EQ (subprocess_poll (fds, ready, 10), 0);
+  EXPECT_EQ (subprocess_wait (pid, false), -1);
+  close (in);
+  EXPECT_EQ (subprocess_read (out, r), 0);
+  close (out);
+  EXPECT_EQ (subprocess_wait (pid), 1);
+  array<string> none;
+  none << string ("/nonexistent/texmacs-worker");
+  pid= subprocess_spawn (none, in, out);
+  if (pid > 0) {
+    close (in);
+    close (out);
+    EXPECT_EQ (subprocess_wait (pid), 0);
+  }
+}
+
+TEST (subprocess, wait_own_pid) {
+  // waiting for a worker does not reap unrelated children
+  pid_t other= fork ();
+  if (other == 0) _exit (3);
+  int fd;
+  int pid= subprocess_fork (fd);
+  if (pid == 0) subprocess_exit (fd, true);
+  ASSERT_GT (pid, 0);
+  usleep (10000);
+  close (fd);
+  EXPECT_EQ (subprocess_wait (pid), 1);
+  int status= 0;
+  EXPECT_EQ (waitpid (other, &status, 0), other);
+  EXPECT_EQ (WEXITSTATUS (status), 3);
+}